@@ -8,6 +8,15 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/netanim-module.h"
 
+#include "batched-waypoint-mobility.h"
+#include "bounded-animation.h"
+#include "flow-attribution-index.h"
+#include "grid-spectrum-channel.h"
+#include "ladder-scheduler.h"
+#include "profiling-simulator-impl.h"
+#include "tdma-client-app.h"
+#include "tdma-net-device.h"
+
 #include <fstream>
 #include <iomanip>
 
@@ -22,77 +31,9 @@ const uint32_t kPacketsPerSlot = 5;     // reduce burstiness
 const uint32_t kPacketSize    = 1024;   // bytes
 const double   kGuardTime     = 0.004;  // 1 ms guard
 
-
-
-std::vector<std::vector<Ptr<Application>>> uplinkApps;
-std::vector<std::vector<Ptr<Application>>> downlinkApps;
-
-class TdmaClientApp : public Application {
-public:
-  TdmaClientApp() : m_socket(0) {}
-  ~TdmaClientApp() override { m_socket = 0; }
-
-  void Setup(Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets) {
-    m_socket = socket;
-    m_peer = address;
-    m_packetSize = packetSize;
-    m_nPackets = nPackets;
-    m_interval = Seconds((kSlotDuration - kGuardTime) / nPackets);
-  }
-  void SetStartStopTime(Time startTime, Time stopTime) {
-    m_startTime = startTime;
-    m_stopTime  = stopTime;
-    Application::SetStartTime(startTime);
-    Application::SetStopTime(stopTime);
-  }
-
-private:
-  void StartApplication(void) override {
-    if (!m_socket) return;
-    if (m_socket->GetBoundNetDevice() == nullptr) {
-      m_socket->Bind();
-    }
-    m_socket->Connect(m_peer);
-
-    m_count = 0;
-    if (Simulator::Now() < m_startTime) {
-      Simulator::Schedule(m_startTime - Simulator::Now(), &TdmaClientApp::StartApplication, this);
-      return;
-    }
-    if (Simulator::Now() > m_stopTime) return;
-
-    m_sendEvent = Simulator::ScheduleNow(&TdmaClientApp::SendPacket, this);
-  }
-
-  void StopApplication(void) override {
-    if (m_sendEvent.IsPending()) Simulator::Cancel(m_sendEvent);
-    if (m_socket) m_socket->Close();
-  }
-
-  void SendPacket(void) {
-    if (Simulator::Now() >= m_stopTime) return;
-    Ptr<Packet> packet = Create<Packet>(m_packetSize);
-    m_socket->Send(packet);
-    m_count++;
-    if (m_count < m_nPackets && Simulator::Now() + m_interval < m_stopTime) {
-      ScheduleNextTx();
-    }
-  }
-
-  void ScheduleNextTx(void) {
-    m_sendEvent = Simulator::Schedule(m_interval, &TdmaClientApp::SendPacket, this);
-  }
-
-  Ptr<Socket> m_socket;
-  Address     m_peer;
-  uint32_t    m_packetSize{0};
-  uint32_t    m_nPackets{0};
-  uint32_t    m_count{0};
-  EventId     m_sendEvent;
-  Time        m_interval;
-  Time        m_startTime;
-  Time        m_stopTime;
-};
+// One persistent TDMA application per UE and direction
+std::vector<Ptr<TdmaClientApp>> uplinkApps;
+std::vector<Ptr<TdmaClientApp>> downlinkApps;
 
 int main(int argc, char *argv[]) {
   uint32_t    numUes        = kNumUes;
@@ -100,7 +41,22 @@ int main(int argc, char *argv[]) {
   double      simDuration   = kSimDuration;
   uint32_t    packetSize    = kPacketSize;
   bool        enableAnimation = true;
+  bool        profileEvents = false;
+  bool        packetPool    = true;
+  bool        useTdmaMac    = false;
+  bool        wifiCulling   = false;
+  bool        batchedMobility = false;
+  bool        parallelBs    = false;
+  std::string slotPolicy    = "ns3::TdmaRoundRobinPolicy";
+  double      offeredLoad   = 0.0;
   std::string animationFile = "tdma-2bs.xml";
+  bool        animFullTrace = false;
+  uint64_t    animPktsPerFile = 500000;
+  double      animPollInterval = 1.0;
+  double      animStart     = 0.0;
+  double      animWindow    = 2.0;
+  uint32_t    animSampleEvery = 100;
+  std::string animTraceUes  = "";
 
   CommandLine cmd;
   cmd.AddValue("numUes", "Number of UE nodes", numUes);
@@ -108,9 +64,28 @@ int main(int argc, char *argv[]) {
   cmd.AddValue("simDuration", "Total simulation duration (seconds)", simDuration);
   cmd.AddValue("packetSize", "Size of each packet (bytes)", packetSize);
   cmd.AddValue("enableAnimation", "Enable NetAnim animation", enableAnimation);
+  cmd.AddValue("profileEvents", "Print wall time and event count per event target at the end of the run", profileEvents);
+  cmd.AddValue("packetPool", "Recycle the payload packets of the TDMA apps (off while animating, packet uids repeat)", packetPool);
+  cmd.AddValue("useTdmaMac", "Use the contention-free TDMA MAC instead of 802.11g", useTdmaMac);
+  cmd.AddValue("wifiCulling", "Run SpectrumWifiPhys on a grid-indexed channel that skips receivers beyond 150 m instead of YansWifiPhy", wifiCulling);
+  cmd.AddValue("batchedMobility", "Move the UEs with one batched random waypoint container", batchedMobility);
+  cmd.AddValue("slotPolicy", "TypeId of the TdmaSlotPolicy building each frame", slotPolicy);
+  cmd.AddValue("offeredLoad", "Poisson packets per second per UE and direction, 0 for saturated sources", offeredLoad);
+  cmd.AddValue("parallelBs", "Run one TDMA frame per BS instead of a shared frame", parallelBs);
   cmd.AddValue("animationFile", "NetAnim XML output file", animationFile);
+  cmd.AddValue("animFullTrace", "Trace every packet in NetAnim (large XML) instead of sampling", animFullTrace);
+  cmd.AddValue("animPktsPerFile", "Packets per NetAnim XML file before rotating (full trace)", animPktsPerFile);
+  cmd.AddValue("animPollInterval", "NetAnim mobility poll interval (seconds)", animPollInterval);
+  cmd.AddValue("animStart", "Start of the NetAnim XML window (seconds)", animStart);
+  cmd.AddValue("animWindow", "Length of the NetAnim XML window, which traces every packet (seconds)", animWindow);
+  cmd.AddValue("animSampleEvery", "Log 1 in N packets of the traced UEs", animSampleEvery);
+  cmd.AddValue("animTraceUes", "Comma separated UE indices whose packets are logged, empty for all", animTraceUes);
   cmd.Parse(argc, argv);
 
+  if (profileEvents) {
+    GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::ProfilingSimulatorImpl"));
+  }
+
   LogComponentEnable("TdmaDuplexSim2BS", LOG_LEVEL_INFO);
 
   // --- Topology ---
@@ -118,33 +93,73 @@ int main(int argc, char *argv[]) {
   bsNodes.Create(2);
   ueNodes.Create(numUes);
 
-  // Channel/PHY
-  YansWifiChannelHelper channel = YansWifiChannelHelper::Default();
-  channel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
-  channel.AddPropagationLoss("ns3::RangePropagationLossModel", "MaxRange", DoubleValue(150.0));
-
-  YansWifiPhyHelper phy;
-  phy.SetChannel(channel.Create());
-  phy.Set("TxPowerStart", DoubleValue(20.0));
-  phy.Set("TxPowerEnd",   DoubleValue(20.0));
-
-  WifiHelper wifi;
-  wifi.SetStandard(WIFI_STANDARD_80211g);
-  wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
-                               "DataMode", StringValue("DsssRate11Mbps"),
-                               "ControlMode", StringValue("DsssRate1Mbps"));
-
-  WifiMacHelper mac;
-  Ssid ssid = Ssid("tdma-2bs");
+  // Central TDMA frame: UEs 0..N/2-1 belong to BS 0, the rest to BS 1
+  Ptr<TdmaSlotScheduler> slotScheduler = CreateObject<TdmaSlotScheduler>();
+  slotScheduler->SetAttribute("SlotDuration", TimeValue(Seconds(slotDuration)));
+  slotScheduler->SetAttribute("GuardTime", TimeValue(Seconds(kGuardTime)));
+  slotScheduler->SetAttribute("ParallelGroups", BooleanValue(parallelBs));
+  slotScheduler->SetPolicy(ObjectFactory(slotPolicy).Create<TdmaSlotPolicy>());
+  if (Ptr<TdmaLoadPolicy> loadPolicy = DynamicCast<TdmaLoadPolicy>(slotScheduler->GetPolicy())) {
+    loadPolicy->SetAttribute("PacketsPerSlot", UintegerValue(kPacketsPerSlot));
+  }
+  const Time packetTime = (Seconds(slotDuration) - Seconds(kGuardTime)) / kPacketsPerSlot;
+  for (uint32_t i = 0; i < numUes; ++i) {
+    slotScheduler->AddUe(i < numUes / 2 ? 0 : 1);
+  }
 
-  // UEs
-  mac.SetType("ns3::StaWifiMac", "Ssid", SsidValue(ssid),
-              "ActiveProbing", BooleanValue(true), "QosSupported", BooleanValue(false));
-  NetDeviceContainer ueDevices = wifi.Install(phy, mac, ueNodes);
+  NetDeviceContainer ueDevices, bsDevices;
+  if (useTdmaMac) {
+    // Native TDMA MAC: UEs send in their uplink slots, their BS to each UE in its downlink ones
+    TdmaHelper tdma;
+    tdma.SetDeviceAttribute("DataRate", DataRateValue(DataRate("11Mbps")));
+    tdma.SetChannelAttribute("MaxRange", DoubleValue(150.0));
+    Ptr<TdmaChannel> tdmaChannel = tdma.CreateChannel();
 
-  // BSs
-  mac.SetType("ns3::ApWifiMac", "Ssid", SsidValue(ssid), "QosSupported", BooleanValue(false));
-  NetDeviceContainer bsDevices = wifi.Install(phy, mac, bsNodes);
+    ueDevices = tdma.Install(ueNodes, tdmaChannel);
+    bsDevices = tdma.Install(bsNodes, tdmaChannel);
+    for (uint32_t i = 0; i < numUes; ++i) {
+      tdma.AssignSlot(ueDevices.Get(i), slotScheduler, i, TDMA_UPLINK);
+      tdma.AssignSlot(bsDevices.Get(slotScheduler->GetGroup(i)), slotScheduler, i, TDMA_DOWNLINK,
+                      ueDevices.Get(i));
+    }
+  } else {
+    // Channel/PHY. With culling, a transmission only reaches the PHYs within
+    // range instead of all of them; the loss and delay models are the same.
+    // YansWifiChannel cannot be subclassed for this (Send is not virtual),
+    // so culling runs SpectrumWifiPhy on a GridSpectrumChannel instead.
+    YansWifiPhyHelper yansPhy;
+    SpectrumWifiPhyHelper spectrumPhy;
+    WifiPhyHelper& phy = wifiCulling ? static_cast<WifiPhyHelper&>(spectrumPhy) : yansPhy;
+    if (wifiCulling) {
+      NS_LOG_INFO("Wi-Fi PHY: SpectrumWifiPhy on a grid-indexed channel");
+      spectrumPhy.SetChannel(CreateCulledWifiChannel(150.0));
+    } else {
+      YansWifiChannelHelper channel = YansWifiChannelHelper::Default();
+      channel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
+      channel.AddPropagationLoss("ns3::RangePropagationLossModel", "MaxRange", DoubleValue(150.0));
+      yansPhy.SetChannel(channel.Create());
+    }
+    phy.Set("TxPowerStart", DoubleValue(20.0));
+    phy.Set("TxPowerEnd",   DoubleValue(20.0));
+
+    WifiHelper wifi;
+    wifi.SetStandard(WIFI_STANDARD_80211g);
+    wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
+                                 "DataMode", StringValue("DsssRate11Mbps"),
+                                 "ControlMode", StringValue("DsssRate1Mbps"));
+
+    WifiMacHelper mac;
+    Ssid ssid = Ssid("tdma-2bs");
+
+    // UEs
+    mac.SetType("ns3::StaWifiMac", "Ssid", SsidValue(ssid),
+                "ActiveProbing", BooleanValue(true), "QosSupported", BooleanValue(false));
+    ueDevices = wifi.Install(phy, mac, ueNodes);
+
+    // BSs
+    mac.SetType("ns3::ApWifiMac", "Ssid", SsidValue(ssid), "QosSupported", BooleanValue(false));
+    bsDevices = wifi.Install(phy, mac, bsNodes);
+  }
 
   // Mobility
   MobilityHelper mobility;
@@ -158,20 +173,36 @@ int main(int argc, char *argv[]) {
   mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
   mobility.Install(bsNodes);
 
-  MobilityHelper ueMobility;
-  ueMobility.SetPositionAllocator("ns3::RandomRectanglePositionAllocator",
-                                  "X", StringValue("ns3::UniformRandomVariable[Min=-100.0|Max=100.0]"),
-                                  "Y", StringValue("ns3::UniformRandomVariable[Min=-50.0|Max=50.0]"));
-  ueMobility.SetMobilityModel("ns3::SteadyStateRandomWaypointMobilityModel",
-                              "MinX", DoubleValue(-100.0),
-                              "MaxX", DoubleValue(100.0),
-                              "MinY", DoubleValue(-50.0),
-                              "MaxY", DoubleValue(50.0),
-                              "MinSpeed", StringValue("1.0"),
-                              "MaxSpeed", StringValue("3.0"),
-                              "MinPause", StringValue("0.5"),
-                              "MaxPause", StringValue("2.0"));
-  ueMobility.Install(ueNodes);
+  if (batchedMobility) {
+    Ptr<WaypointBatch> ueBatch = CreateObject<WaypointBatch>();
+    ueBatch->SetAttribute("MinX", DoubleValue(-100.0));
+    ueBatch->SetAttribute("MaxX", DoubleValue(100.0));
+    ueBatch->SetAttribute("MinY", DoubleValue(-50.0));
+    ueBatch->SetAttribute("MaxY", DoubleValue(50.0));
+    ueBatch->SetAttribute("MinSpeed", DoubleValue(1.0));
+    ueBatch->SetAttribute("MaxSpeed", DoubleValue(3.0));
+    ueBatch->SetAttribute("MinPause", DoubleValue(0.5));
+    ueBatch->SetAttribute("MaxPause", DoubleValue(2.0));
+    ueBatch->Install(ueNodes);
+    // Fixed streams, after the 100 + 2 * numUes of the apps, so a UE's walk
+    // only varies with RngRun
+    ueBatch->AssignStreams(100 + 2 * numUes);
+  } else {
+    MobilityHelper ueMobility;
+    ueMobility.SetPositionAllocator("ns3::RandomRectanglePositionAllocator",
+                                    "X", StringValue("ns3::UniformRandomVariable[Min=-100.0|Max=100.0]"),
+                                    "Y", StringValue("ns3::UniformRandomVariable[Min=-50.0|Max=50.0]"));
+    ueMobility.SetMobilityModel("ns3::SteadyStateRandomWaypointMobilityModel",
+                                "MinX", DoubleValue(-100.0),
+                                "MaxX", DoubleValue(100.0),
+                                "MinY", DoubleValue(-50.0),
+                                "MaxY", DoubleValue(50.0),
+                                "MinSpeed", StringValue("1.0"),
+                                "MaxSpeed", StringValue("3.0"),
+                                "MinPause", StringValue("0.5"),
+                                "MaxPause", StringValue("2.0"));
+    ueMobility.Install(ueNodes);
+  }
 
   // Internet
   InternetStackHelper internet;
@@ -183,6 +214,10 @@ int main(int argc, char *argv[]) {
   Ipv4InterfaceContainer bsIfs = ipv4.Assign(bsDevices);
   Ipv4InterfaceContainer ueIfs = ipv4.Assign(ueDevices);
 
+  if (useTdmaMac) {
+    TdmaHelper::PopulateNeighbours();
+  }
+
   // Applications
   const uint16_t uplinkPort   = 5000; // UE -> BS
   const uint16_t downlinkPort = 5001; // BS -> UE
@@ -206,43 +241,49 @@ int main(int argc, char *argv[]) {
   uplinkApps.resize(numUes);
   downlinkApps.resize(numUes);
 
-  const double   cycleDuration = 2 * slotDuration * numUes;
-  const uint32_t numCycles     = static_cast<uint32_t>(simDuration / cycleDuration);
+  // Fixed streams for the offered-load arrivals, so runs only vary with RngRun
+  int64_t stream = 100;
+  TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
 
-  for (uint32_t cycle = 0; cycle < numCycles; ++cycle) {
-    const double cycleStartTime = cycle * cycleDuration;
-    for (uint32_t i = 0; i < numUes; ++i) {
-      const uint32_t bsIndex       = (i < numUes / 2 ? 0 : 1);
-      const double   uplinkStart   = cycleStartTime + i * 2 * slotDuration;
-      const double   downlinkStart = uplinkStart + slotDuration;
-
-      const double   uplinkStop    = uplinkStart   + slotDuration - kGuardTime;
-      const double   downlinkStop  = downlinkStart + slotDuration - kGuardTime;
-
-      if (uplinkStart   >= simDuration || uplinkStop   <= uplinkStart)   continue;
-      if (downlinkStart >= simDuration || downlinkStop <= downlinkStart) continue;
-
-      TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
-
-      // Uplink UE -> BS
-      Ptr<Socket> uplinkSocket = Socket::CreateSocket(ueNodes.Get(i), tid);
-      InetSocketAddress uplinkDst = InetSocketAddress(bsIfs.GetAddress(bsIndex), uplinkPort);
-      Ptr<TdmaClientApp> uplinkApp = CreateObject<TdmaClientApp>();
-      uplinkApp->Setup(uplinkSocket, uplinkDst, packetSize, kPacketsPerSlot);
-      uplinkApp->SetStartStopTime(Seconds(uplinkStart), Seconds(uplinkStop));
-      ueNodes.Get(i)->AddApplication(uplinkApp);
-      uplinkApps[i].push_back(uplinkApp);
-
-      // Downlink BS -> UE
-      Ptr<Socket> downlinkSocket = Socket::CreateSocket(bsNodes.Get(bsIndex), tid);
-      InetSocketAddress downlinkDst = InetSocketAddress(ueIfs.GetAddress(i), downlinkPort);
-      Ptr<TdmaClientApp> downlinkApp = CreateObject<TdmaClientApp>();
-      downlinkApp->Setup(downlinkSocket, downlinkDst, packetSize, kPacketsPerSlot);
-      downlinkApp->SetStartStopTime(Seconds(downlinkStart), Seconds(downlinkStop));
-      bsNodes.Get(bsIndex)->AddApplication(downlinkApp);
-      downlinkApps[i].push_back(downlinkApp);
-    }
+  for (uint32_t i = 0; i < numUes; ++i) {
+    const uint32_t bsIndex = slotScheduler->GetGroup(i);
+
+    // Uplink UE -> BS
+    Ptr<Socket> uplinkSocket = Socket::CreateSocket(ueNodes.Get(i), tid);
+    InetSocketAddress uplinkDst = InetSocketAddress(bsIfs.GetAddress(bsIndex), uplinkPort);
+    Ptr<TdmaClientApp> uplinkApp = CreateObject<TdmaClientApp>();
+    uplinkApp->Setup(uplinkSocket, uplinkDst, packetSize, kPacketsPerSlot);
+    uplinkApp->SetPacketPool(packetPool && !enableAnimation);
+    stream += uplinkApp->AssignStreams(stream);
+    uplinkApp->SetOfferedLoad(offeredLoad, packetTime);
+    uplinkApp->SetStartTime(Seconds(0.0));
+    uplinkApp->SetStopTime(Seconds(simDuration));
+    ueNodes.Get(i)->AddApplication(uplinkApp);
+    slotScheduler->AddSlotListener(i, TDMA_UPLINK, MakeCallback(&TdmaClientApp::StartSlot, uplinkApp));
+    uplinkApps[i] = uplinkApp;
+
+    // Downlink BS -> UE
+    Ptr<Socket> downlinkSocket = Socket::CreateSocket(bsNodes.Get(bsIndex), tid);
+    InetSocketAddress downlinkDst = InetSocketAddress(ueIfs.GetAddress(i), downlinkPort);
+    Ptr<TdmaClientApp> downlinkApp = CreateObject<TdmaClientApp>();
+    downlinkApp->Setup(downlinkSocket, downlinkDst, packetSize, kPacketsPerSlot);
+    downlinkApp->SetPacketPool(packetPool && !enableAnimation);
+    stream += downlinkApp->AssignStreams(stream);
+    downlinkApp->SetOfferedLoad(offeredLoad, packetTime);
+    downlinkApp->SetStartTime(Seconds(0.0));
+    downlinkApp->SetStopTime(Seconds(simDuration));
+    bsNodes.Get(bsIndex)->AddApplication(downlinkApp);
+    slotScheduler->AddSlotListener(i, TDMA_DOWNLINK, MakeCallback(&TdmaClientApp::StartSlot, downlinkApp));
+    downlinkApps[i] = downlinkApp;
+  }
+
+  Ptr<TdmaDemandPolicy> demandPolicy = DynamicCast<TdmaDemandPolicy>(slotScheduler->GetPolicy());
+  if (demandPolicy) {
+    demandPolicy->SetDemandCallback([](uint32_t ue, TdmaDirection dir) {
+      return dir == TDMA_UPLINK ? uplinkApps[ue]->GetBacklog() : downlinkApps[ue]->GetBacklog();
+    });
   }
+  slotScheduler->Start(Seconds(0.0));
 
   // FlowMonitor
   FlowMonitorHelper flowmon;
@@ -250,14 +291,25 @@ int main(int argc, char *argv[]) {
 
   // NetAnim
   AnimationInterface* anim = nullptr;
+  SampledPacketLog* packetLog = nullptr;
   if (enableAnimation) {
     anim = new AnimationInterface(animationFile);
 
-    // Either raise the packet cap...
-    anim->SetMaxPktsPerTraceFile(100000000ULL); // 1e8 packets per file
-
-    // ...or disable packet-level tracing entirely to avoid the message:
-    // anim->SkipPacketTracing();
+    if (animFullTrace) {
+      // Every packet, split over several XML files
+      anim->SetMaxPktsPerTraceFile(animPktsPerFile);
+    } else {
+      // Every packet in a short window, positions at a coarse period and
+      // 1-in-N packets of the selected UEs over the whole run
+      ConfigureBoundedAnimation(*anim, Seconds(animPollInterval), Seconds(animStart),
+                                Seconds(animStart + animWindow));
+      packetLog = new SampledPacketLog("tdma-2bs-packets", animSampleEvery, 1000000, true);
+      packetLog->SetAnimation(anim);
+      for (uint32_t ue : ParseUeList(animTraceUes, numUes)) {
+        packetLog->TraceUe(ueNodes.Get(ue));
+      }
+      packetLog->TraceServingNodes(bsNodes);
+    }
 
     anim->UpdateNodeDescription(bsNodes.Get(0), "Base Station 0");
     anim->UpdateNodeColor(bsNodes.Get(0), 255, 0, 0);
@@ -276,6 +328,7 @@ int main(int argc, char *argv[]) {
 
   Simulator::Stop(Seconds(simDuration));
   Simulator::Run();
+  std::cout << "Executed events: " << Simulator::GetEventCount() << std::endl;
 
   // ---- Outputs ----
   monitor->CheckForLostPackets();
@@ -285,14 +338,23 @@ int main(int argc, char *argv[]) {
 
   // 2) CSV (native: iterate FlowMonitor stats)
   Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
-  auto stats = monitor->GetFlowStats();
+  const auto& stats = monitor->GetFlowStats();
+
+  FlowAttributionIndex attribution(classifier);
+  for (uint32_t i = 0; i < numUes; ++i) {
+    attribution.AddUe(ueIfs.GetAddress(i), i, slotScheduler->GetGroup(i));
+  }
+  attribution.AddBss(bsIfs);
+  attribution.SetPortDirection(uplinkPort, FLOW_UPLINK);
+  attribution.SetPortDirection(downlinkPort, FLOW_DOWNLINK);
+  const char* directionNames[] = {"uplink", "downlink", "other"};
 
   std::ofstream allCsv("tdma-flows-all.csv");
   std::ofstream ulCsv ("tdma-uplink.csv");
   std::ofstream dlCsv ("tdma-downlink.csv");
 
   auto writeHeader = [](std::ostream& os) {
-    os << "flowId,srcAddr,srcPort,dstAddr,dstPort,direction,txPackets,rxPackets,lostPackets,"
+    os << "flowId,srcAddr,srcPort,dstAddr,dstPort,direction,ueId,bsId,txPackets,rxPackets,lostPackets,"
           "txBytes,rxBytes,duration_s,throughput_Mbps,mean_delay_ms,mean_jitter_ms,loss_rate\n";
   };
   writeHeader(allCsv); writeHeader(ulCsv); writeHeader(dlCsv);
@@ -301,7 +363,8 @@ int main(int argc, char *argv[]) {
   for (const auto& kv : stats) {
     FlowId fid = kv.first;
     const FlowMonitor::FlowStats& st = kv.second;
-    Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(fid);
+    const FlowAttribution& a = attribution.Classify(fid);
+    const Ipv4FlowClassifier::FiveTuple& t = a.tuple;
 
       double t_first_tx = st.timeFirstTxPacket.IsZero() ? 0.0 : st.timeFirstTxPacket.GetSeconds();
       double t_last_tx  = st.timeLastTxPacket.IsZero()  ? 0.0 : st.timeLastTxPacket.GetSeconds();
@@ -321,15 +384,15 @@ int main(int argc, char *argv[]) {
     double meanJitter = (st.rxPackets > 1) ? (st.jitterSum.GetSeconds() / (st.rxPackets - 1) * 1000.0) : 0.0;
     double lossRate   = (st.txPackets > 0) ? (double(st.lostPackets) / double(st.txPackets)) : 0.0;
 
-    std::string dir = "other";
-    if (t.destinationPort == uplinkPort)     dir = "uplink";
-    else if (t.destinationPort == downlinkPort) dir = "downlink";
+    std::string dir = directionNames[a.direction];
+    long ueId = a.ue != FlowAttribution::NONE ? long(a.ue) : -1;
+    long bsId = a.bs != FlowAttribution::NONE ? long(a.bs) : -1;
 
     auto writeLine = [&](std::ostream& os){
       os << fid << ","
          << t.sourceAddress << "," << t.sourcePort << ","
          << t.destinationAddress << "," << t.destinationPort << ","
-         << dir << ","
+         << dir << "," << ueId << "," << bsId << ","
          << st.txPackets << "," << st.rxPackets << "," << st.lostPackets << ","
          << st.txBytes << "," << st.rxBytes << ","
          << std::fixed << std::setprecision(6) << duration << ","
@@ -340,14 +403,15 @@ int main(int argc, char *argv[]) {
     };
 
     writeLine(allCsv);
-    if (dir == "uplink")   writeLine(ulCsv);
-    if (dir == "downlink") writeLine(dlCsv);
+    if (a.direction == FLOW_UPLINK)   writeLine(ulCsv);
+    if (a.direction == FLOW_DOWNLINK) writeLine(dlCsv);
   }
 
   allCsv.close(); ulCsv.close(); dlCsv.close();
 
   Simulator::Destroy();
   if (anim) delete anim;
+  delete packetLog;
   return 0;
 }
 
@@ -6,6 +6,11 @@
 #include "ns3/applications-module.h"
 #include "ns3/flow-monitor-module.h"
 
+#include "cached-propagation-loss.h"
+#include "duty-cycled-udp-client.h"
+#include "flow-attribution-index.h"
+#include "tdma-net-device.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("TdmaDuplex2Bs");
@@ -17,60 +22,109 @@ const uint32_t kPacketSize = 1024;
 const std::string kDataRate = "2Mbps";
 
 int main(int argc, char *argv[]) {
+    uint32_t numUes = kNumUes;
+    double simDuration = kSimDuration;
+    bool staticLossTable = true;
+    bool useTdmaMac = false;
+
     CommandLine cmd;
+    cmd.AddValue("numUes", "Number of UE nodes", numUes);
+    cmd.AddValue("simDuration", "Total simulation duration (seconds)", simDuration);
+    cmd.AddValue("staticLossTable", "Serve the (static) propagation loss from a precomputed table", staticLossTable);
+    cmd.AddValue("useTdmaMac", "Use the contention-free TDMA MAC instead of 802.11g", useTdmaMac);
     cmd.Parse(argc, argv);
 
     NodeContainer bsNodes, ueNodes;
     bsNodes.Create(2);       // 2 BS
-    ueNodes.Create(kNumUes); // total UEs
-
-    // WiFi Channel + PHY
-    YansWifiChannelHelper channel = YansWifiChannelHelper::Default();
-    YansWifiPhyHelper phy;
-    phy.SetChannel(channel.Create());
-
-    WifiHelper wifi;
-    wifi.SetStandard(WIFI_STANDARD_80211g);
-    WifiMacHelper mac;
+    ueNodes.Create(numUes); // total UEs
 
     // Split UEs into 2 groups
-    uint32_t half = kNumUes / 2;
-
-    // AP for BS1
-    Ssid ssid1 = Ssid("tdma-bs1");
-    mac.SetType("ns3::ApWifiMac", "Ssid", SsidValue(ssid1));
-    NetDeviceContainer bsDev1 = wifi.Install(phy, mac, bsNodes.Get(0));
-
-    // AP for BS2
-    Ssid ssid2 = Ssid("tdma-bs2");
-    mac.SetType("ns3::ApWifiMac", "Ssid", SsidValue(ssid2));
-    NetDeviceContainer bsDev2 = wifi.Install(phy, mac, bsNodes.Get(1));
-
-    // UEs for BS1
+    uint32_t half = numUes / 2;
     NodeContainer ueGroup1;
     for (uint32_t i = 0; i < half; i++) {
         ueGroup1.Add(ueNodes.Get(i));
     }
-    mac.SetType("ns3::StaWifiMac",
-                "Ssid", SsidValue(ssid1),
-                "ActiveProbing", BooleanValue(false));
-    NetDeviceContainer ueDev1 = wifi.Install(phy, mac, ueGroup1);
-
-    // UEs for BS2
     NodeContainer ueGroup2;
-    for (uint32_t i = half; i < kNumUes; i++) {
+    for (uint32_t i = half; i < numUes; i++) {
         ueGroup2.Add(ueNodes.Get(i));
     }
-    mac.SetType("ns3::StaWifiMac",
-                "Ssid", SsidValue(ssid2),
-                "ActiveProbing", BooleanValue(false));
-    NetDeviceContainer ueDev2 = wifi.Install(phy, mac, ueGroup2);
+
+    NetDeviceContainer bsDev1, bsDev2, ueDev1, ueDev2;
+    Ptr<TdmaSlotScheduler> slotScheduler;
+    Ptr<CachedPropagationLossModel> lossTable;  // filled once mobility is installed
+    if (useTdmaMac) {
+        // Native TDMA MAC on the slot layout of the clients below: UE i of a
+        // group owns the uplink slot 2i and the downlink slot 2i + 1 of the
+        // frame of its BS, and both BSs run their frames in parallel
+        slotScheduler = CreateObject<TdmaSlotScheduler>();
+        slotScheduler->SetAttribute("SlotDuration", TimeValue(Seconds(kSlotDuration)));
+        slotScheduler->SetAttribute("GuardTime", TimeValue(Seconds(0.0)));
+        slotScheduler->SetAttribute("ParallelGroups", BooleanValue(true));
+        slotScheduler->SetPolicy(CreateObject<TdmaRoundRobinPolicy>());
+
+        TdmaHelper tdma;
+        tdma.SetDeviceAttribute("DataRate", DataRateValue(DataRate("11Mbps")));
+        Ptr<TdmaChannel> tdmaChannel = tdma.CreateChannel();
+
+        bsDev1 = tdma.Install(bsNodes.Get(0), tdmaChannel);
+        bsDev2 = tdma.Install(bsNodes.Get(1), tdmaChannel);
+        ueDev1 = tdma.Install(ueGroup1, tdmaChannel);
+        ueDev2 = tdma.Install(ueGroup2, tdmaChannel);
+        auto assignGroup = [&](uint32_t group, Ptr<NetDevice> bsDev, const NetDeviceContainer& ueDevs) {
+            for (uint32_t i = 0; i < ueDevs.GetN(); i++) {
+                uint32_t ue = slotScheduler->AddUe(group);
+                tdma.AssignSlot(ueDevs.Get(i), slotScheduler, ue, TDMA_UPLINK);
+                tdma.AssignSlot(bsDev, slotScheduler, ue, TDMA_DOWNLINK, ueDevs.Get(i));
+            }
+        };
+        assignGroup(0, bsDev1.Get(0), ueDev1);
+        assignGroup(1, bsDev2.Get(0), ueDev2);
+    } else {
+        // WiFi Channel + PHY
+        YansWifiChannelHelper channel = YansWifiChannelHelper::Default();
+        YansWifiPhyHelper phy;
+        if (staticLossTable) {
+            lossTable = CreateObject<CachedPropagationLossModel>();
+            phy.SetChannel(CreateStaticWifiChannel(lossTable));
+        } else {
+            phy.SetChannel(channel.Create());
+        }
+
+        WifiHelper wifi;
+        wifi.SetStandard(WIFI_STANDARD_80211g);
+        WifiMacHelper mac;
+
+        // AP for BS1
+        Ssid ssid1 = Ssid("tdma-bs1");
+        mac.SetType("ns3::ApWifiMac", "Ssid", SsidValue(ssid1));
+        bsDev1 = wifi.Install(phy, mac, bsNodes.Get(0));
+
+        // AP for BS2
+        Ssid ssid2 = Ssid("tdma-bs2");
+        mac.SetType("ns3::ApWifiMac", "Ssid", SsidValue(ssid2));
+        bsDev2 = wifi.Install(phy, mac, bsNodes.Get(1));
+
+        // UEs for BS1
+        mac.SetType("ns3::StaWifiMac",
+                    "Ssid", SsidValue(ssid1),
+                    "ActiveProbing", BooleanValue(false));
+        ueDev1 = wifi.Install(phy, mac, ueGroup1);
+
+        // UEs for BS2
+        mac.SetType("ns3::StaWifiMac",
+                    "Ssid", SsidValue(ssid2),
+                    "ActiveProbing", BooleanValue(false));
+        ueDev2 = wifi.Install(phy, mac, ueGroup2);
+    }
 
     // Mobility
     MobilityHelper mobility;
     mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
     mobility.Install(bsNodes);
     mobility.Install(ueNodes);
+    if (lossTable) {
+        lossTable->Precompute(NodeContainer(bsNodes, ueNodes));
+    }
 
     // Internet stack
     InternetStackHelper internet;
@@ -86,6 +140,10 @@ int main(int argc, char *argv[]) {
     Ipv4InterfaceContainer ifBs2 = ipv4.Assign(bsDev2);
     Ipv4InterfaceContainer ifUe2 = ipv4.Assign(ueDev2);
 
+    if (useTdmaMac) {
+        TdmaHelper::PopulateNeighbours();
+    }
+
     uint16_t uplinkPort = 5000;
     uint16_t downlinkPort = 5001;
 
@@ -93,108 +151,90 @@ int main(int argc, char *argv[]) {
     UdpServerHelper server1(uplinkPort);
     ApplicationContainer serverApp1 = server1.Install(bsNodes.Get(0));
     serverApp1.Start(Seconds(0.0));
-    serverApp1.Stop(Seconds(kSimDuration));
+    serverApp1.Stop(Seconds(simDuration));
 
     UdpServerHelper server2(uplinkPort);
     ApplicationContainer serverApp2 = server2.Install(bsNodes.Get(1));
     serverApp2.Start(Seconds(0.0));
-    serverApp2.Stop(Seconds(kSimDuration));
+    serverApp2.Stop(Seconds(simDuration));
 
     // Install servers on UEs (downlink receivers)
     ApplicationContainer ueServers;
-    for (uint32_t i = 0; i < kNumUes; i++) {
+    for (uint32_t i = 0; i < numUes; i++) {
         UdpServerHelper ueServer(downlinkPort);
         auto app = ueServer.Install(ueNodes.Get(i));
         app.Start(Seconds(0.0));
-        app.Stop(Seconds(kSimDuration));
+        app.Stop(Seconds(simDuration));
         ueServers.Add(app);
     }
 
-    // TDMA clients
+    // TDMA clients: one duty-cycled client per UE and direction. UE i of a
+    // group owns the uplink slot 2i and the downlink slot 2i + 1 of every
+    // cycle of its BS; both BSs run their cycles in parallel. With an odd
+    // numUes the second group has one UE more and a cycle two slots longer.
     ApplicationContainer allClients;
 
-    // UEs for BS1
-    for (uint32_t i = 0; i < half; i++) {
-        double t = i * 2 * kSlotDuration;
-        while (t < kSimDuration) {
-            // Uplink: UE -> BS1
-            UdpClientHelper uplink(ifBs1.GetAddress(0), uplinkPort);
-            uplink.SetAttribute("PacketSize", UintegerValue(kPacketSize));
-            uplink.SetAttribute("Interval", TimeValue(Seconds(0.01)));
-            uplink.SetAttribute("MaxPackets", UintegerValue(100000));
-
-            auto uplinkApp = uplink.Install(ueNodes.Get(i));
-            uplinkApp.Start(Seconds(t));
-            uplinkApp.Stop(Seconds(t + kSlotDuration));
-            allClients.Add(uplinkApp);
+    auto installGroup = [&](const NodeContainer& ues, Ptr<Node> bs, Ipv4Address bsAddr,
+                            const Ipv4InterfaceContainer& ueIfs) {
+        const Time cycle = Seconds(2 * kSlotDuration * ues.GetN());
+        for (uint32_t i = 0; i < ues.GetN(); i++) {
+            Time uplinkOffset = Seconds(i * 2 * kSlotDuration);
 
-            // Downlink: BS1 -> UE
-            UdpClientHelper downlink(ifUe1.GetAddress(i), downlinkPort);
-            downlink.SetAttribute("PacketSize", UintegerValue(kPacketSize));
-            downlink.SetAttribute("Interval", TimeValue(Seconds(0.01)));
-            downlink.SetAttribute("MaxPackets", UintegerValue(100000));
-
-            auto downlinkApp = downlink.Install(bsNodes.Get(0));
-            downlinkApp.Start(Seconds(t + kSlotDuration));
-            downlinkApp.Stop(Seconds(t + 2 * kSlotDuration));
-            allClients.Add(downlinkApp);
-
-            t += 2 * kSlotDuration * half; // cycle over group
-        }
-    }
-
-    // UEs for BS2
-    for (uint32_t i = 0; i < half; i++) {
-        double t = i * 2 * kSlotDuration;
-        while (t < kSimDuration) {
-            // Uplink: UE -> BS2
-            UdpClientHelper uplink(ifBs2.GetAddress(0), uplinkPort);
+            // Uplink: UE -> BS
+            DutyCycledUdpClientHelper uplink(bsAddr, uplinkPort);
             uplink.SetAttribute("PacketSize", UintegerValue(kPacketSize));
             uplink.SetAttribute("Interval", TimeValue(Seconds(0.01)));
             uplink.SetAttribute("MaxPackets", UintegerValue(100000));
+            uplink.SetPeriodicWindows(uplinkOffset, Seconds(kSlotDuration), cycle);
+            allClients.Add(uplink.Install(ues.Get(i)));
 
-            auto uplinkApp = uplink.Install(ueNodes.Get(half + i));
-            uplinkApp.Start(Seconds(t));
-            uplinkApp.Stop(Seconds(t + kSlotDuration));
-            allClients.Add(uplinkApp);
-
-            // Downlink: BS2 -> UE
-            UdpClientHelper downlink(ifUe2.GetAddress(i), downlinkPort);
+            // Downlink: BS -> UE
+            DutyCycledUdpClientHelper downlink(ueIfs.GetAddress(i), downlinkPort);
             downlink.SetAttribute("PacketSize", UintegerValue(kPacketSize));
             downlink.SetAttribute("Interval", TimeValue(Seconds(0.01)));
             downlink.SetAttribute("MaxPackets", UintegerValue(100000));
+            downlink.SetPeriodicWindows(uplinkOffset + Seconds(kSlotDuration), Seconds(kSlotDuration), cycle);
+            allClients.Add(downlink.Install(bs));
+        }
+    };
 
-            auto downlinkApp = downlink.Install(bsNodes.Get(1));
-            downlinkApp.Start(Seconds(t + kSlotDuration));
-            downlinkApp.Stop(Seconds(t + 2 * kSlotDuration));
-            allClients.Add(downlinkApp);
+    installGroup(ueGroup1, bsNodes.Get(0), ifBs1.GetAddress(0), ifUe1);  // UEs for BS1
+    installGroup(ueGroup2, bsNodes.Get(1), ifBs2.GetAddress(0), ifUe2);  // UEs for BS2
 
-            t += 2 * kSlotDuration * half;
-        }
+    allClients.Start(Seconds(0.0));
+    allClients.Stop(Seconds(simDuration));
+    if (slotScheduler) {
+        slotScheduler->Start(Seconds(0.0));
     }
 
     // Flow monitor
     FlowMonitorHelper flowmon;
     Ptr<FlowMonitor> monitor = flowmon.InstallAll();
 
-    Simulator::Stop(Seconds(kSimDuration));
+    Simulator::Stop(Seconds(simDuration));
     Simulator::Run();
+    std::cout << "Executed events: " << Simulator::GetEventCount() << std::endl;
 
     Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
-    auto stats = monitor->GetFlowStats();
+    const auto& stats = monitor->GetFlowStats();
+
+    // Address -> (UE, BS) index, built once
+    FlowAttributionIndex attribution(classifier);
+    attribution.AddUes(ifUe1, 0, 0);
+    attribution.AddUes(ifUe2, half, 1);
+    attribution.AddBss(ifBs1, 0);
+    attribution.AddBss(ifBs2, 1);
+    attribution.SetPortDirection(uplinkPort, FLOW_UPLINK);
+    attribution.SetPortDirection(downlinkPort, FLOW_DOWNLINK);
 
     std::ofstream outFile("tdma_2bs_results.csv");
     outFile << "FlowId,BS,Src,Dest,Delay(s),Jitter(s),Throughput(bps),LossRate(%)\n";
 
     for (auto &flow : stats) {
-        auto t = classifier->FindFlow(flow.first);
+        const FlowAttribution& a = attribution.Classify(flow.first);
+        const Ipv4FlowClassifier::FiveTuple& t = a.tuple;
 
-        std::string bsId = "Unknown";
-        if (t.sourceAddress == ifBs1.GetAddress(0) || t.destinationAddress == ifBs1.GetAddress(0)) {
-            bsId = "BS1";
-        } else if (t.sourceAddress == ifBs2.GetAddress(0) || t.destinationAddress == ifBs2.GetAddress(0)) {
-            bsId = "BS2";
-        }
+        std::string bsId = a.bs != FlowAttribution::NONE ? "BS" + std::to_string(a.bs + 1) : "Unknown";
 
         double delay = flow.second.rxPackets > 0 ? flow.second.delaySum.GetSeconds() / flow.second.rxPackets : 0;
         double jitter = flow.second.rxPackets > 0 ? flow.second.jitterSum.GetSeconds() / flow.second.rxPackets : 0;
@@ -0,0 +1,383 @@
+#ifndef ADAPTIVE_TDD_CONTROLLER_H
+#define ADAPTIVE_TDD_CONTROLLER_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/nr-module.h"
+
+#include "nr-pdcp-traces.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+// Switches the TDD pattern of every cell among a list of candidates to follow
+// the UL/DL backlog.
+//  - UL: the buffer sizes of the latest BSR of every UE, as received by the
+//    gNB MAC (GnbMacRxedCtrlMsgsTrace), i.e. the backlog the UL scheduler
+//    itself works with.
+//  - DL: the RLC queues of the gNB are not exposed, so every UE's queue is
+//    rebuilt from the PDCP PDUs handed to RLC, minus the PDUs RLC dropped
+//    because its transmit buffer was full (TxDrop), minus the new-data
+//    transport blocks of the MAC DlScheduling trace; retransmissions carry
+//    no new bytes and are skipped. A TB larger than the estimate means the
+//    queue was emptied (the rest is RLC/MAC headers and padding), so that
+//    UE's estimate restarts from zero instead of going negative. Every
+//    Period the estimates are clamped to the RLC transmit buffer size
+//    (MaxDlQueue), which no queue can exceed, so header bytes that were
+//    never matched cannot pile up.
+//
+// Every Period the UL share of the backlog, smoothed with an EWMA, is
+// compared with the UL share of the candidate patterns (F slots count half).
+// The cell moves to the closest candidate only when that brings it more than
+// Hysteresis closer to the backlog than the current pattern and the current
+// pattern has been in use for MinDwell, so queue noise does not make the
+// pattern flap. The new pattern is given to the gNB PHYs and the PHYs of the
+// UEs attached to the cell at the next pattern-period boundary, in the last
+// slot of the old period. The MAC schedules up to L1L2CtrlLatency plus the
+// K1/K2 delays ahead, so the first slots of the new period were allocated
+// under the old pattern; all candidates, and the pattern the gNBs start
+// with, must therefore have the same length and share their first
+// DrainSlots slots, which Install checks. DrainSlots has to cover that
+// scheduling lead. The PHYs are assumed to start slot 0 at t=0.
+class AdaptiveTddController : public Object {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::AdaptiveTddController")
+            .SetParent<Object>()
+            .SetGroupName("Nr")
+            .AddConstructor<AdaptiveTddController>()
+            .AddAttribute("Patterns",
+                          "Candidate TDD patterns separated by ';'",
+                          StringValue("DL|DL|F|UL|DL|DL|DL|DL|F|UL|;"
+                                      "DL|DL|F|UL|DL|F|UL|UL|DL|UL|;"
+                                      "DL|DL|F|UL|UL|F|UL|UL|UL|UL|"),
+                          MakeStringAccessor(&AdaptiveTddController::SetPatterns),
+                          MakeStringChecker())
+            .AddAttribute("Period",
+                          "Interval between two decisions, one frame by default",
+                          TimeValue(MilliSeconds(10)),
+                          MakeTimeAccessor(&AdaptiveTddController::m_period),
+                          MakeTimeChecker())
+            .AddAttribute("Hysteresis",
+                          "UL share a candidate must gain over the current pattern to be used",
+                          DoubleValue(0.1),
+                          MakeDoubleAccessor(&AdaptiveTddController::m_hysteresis),
+                          MakeDoubleChecker<double>(0.0, 1.0))
+            .AddAttribute("MinDwell",
+                          "Minimum time a pattern stays in use",
+                          TimeValue(MilliSeconds(100)),
+                          MakeTimeAccessor(&AdaptiveTddController::m_minDwell),
+                          MakeTimeChecker())
+            .AddAttribute("Smoothing",
+                          "EWMA weight of the latest UL backlog share",
+                          DoubleValue(0.3),
+                          MakeDoubleAccessor(&AdaptiveTddController::m_smoothing),
+                          MakeDoubleChecker<double>(0.0, 1.0))
+            .AddAttribute("DrainSlots",
+                          "Leading slots all patterns share; must cover the MAC scheduling lead",
+                          UintegerValue(4),
+                          MakeUintegerAccessor(&AdaptiveTddController::m_drainSlots),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("MaxDlQueue",
+                          "Bound (bytes) of a UE's DL queue estimate, 0 for the NrRlcUm MaxTxBufferSize default",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&AdaptiveTddController::m_maxDlQueue),
+                          MakeUintegerChecker<uint32_t>())
+            .AddTraceSource("PatternChange",
+                            "A cell switched its TDD pattern (cell id, old pattern, new pattern)",
+                            MakeTraceSourceAccessor(&AdaptiveTddController::m_patternChange),
+                            "ns3::AdaptiveTddController::PatternChangeCallback");
+        return tid;
+    }
+
+    typedef void (*PatternChangeCallback)(uint16_t cellId, const std::string& from, const std::string& to);
+
+    AdaptiveTddController()
+        : m_hysteresis(0.1),
+          m_smoothing(0.3),
+          m_drainSlots(4),
+          m_maxDlQueue(0),
+          m_switches(0) {}
+
+    // Hooks the MAC traces of the gNBs. The UEs are only needed to find the
+    // PHYs of a cell.
+    void Install(const NetDeviceContainer& gnbDevs, const NetDeviceContainer& ueDevs) {
+        NS_ABORT_MSG_IF(m_candidates.empty(), "No candidate TDD patterns");
+        for (const Candidate& c : m_candidates) {
+            CheckCompatible(c.slots, c.pattern);
+        }
+        if (m_maxDlQueue == 0) {
+            // Includes a Config::SetDefault of the scenario
+            TypeId::AttributeInformation info;
+            NS_ABORT_MSG_UNLESS(TypeId::LookupByName("ns3::NrRlcUm").LookupAttributeByName("MaxTxBufferSize", &info),
+                                "NrRlcUm has no MaxTxBufferSize, set MaxDlQueue");
+            m_maxDlQueue = DynamicCast<const UintegerValue>(info.initialValue)->Get();
+        }
+        for (uint32_t i = 0; i < ueDevs.GetN(); ++i) {
+            m_ueOfNode[ueDevs.Get(i)->GetNode()->GetId()] = DynamicCast<NrUeNetDevice>(ueDevs.Get(i));
+        }
+        for (uint32_t i = 0; i < gnbDevs.GetN(); ++i) {
+            Ptr<NrGnbNetDevice> gnb = DynamicCast<NrGnbNetDevice>(gnbDevs.Get(i));
+            NS_ASSERT_MSG(gnb, "Not an NR gNB device");
+            Cell cell;
+            cell.gnb = gnb;
+            StringValue pattern;
+            gnb->GetPhy(0)->GetAttribute("Pattern", pattern);
+            cell.pattern = pattern.Get();
+            std::vector<LteNrTddSlotType> slots = Parse(cell.pattern);
+            CheckCompatible(slots, cell.pattern);
+            cell.ulShare = UlShare(slots);
+            cell.ulBacklogShare = cell.ulShare;
+            cell.next = 0;
+            m_cellOfNode[gnb->GetNode()->GetId()] = m_cells.size();
+            for (uint32_t bwp = 0; bwp < gnb->GetCcMapSize(); ++bwp) {
+                NS_ABORT_MSG_IF(gnb->GetPhy(bwp)->GetSlotPeriod() != gnb->GetPhy(0)->GetSlotPeriod(),
+                                "The BWPs of a cell must share the slot period to switch TDD patterns");
+                gnb->GetMac(bwp)->TraceConnectWithoutContext(
+                    "DlScheduling", MakeBoundCallback(&AdaptiveTddController::DlScheduled, this, m_cells.size()));
+                gnb->GetMac(bwp)->TraceConnectWithoutContext(
+                    "GnbMacRxedCtrlMsgsTrace",
+                    MakeBoundCallback(&AdaptiveTddController::CtrlReceived, this, m_cells.size()));
+            }
+            m_cells.push_back(cell);
+        }
+    }
+
+    // The PDCP entities exist once the bearers are set up, so start when the
+    // traffic does
+    void Start(Time at) {
+        Simulator::Schedule(at, &AdaptiveTddController::Connect, this);
+    }
+
+    uint32_t GetNSwitches(void) const { return m_switches; }
+
+protected:
+    void DoDispose(void) override {
+        Simulator::Cancel(m_event);
+        for (Cell& cell : m_cells) {
+            Simulator::Cancel(cell.switchEvent);
+        }
+        m_cells.clear();
+        m_ueOfNode.clear();
+        Object::DoDispose();
+    }
+
+private:
+    struct Cell {
+        Ptr<NrGnbNetDevice> gnb;
+        std::string pattern;
+        double ulShare;         // of the pattern in use
+        double ulBacklogShare;  // EWMA
+        std::map<uint16_t, double> dlQueue;     // RNTI -> estimated RLC bytes
+        std::map<uint16_t, uint32_t> ulBuffer;  // RNTI -> bytes of the latest BSR
+        Time lastSwitch;
+        uint32_t next;          // candidate of switchEvent
+        EventId switchEvent;    // pending switch at the next period boundary
+    };
+
+    struct Candidate {
+        std::string pattern;
+        std::vector<LteNrTddSlotType> slots;
+        double ulShare;
+    };
+
+    void SetPatterns(std::string patterns) {
+        m_candidates.clear();
+        std::stringstream ss(patterns);
+        std::string pattern;
+        while (std::getline(ss, pattern, ';')) {
+            if (!pattern.empty()) {
+                std::vector<LteNrTddSlotType> slots = Parse(pattern);
+                m_candidates.push_back({pattern, slots, UlShare(slots)});
+            }
+        }
+    }
+
+    static std::vector<LteNrTddSlotType> Parse(const std::string& pattern) {
+        static const std::map<std::string, LteNrTddSlotType> types = {
+            {"DL", LteNrTddSlotType::DL}, {"UL", LteNrTddSlotType::UL},
+            {"S", LteNrTddSlotType::S}, {"F", LteNrTddSlotType::F}};
+        std::vector<LteNrTddSlotType> slots;
+        std::stringstream ss(pattern);
+        std::string slot;
+        while (std::getline(ss, slot, '|')) {
+            if (slot.empty()) {
+                continue;
+            }
+            auto it = types.find(slot);
+            NS_ABORT_MSG_IF(it == types.end(), "Unknown TDD slot type " << slot << " in " << pattern);
+            slots.push_back(it->second);
+        }
+        return slots;
+    }
+
+    // Fraction of the data slots usable for UL
+    static double UlShare(const std::vector<LteNrTddSlotType>& slots) {
+        double ul = 0.0;
+        double data = 0.0;
+        for (LteNrTddSlotType s : slots) {
+            if (s == LteNrTddSlotType::UL) {
+                ul += 1.0;
+                data += 1.0;
+            } else if (s == LteNrTddSlotType::F) {
+                ul += 0.5;
+                data += 1.0;
+            } else if (s == LteNrTddSlotType::DL) {
+                data += 1.0;
+            }
+        }
+        return data > 0 ? ul / data : 0.0;
+    }
+
+    // Aborts unless slots can replace the candidates at a period boundary
+    void CheckCompatible(const std::vector<LteNrTddSlotType>& slots, const std::string& pattern) const {
+        const std::vector<LteNrTddSlotType>& first = m_candidates[0].slots;
+        NS_ABORT_MSG_IF(slots.size() != first.size() || slots.size() < m_drainSlots ||
+                            !std::equal(first.begin(), first.begin() + m_drainSlots, slots.begin()),
+                        "TDD pattern " << pattern << " must have the length and the first " << m_drainSlots
+                                       << " slots of " << m_candidates[0].pattern);
+    }
+
+    void Connect(void) {
+        ConnectNrPdcpTrace("TxPDU", MakeCallback(&AdaptiveTddController::PdcpTx, this), NR_PDCP_GNB);
+        ConnectNrRlcTrace("TxDrop", MakeCallback(&AdaptiveTddController::RlcDrop, this), NR_PDCP_GNB);
+        for (Cell& cell : m_cells) {
+            cell.lastSwitch = Simulator::Now();
+        }
+        m_event = Simulator::ScheduleNow(&AdaptiveTddController::Evaluate, this);
+    }
+
+    void PdcpTx(std::string context, uint16_t rnti, uint8_t lcid, uint32_t size) {
+        auto cell = m_cellOfNode.find(NodeOfContext(context));
+        if (cell != m_cellOfNode.end()) {
+            m_cells[cell->second].dlQueue[rnti] += size;
+        }
+    }
+
+    // A PDCP PDU the RLC transmit buffer had no room for
+    void RlcDrop(std::string context, Ptr<const Packet> pdu) {
+        auto cell = m_cellOfNode.find(NodeOfContext(context));
+        if (cell != m_cellOfNode.end()) {
+            double& queue = m_cells[cell->second].dlQueue[IndexOfContext(context, "UeMap")];
+            queue = pdu->GetSize() < queue ? queue - pdu->GetSize() : 0.0;
+        }
+    }
+
+    static void DlScheduled(AdaptiveTddController* controller, uint32_t cell, NrSchedulingCallbackInfo info) {
+        if (info.m_rv != 0) {
+            return;
+        }
+        double& queue = controller->m_cells[cell].dlQueue[info.m_rnti];
+        queue = info.m_tbSize < queue ? queue - info.m_tbSize : 0.0;
+    }
+
+    static void CtrlReceived(AdaptiveTddController* controller, uint32_t cell, SfnSf sfn, uint16_t nodeId,
+                             uint16_t rnti, uint8_t bwpId, Ptr<const NrControlMessage> msg) {
+        if (msg->GetMessageType() != NrControlMessage::BSR) {
+            return;
+        }
+        auto bsr = DynamicCast<NrBsrMessage>(ConstCast<NrControlMessage>(msg))->GetBsr();
+        uint32_t bytes = 0;
+        for (uint8_t level : bsr.m_macCeValue.m_bufferStatus) {
+            bytes += NrMacShortBsrCe::FromLevelToBytes(level);
+        }
+        controller->m_cells[cell].ulBuffer[bsr.m_rnti] = bytes;
+    }
+
+    void Evaluate(void) {
+        for (Cell& cell : m_cells) {
+            double dl = 0.0;
+            for (auto& entry : cell.dlQueue) {
+                entry.second = std::min<double>(entry.second, m_maxDlQueue);
+                dl += entry.second;
+            }
+            double ul = 0.0;
+            for (const auto& entry : cell.ulBuffer) {
+                ul += entry.second;
+            }
+            if (dl + ul > 0) {
+                cell.ulBacklogShare += m_smoothing * (ul / (dl + ul) - cell.ulBacklogShare);
+            }
+
+            const Candidate* best = &m_candidates[0];
+            for (const Candidate& c : m_candidates) {
+                if (std::abs(c.ulShare - cell.ulBacklogShare) < std::abs(best->ulShare - cell.ulBacklogShare)) {
+                    best = &c;
+                }
+            }
+            double gain = std::abs(cell.ulShare - cell.ulBacklogShare) - std::abs(best->ulShare - cell.ulBacklogShare);
+            if (best->pattern != cell.pattern && gain > m_hysteresis && !cell.switchEvent.IsPending() &&
+                Simulator::Now() - cell.lastSwitch >= m_minDwell) {
+                ScheduleSwitch(cell, static_cast<uint32_t>(best - &m_candidates[0]));
+            }
+        }
+        m_event = Simulator::Schedule(m_period, &AdaptiveTddController::Evaluate, this);
+    }
+
+    // Switches at the start of the next pattern period. The PHYs schedule
+    // their next slot one slot ahead, so with more than a slot of lead the
+    // switch runs before the first slot of the new period starts.
+    void ScheduleSwitch(Cell& cell, uint32_t candidate) {
+        int64_t slot = cell.gnb->GetPhy(0)->GetSlotPeriod().GetNanoSeconds();
+        int64_t period = slot * m_candidates[candidate].slots.size();
+        int64_t now = Simulator::Now().GetNanoSeconds();
+        int64_t delay = (now / period + 1) * period - now;
+        if (delay <= slot) {
+            delay += period;
+        }
+        cell.next = candidate;
+        cell.switchEvent = Simulator::Schedule(NanoSeconds(delay), &AdaptiveTddController::Apply, this,
+                                               static_cast<uint32_t>(&cell - &m_cells[0]));
+    }
+
+    void Apply(uint32_t index) {
+        Cell& cell = m_cells[index];
+        const Candidate& candidate = m_candidates[cell.next];
+        NS_ASSERT_MSG(cell.gnb->GetPhy(0)->GetCurrentSfnSf().Normalize() % candidate.slots.size() ==
+                          candidate.slots.size() - 1,
+                      "TDD pattern switch outside the last slot of a period");
+        for (uint32_t bwp = 0; bwp < cell.gnb->GetCcMapSize(); ++bwp) {
+            cell.gnb->GetPhy(bwp)->SetTddPattern(candidate.slots);
+        }
+        uint16_t cellId = cell.gnb->GetCellId();
+        for (const auto& entry : m_ueOfNode) {
+            Ptr<NrUeNetDevice> ue = entry.second;
+            if (ue->GetRrc()->GetCellId() == cellId) {
+                for (uint32_t bwp = 0; bwp < ue->GetCcMapSize(); ++bwp) {
+                    ue->GetPhy(bwp)->SetTddPattern(candidate.slots);
+                }
+            }
+        }
+        m_patternChange(cellId, cell.pattern, candidate.pattern);
+        cell.pattern = candidate.pattern;
+        cell.ulShare = candidate.ulShare;
+        cell.lastSwitch = Simulator::Now();
+        m_switches++;
+    }
+
+    std::vector<Candidate> m_candidates;
+    Time m_period;
+    double m_hysteresis;
+    Time m_minDwell;
+    double m_smoothing;
+    uint32_t m_drainSlots;
+    uint32_t m_maxDlQueue;
+    std::vector<Cell> m_cells;
+    std::map<uint32_t, uint32_t> m_cellOfNode;
+    std::map<uint32_t, Ptr<NrUeNetDevice>> m_ueOfNode;
+    EventId m_event;
+    uint32_t m_switches;
+    TracedCallback<uint16_t, const std::string&, const std::string&> m_patternChange;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(AdaptiveTddController);
+
+} // namespace ns3
+
+#endif // ADAPTIVE_TDD_CONTROLLER_H
@@ -0,0 +1,328 @@
+#ifndef BATCHED_WAYPOINT_MOBILITY_H
+#define BATCHED_WAYPOINT_MOBILITY_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace ns3 {
+
+class WaypointBatch;
+
+// Per-node view of a WaypointBatch. It holds no state of its own besides its
+// index, so position and velocity queries go to the batch.
+class BatchedWaypointMobilityModel : public MobilityModel {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::BatchedWaypointMobilityModel")
+            .SetParent<MobilityModel>()
+            .SetGroupName("Mobility")
+            .AddConstructor<BatchedWaypointMobilityModel>();
+        return tid;
+    }
+
+    BatchedWaypointMobilityModel() : m_index(0) {}
+
+    void Bind(Ptr<WaypointBatch> batch, uint32_t index) {
+        m_batch = batch;
+        m_index = index;
+    }
+
+    // Called by the batch when a new leg of this node has started
+    void CourseChanged(void) const { NotifyCourseChange(); }
+
+protected:
+    void DoDispose(void) override {
+        m_batch = nullptr;
+        MobilityModel::DoDispose();
+    }
+
+private:
+    Vector DoGetPosition(void) const override;
+    void DoSetPosition(const Vector& position) override;
+    Vector DoGetVelocity(void) const override;
+
+    Ptr<WaypointBatch> m_batch;
+    uint32_t m_index;
+};
+
+// Random waypoint movement of a group of nodes, kept in one
+// structure-of-arrays container: the current leg of every node (start,
+// velocity, start time, travel time, end of the following pause) lives in
+// parallel arrays. A query advances and interpolates only the node asked
+// for, and caches its position for the rest of that simulation time. Once
+// BatchFraction of the nodes have been queried at the same time, as when a
+// broadcast reaches every PHY or NetAnim polls all nodes, the remaining ones
+// are advanced too and all positions are interpolated in one branch-free
+// loop over the arrays, which the compiler vectorises.
+//
+// Legs follow SteadyStateRandomWaypointMobilityModel's parameters (uniform
+// destination in the rectangle, uniform speed and pause). The steady-state
+// start is approximated by starting every node paused at a uniform position
+// for a uniform part of MaxPause. Course changes are notified when a leg is
+// advanced, i.e. on the first query after it started.
+//
+// Every node draws its legs from its own random stream, so its walk does not
+// depend on when, in which order or in which batch the nodes are evaluated
+// (NetAnim polling, culled channels, BatchFraction).
+class WaypointBatch : public Object {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::WaypointBatch")
+            .SetParent<Object>()
+            .SetGroupName("Mobility")
+            .AddConstructor<WaypointBatch>()
+            .AddAttribute("MinX", "Minimum X of the area", DoubleValue(0.0),
+                          MakeDoubleAccessor(&WaypointBatch::m_minX), MakeDoubleChecker<double>())
+            .AddAttribute("MaxX", "Maximum X of the area", DoubleValue(100.0),
+                          MakeDoubleAccessor(&WaypointBatch::m_maxX), MakeDoubleChecker<double>())
+            .AddAttribute("MinY", "Minimum Y of the area", DoubleValue(0.0),
+                          MakeDoubleAccessor(&WaypointBatch::m_minY), MakeDoubleChecker<double>())
+            .AddAttribute("MaxY", "Maximum Y of the area", DoubleValue(100.0),
+                          MakeDoubleAccessor(&WaypointBatch::m_maxY), MakeDoubleChecker<double>())
+            .AddAttribute("Z", "Height of all nodes", DoubleValue(0.0),
+                          MakeDoubleAccessor(&WaypointBatch::m_z), MakeDoubleChecker<double>())
+            .AddAttribute("MinSpeed", "Minimum speed (m/s)", DoubleValue(0.3),
+                          MakeDoubleAccessor(&WaypointBatch::m_minSpeed), MakeDoubleChecker<double>(0.001))
+            .AddAttribute("MaxSpeed", "Maximum speed (m/s)", DoubleValue(0.7),
+                          MakeDoubleAccessor(&WaypointBatch::m_maxSpeed), MakeDoubleChecker<double>(0.001))
+            .AddAttribute("MinPause", "Minimum pause (s)", DoubleValue(0.0),
+                          MakeDoubleAccessor(&WaypointBatch::m_minPause), MakeDoubleChecker<double>(0.0))
+            .AddAttribute("MaxPause", "Maximum pause (s)", DoubleValue(0.0),
+                          MakeDoubleAccessor(&WaypointBatch::m_maxPause), MakeDoubleChecker<double>(0.0))
+            .AddAttribute("BatchFraction",
+                          "Fraction of the nodes queried at one time after which all nodes are evaluated at once",
+                          DoubleValue(0.25),
+                          MakeDoubleAccessor(&WaypointBatch::m_batchFraction), MakeDoubleChecker<double>(0.0, 1.0));
+        return tid;
+    }
+
+    WaypointBatch()
+        : m_queryTime(-1.0),
+          m_queries(0) {}
+
+    // Gives every node a BatchedWaypointMobilityModel backed by this batch
+    void Install(const NodeContainer& nodes) {
+        for (auto it = nodes.Begin(); it != nodes.End(); ++it) {
+            uint32_t i = m_models.size();
+            m_rngs.push_back(CreateObject<UniformRandomVariable>());
+            m_sx.push_back(0.0);
+            m_sy.push_back(0.0);
+            m_tx.push_back(0.0);
+            m_ty.push_back(0.0);
+            m_vx.push_back(0.0);
+            m_vy.push_back(0.0);
+            m_t0.push_back(0.0);
+            m_travel.push_back(0.0);
+            m_legEnd.push_back(0.0);
+            m_x.push_back(0.0);
+            m_y.push_back(0.0);
+            m_at.push_back(-1.0);
+            InitNode(i);
+
+            Ptr<BatchedWaypointMobilityModel> model = CreateObject<BatchedWaypointMobilityModel>();
+            model->Bind(this, i);
+            (*it)->AggregateObject(model);
+            m_models.push_back(PeekPointer(model));
+        }
+    }
+
+    // Gives node i stream + i and draws its start again from that stream.
+    // Call after Install() and before the nodes move.
+    int64_t AssignStreams(int64_t stream) {
+        for (uint32_t i = 0; i < m_rngs.size(); ++i) {
+            NS_ASSERT_MSG(m_at[i] < 0.0, "WaypointBatch::AssignStreams after node " << i << " was queried");
+            m_rngs[i]->SetStream(stream + i);
+            InitNode(i);
+        }
+        return m_rngs.size();
+    }
+
+    uint32_t GetN(void) const { return m_models.size(); }
+
+    Vector GetPosition(uint32_t i) {
+        Evaluate(i);
+        return Vector(m_x[i], m_y[i], m_z);
+    }
+
+    Vector GetVelocity(uint32_t i) {
+        Evaluate(i);
+        if (m_at[i] >= m_t0[i] + m_travel[i]) {
+            return Vector(0.0, 0.0, 0.0);
+        }
+        return Vector(m_vx[i], m_vy[i], 0.0);
+    }
+
+    // Moves node i to the given position, where it starts a new leg
+    void SetPosition(uint32_t i, const Vector& position) {
+        double now = Simulator::Now().GetSeconds();
+        m_sx[i] = m_tx[i] = position.x;
+        m_sy[i] = m_ty[i] = position.y;
+        m_vx[i] = m_vy[i] = 0.0;
+        m_t0[i] = now;
+        m_travel[i] = 0.0;
+        m_legEnd[i] = now;
+        m_at[i] = -1.0;
+        m_models[i]->CourseChanged();
+    }
+
+protected:
+    void DoDispose(void) override {
+        m_models.clear();
+        m_rngs.clear();
+        Object::DoDispose();
+    }
+
+private:
+    // Brings node i up to the current time, or every node once enough of
+    // them have been queried at this time
+    void Evaluate(uint32_t i) {
+        double now = Simulator::Now().GetSeconds();
+        if (m_at[i] == now) {
+            return;
+        }
+        if (now != m_queryTime) {
+            m_queryTime = now;
+            m_queries = 0;
+        }
+        if (++m_queries > m_batchFraction * m_models.size()) {
+            EvaluateAll(now);
+            return;
+        }
+
+        bool changed = now >= m_legEnd[i];
+        while (now >= m_legEnd[i]) {
+            NextLeg(i);
+        }
+        double dt = std::min(std::max(now - m_t0[i], 0.0), m_travel[i]);
+        m_x[i] = m_sx[i] + m_vx[i] * dt;
+        m_y[i] = m_sy[i] + m_vy[i] * dt;
+        m_at[i] = now;
+
+        // Listeners may query the position again; they get the cached value
+        if (changed) {
+            m_models[i]->CourseChanged();
+        }
+    }
+
+    void EvaluateAll(double now) {
+        m_changed.clear();
+        uint32_t n = m_models.size();
+        for (uint32_t i = 0; i < n; ++i) {
+            if (m_at[i] != now && now >= m_legEnd[i]) {
+                while (now >= m_legEnd[i]) {
+                    NextLeg(i);
+                }
+                m_changed.push_back(i);
+            }
+        }
+
+        Interpolate(now);
+        std::fill(m_at.begin(), m_at.end(), now);
+
+        for (uint32_t i : m_changed) {
+            m_models[i]->CourseChanged();
+        }
+    }
+
+    // Node i paused at a uniform position for a uniform part of MaxPause
+    void InitNode(uint32_t i) {
+        double now = Simulator::Now().GetSeconds();
+        UniformRandomVariable& rng = *m_rngs[i];
+        double x = rng.GetValue(m_minX, m_maxX);
+        double y = rng.GetValue(m_minY, m_maxY);
+        m_sx[i] = m_tx[i] = m_x[i] = x;
+        m_sy[i] = m_ty[i] = m_y[i] = y;
+        m_vx[i] = m_vy[i] = 0.0;
+        m_t0[i] = now;
+        m_travel[i] = 0.0;
+        m_legEnd[i] = now + rng.GetValue(0.0, m_maxPause);
+    }
+
+    void NextLeg(uint32_t i) {
+        UniformRandomVariable& rng = *m_rngs[i];
+        double start = m_legEnd[i];
+        m_sx[i] = m_tx[i];
+        m_sy[i] = m_ty[i];
+        m_tx[i] = rng.GetValue(m_minX, m_maxX);
+        m_ty[i] = rng.GetValue(m_minY, m_maxY);
+        double speed = rng.GetValue(m_minSpeed, m_maxSpeed);
+        double dx = m_tx[i] - m_sx[i];
+        double dy = m_ty[i] - m_sy[i];
+        double travel = std::sqrt(dx * dx + dy * dy) / speed;
+        m_vx[i] = travel > 0.0 ? dx / travel : 0.0;
+        m_vy[i] = travel > 0.0 ? dy / travel : 0.0;
+        m_t0[i] = start;
+        m_travel[i] = travel;
+        m_legEnd[i] = start + travel + rng.GetValue(m_minPause, m_maxPause);
+    }
+
+    void Interpolate(double now) {
+        uint32_t n = m_models.size();
+        const double* __restrict sx = m_sx.data();
+        const double* __restrict sy = m_sy.data();
+        const double* __restrict vx = m_vx.data();
+        const double* __restrict vy = m_vy.data();
+        const double* __restrict t0 = m_t0.data();
+        const double* __restrict travel = m_travel.data();
+        double* __restrict x = m_x.data();
+        double* __restrict y = m_y.data();
+        for (uint32_t i = 0; i < n; ++i) {
+            double dt = std::min(std::max(now - t0[i], 0.0), travel[i]);
+            x[i] = sx[i] + vx[i] * dt;
+            y[i] = sy[i] + vy[i] * dt;
+        }
+    }
+
+    double m_minX;
+    double m_maxX;
+    double m_minY;
+    double m_maxY;
+    double m_z;
+    double m_minSpeed;
+    double m_maxSpeed;
+    double m_minPause;
+    double m_maxPause;
+    double m_batchFraction;
+
+    std::vector<BatchedWaypointMobilityModel*> m_models;   // owned by their nodes
+    std::vector<Ptr<UniformRandomVariable>> m_rngs;        // one stream per node
+
+    // Current leg of every node
+    std::vector<double> m_sx, m_sy;       // start
+    std::vector<double> m_tx, m_ty;       // destination
+    std::vector<double> m_vx, m_vy;       // velocity while travelling
+    std::vector<double> m_t0;             // start time
+    std::vector<double> m_travel;         // travel time
+    std::vector<double> m_legEnd;         // end of the pause at the destination
+
+    // Position of every node at m_at
+    std::vector<double> m_x, m_y;
+    std::vector<double> m_at;
+    double m_queryTime;                   // time of the m_queries node evaluations
+    uint32_t m_queries;
+    std::vector<uint32_t> m_changed;
+};
+
+inline Vector BatchedWaypointMobilityModel::DoGetPosition(void) const {
+    return m_batch->GetPosition(m_index);
+}
+
+inline void BatchedWaypointMobilityModel::DoSetPosition(const Vector& position) {
+    m_batch->SetPosition(m_index, position);
+}
+
+inline Vector BatchedWaypointMobilityModel::DoGetVelocity(void) const {
+    return m_batch->GetVelocity(m_index);
+}
+
+NS_OBJECT_ENSURE_REGISTERED(BatchedWaypointMobilityModel);
+NS_OBJECT_ENSURE_REGISTERED(WaypointBatch);
+
+} // namespace ns3
+
+#endif // BATCHED_WAYPOINT_MOBILITY_H
@@ -0,0 +1,191 @@
+#ifndef BEARER_PROVISIONING_H
+#define BEARER_PROVISIONING_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/nr-module.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+// Table driven set-up of dedicated bearers. A rule maps a range of UEs and a
+// range of ports to a QCI; the ports are the UE's local port in downlink and
+// the remote port in uplink, so one range covers both directions of a flow.
+// Activate gives every UE one bearer per QCI its rules map it to, with one
+// range filter per rule and direction, and UEs matched by the same rules
+// share a single TFT. With flows numbered by port this is one bearer per UE
+// and QCI instead of one per UE, flow and direction.
+class NrBearerProvisioner {
+public:
+    struct Rule {
+        uint32_t firstUe;
+        uint32_t lastUe;        // inclusive
+        uint16_t firstPort;
+        uint16_t lastPort;      // inclusive
+        NrEpsBearer::Qci qci;
+        NrEpcTft::Direction direction;
+    };
+
+    NrBearerProvisioner() : m_nTfts(0) {}
+
+    void AddRule(uint32_t firstUe, uint32_t lastUe, uint16_t firstPort, uint16_t lastPort,
+                 NrEpsBearer::Qci qci, NrEpcTft::Direction direction = NrEpcTft::BIDIRECTIONAL) {
+        NS_ABORT_MSG_IF(firstUe > lastUe || firstPort > lastPort, "Empty bearer rule");
+        m_rules.push_back({firstUe, lastUe, firstPort, lastPort, qci, direction});
+    }
+
+    // Adds the rules of a "ues:ports:qci" list separated by ';', where ues
+    // and ports are "first-last" or a single value and qci is the 3GPP
+    // number, e.g. "0-49:1234-1236:80;50-99:1234:1". Every rule filters the
+    // given direction. A field that is not a number, a port above 65535 or a
+    // QCI NrEpsBearer does not define aborts the run.
+    void AddRules(const std::string& table, NrEpcTft::Direction direction = NrEpcTft::BIDIRECTIONAL) {
+        std::stringstream rules(table);
+        std::string rule;
+        while (std::getline(rules, rule, ';')) {
+            if (rule.empty()) {
+                continue;
+            }
+            std::stringstream fields(rule);
+            std::string ues;
+            std::string ports;
+            std::string qci;
+            NS_ABORT_MSG_IF(!std::getline(fields, ues, ':') || !std::getline(fields, ports, ':') ||
+                                !std::getline(fields, qci),
+                            "Bad bearer rule " << rule);
+            uint32_t firstUe;
+            uint32_t lastUe;
+            uint32_t firstPort;
+            uint32_t lastPort;
+            ParseRange(ues, rule, firstUe, lastUe);
+            ParseRange(ports, rule, firstPort, lastPort);
+            NS_ABORT_MSG_IF(std::max(firstPort, lastPort) > 65535, "Port out of range in bearer rule " << rule);
+            AddRule(firstUe, lastUe, firstPort, lastPort, ParseQci(qci, rule), direction);
+        }
+    }
+
+    uint32_t GetNRules(void) const { return m_rules.size(); }
+    uint32_t GetNTfts(void) const { return m_nTfts; }
+
+    // Activates the bearers of every UE of ueDevs, numbered in container
+    // order, and returns how many were activated
+    uint32_t Activate(Ptr<NrHelper> helper, const NetDeviceContainer& ueDevs) {
+        std::map<std::vector<uint32_t>, Ptr<NrEpcTft>> tfts;
+        uint32_t bearers = 0;
+        for (uint32_t ue = 0; ue < ueDevs.GetN(); ++ue) {
+            // Rules of this UE per QCI, in table order
+            std::map<NrEpsBearer::Qci, std::vector<uint32_t>> byQci;
+            for (uint32_t r = 0; r < m_rules.size(); ++r) {
+                if (ue >= m_rules[r].firstUe && ue <= m_rules[r].lastUe) {
+                    byQci[m_rules[r].qci].push_back(r);
+                }
+            }
+            for (const auto& entry : byQci) {
+                Ptr<NrEpcTft>& tft = tfts[entry.second];
+                if (!tft) {
+                    CheckFilterCount(entry.first, entry.second);
+                    tft = MakeTft(entry.second);
+                }
+                helper->ActivateDedicatedEpsBearer(ueDevs.Get(ue), NrEpsBearer(entry.first), tft);
+                bearers++;
+            }
+        }
+        m_nTfts = tfts.size();
+        return bearers;
+    }
+
+private:
+    // QCI of its 3GPP number; only the values NrEpsBearer defines are accepted
+    static NrEpsBearer::Qci ParseQci(const std::string& value, const std::string& rule) {
+        static const NrEpsBearer::Qci known[] = {
+            NrEpsBearer::GBR_CONV_VOICE,          NrEpsBearer::GBR_CONV_VIDEO,
+            NrEpsBearer::GBR_GAMING,              NrEpsBearer::GBR_NON_CONV_VIDEO,
+            NrEpsBearer::GBR_MC_PUSH_TO_TALK,     NrEpsBearer::GBR_NMC_PUSH_TO_TALK,
+            NrEpsBearer::GBR_MC_VIDEO,            NrEpsBearer::GBR_V2X,
+            NrEpsBearer::NGBR_IMS,                NrEpsBearer::NGBR_VIDEO_TCP_OPERATOR,
+            NrEpsBearer::NGBR_VOICE_VIDEO_GAMING, NrEpsBearer::NGBR_VIDEO_TCP_PREMIUM,
+            NrEpsBearer::NGBR_VIDEO_TCP_DEFAULT,  NrEpsBearer::NGBR_MC_DELAY_SIGNAL,
+            NrEpsBearer::NGBR_MC_DATA,            NrEpsBearer::NGBR_V2X,
+            NrEpsBearer::NGBR_LOW_LAT_EMBB,       NrEpsBearer::DGBR_DISCRETE_AUT_SMALL,
+            NrEpsBearer::DGBR_DISCRETE_AUT_LARGE, NrEpsBearer::DGBR_ITS,
+            NrEpsBearer::DGBR_ELECTRICITY,
+        };
+        unsigned long number = ParseNumber(value, rule);
+        auto it = std::find_if(std::begin(known), std::end(known),
+                               [number](NrEpsBearer::Qci q) { return static_cast<unsigned long>(q) == number; });
+        NS_ABORT_MSG_IF(it == std::end(known), "Unknown QCI " << value << " in bearer rule " << rule);
+        return *it;
+    }
+
+    static void ParseRange(const std::string& range, const std::string& rule, uint32_t& first, uint32_t& last) {
+        std::size_t dash = range.find('-');
+        first = ParseNumber(range.substr(0, dash), rule);
+        last = dash == std::string::npos ? first : ParseNumber(range.substr(dash + 1), rule);
+    }
+
+    // Whole decimal field, at most 32 bits
+    static uint32_t ParseNumber(const std::string& field, const std::string& rule) {
+        const char* begin = field.c_str();
+        char* end = nullptr;
+        errno = 0;
+        unsigned long value = std::strtoul(begin, &end, 10);
+        NS_ABORT_MSG_IF(!std::isdigit(static_cast<unsigned char>(begin[0])) || *end != '\0' || errno == ERANGE ||
+                            value > 0xffffffffUL,
+                        "Bad number \"" << field << "\" in bearer rule " << rule);
+        return value;
+    }
+
+    // NrEpcTft holds at most 16 packet filters; a bidirectional rule takes two
+    void CheckFilterCount(NrEpsBearer::Qci qci, const std::vector<uint32_t>& rules) const {
+        uint32_t filters = 0;
+        uint32_t firstUe = 0;
+        uint32_t lastUe = 0xffffffff;
+        for (uint32_t r : rules) {
+            filters += ((m_rules[r].direction & NrEpcTft::DOWNLINK) ? 1 : 0) +
+                       ((m_rules[r].direction & NrEpcTft::UPLINK) ? 1 : 0);
+            firstUe = std::max(firstUe, m_rules[r].firstUe);
+            lastUe = std::min(lastUe, m_rules[r].lastUe);
+        }
+        NS_ABORT_MSG_IF(filters > 16, "UEs " << firstUe << "-" << lastUe << " need " << filters
+                                             << " packet filters for QCI " << static_cast<uint32_t>(qci)
+                                             << " from " << rules.size()
+                                             << " bearer rules, a TFT holds at most 16");
+    }
+
+    Ptr<NrEpcTft> MakeTft(const std::vector<uint32_t>& rules) const {
+        Ptr<NrEpcTft> tft = Create<NrEpcTft>();
+        for (uint32_t r : rules) {
+            const Rule& rule = m_rules[r];
+            if (rule.direction & NrEpcTft::DOWNLINK) {
+                NrEpcTft::PacketFilter dl;
+                dl.direction = NrEpcTft::DOWNLINK;
+                dl.localPortStart = rule.firstPort;
+                dl.localPortEnd = rule.lastPort;
+                tft->Add(dl);
+            }
+            if (rule.direction & NrEpcTft::UPLINK) {
+                NrEpcTft::PacketFilter ul;
+                ul.direction = NrEpcTft::UPLINK;
+                ul.remotePortStart = rule.firstPort;
+                ul.remotePortEnd = rule.lastPort;
+                tft->Add(ul);
+            }
+        }
+        return tft;
+    }
+
+    std::vector<Rule> m_rules;
+    uint32_t m_nTfts;
+};
+
+} // namespace ns3
+
+#endif // BEARER_PROVISIONING_H
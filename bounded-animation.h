@@ -0,0 +1,201 @@
+#ifndef BOUNDED_ANIMATION_H
+#define BOUNDED_ANIMATION_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/netanim-module.h"
+
+#include "config-context.h"
+
+#include <cstdio>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+// Keeps a NetAnim trace small enough for production-size runs: the XML only
+// covers the window [start, stop), where every packet is written with its
+// metadata, and node positions are polled every mobilityPollInterval instead
+// of every 250 ms. The packets of selected UEs over the whole run are followed
+// by a SampledPacketLog, which also counts them per node in the XML.
+inline void ConfigureBoundedAnimation(AnimationInterface& anim, Time mobilityPollInterval, Time start,
+                                      Time stop) {
+    anim.SetMobilityPollInterval(mobilityPollInterval);
+    anim.SetStartTime(start);
+    anim.SetStopTime(stop);
+    anim.EnablePacketMetadata(true);
+}
+
+// Parses a comma separated list of UE indices ("0,4,17"); empty means all
+inline std::vector<uint32_t> ParseUeList(const std::string& list, uint32_t numUes) {
+    std::vector<uint32_t> ues;
+    if (list.empty()) {
+        for (uint32_t i = 0; i < numUes; ++i) {
+            ues.push_back(i);
+        }
+        return ues;
+    }
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        uint32_t ue = std::stoul(item);
+        NS_ABORT_MSG_IF(ue >= numUes, "UE " << ue << " does not exist");
+        ues.push_back(ue);
+    }
+    return ues;
+}
+
+// Compact IP-level packet log for selected UEs, kept next to a bounded
+// NetAnim trace. Only packets whose uid is a multiple of SampleEvery are
+// written, so a sampled packet is recorded at every traced node it passes.
+// The UEs are traced with TraceUe and their BSs with TraceServingNode, which
+// only records the packets of the traced UEs; a sampled packet is then seen
+// both where it is sent and where it is received.
+//
+// Records ("time,node,event,uid,bytes") go to numbered chunk files that are
+// rotated every RecordsPerChunk records and, when compression is on, piped
+// through gzip while being written. With SetAnimation, every sampled packet
+// also bumps a "Sampled Tx"/"Sampled Rx" node counter in the NetAnim XML.
+class SampledPacketLog {
+public:
+    SampledPacketLog(const std::string& prefix, uint32_t sampleEvery, uint64_t recordsPerChunk, bool compress)
+        : m_prefix(prefix),
+          m_sampleEvery(sampleEvery > 0 ? sampleEvery : 1),
+          m_recordsPerChunk(recordsPerChunk),
+          m_compress(compress),
+          m_file(nullptr),
+          m_chunk(0),
+          m_records(0),
+          m_anim(nullptr),
+          m_txCounter(0),
+          m_rxCounter(0) {}
+
+    ~SampledPacketLog() { CloseChunk(); }
+
+    // Mirrors the sampled packets into per-node counters of anim, which must
+    // outlive the log
+    void SetAnimation(AnimationInterface* anim) {
+        m_anim = anim;
+        m_txCounter = anim->AddNodeCounter("Sampled Tx", AnimationInterface::UINT32_COUNTER);
+        m_rxCounter = anim->AddNodeCounter("Sampled Rx", AnimationInterface::UINT32_COUNTER);
+    }
+
+    // Records the packets the UE sends and receives, here and at the nodes
+    // traced with TraceServingNode
+    void TraceUe(Ptr<Node> ue) {
+        Ptr<Ipv4> ipv4 = ue->GetObject<Ipv4>();
+        NS_ABORT_MSG_IF(!ipv4, "UE " << ue->GetId() << " has no IPv4 stack yet");
+        for (uint32_t i = 0; i < ipv4->GetNInterfaces(); ++i) {
+            for (uint32_t a = 0; a < ipv4->GetNAddresses(i); ++a) {
+                Ipv4Address address = ipv4->GetAddress(i, a).GetLocal();
+                if (!address.IsLocalhost()) {
+                    m_ueAddresses.insert(address);
+                }
+            }
+        }
+        TraceNode(ue);
+    }
+
+    // Records, at a BS, the packets of the UEs traced with TraceUe
+    void TraceServingNode(Ptr<Node> node) {
+        TraceNode(node);
+    }
+
+    void TraceServingNodes(const NodeContainer& nodes) {
+        for (auto it = nodes.Begin(); it != nodes.End(); ++it) {
+            TraceServingNode(*it);
+        }
+    }
+
+private:
+    void TraceNode(Ptr<Node> node) {
+        std::string path = "/NodeList/" + std::to_string(node->GetId()) + "/$ns3::Ipv4L3Protocol/";
+        Config::ConnectFailSafe(path + "Tx", MakeCallback(&SampledPacketLog::IpTx, this));
+        Config::ConnectFailSafe(path + "Rx", MakeCallback(&SampledPacketLog::IpRx, this));
+    }
+
+    void IpTx(std::string context, Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface) {
+        Record(context, 't', packet);
+    }
+
+    void IpRx(std::string context, Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface) {
+        Record(context, 'r', packet);
+    }
+
+    void Record(const std::string& context, char event, Ptr<const Packet> packet) {
+        if (packet->GetUid() % m_sampleEvery != 0) {
+            return;
+        }
+        // The Ipv4L3Protocol Tx and Rx traces carry the IP header
+        Ipv4Header header;
+        packet->PeekHeader(header);
+        if (m_ueAddresses.count(header.GetSource()) == 0 && m_ueAddresses.count(header.GetDestination()) == 0) {
+            return;
+        }
+        if (!m_file || (m_recordsPerChunk > 0 && m_records >= m_recordsPerChunk)) {
+            OpenChunk();
+        }
+        uint32_t node = NodeOfContext(context);
+        std::fprintf(m_file, "%.9f,%u,%c,%llu,%u\n", Simulator::Now().GetSeconds(), node,
+                     event, static_cast<unsigned long long>(packet->GetUid()), packet->GetSize());
+        m_records++;
+        if (m_anim) {
+            if (event == 't') {
+                m_anim->UpdateNodeCounter(m_txCounter, node, ++m_sampledTx[node]);
+            } else {
+                m_anim->UpdateNodeCounter(m_rxCounter, node, ++m_sampledRx[node]);
+            }
+        }
+    }
+
+    void OpenChunk(void) {
+        CloseChunk();
+        char index[16];
+        std::snprintf(index, sizeof(index), "-%04u.csv", m_chunk++);
+        std::string name = m_prefix + index;
+        if (m_compress) {
+            name += ".gz";
+            m_file = popen(("gzip -c > '" + name + "'").c_str(), "w");
+        } else {
+            m_file = std::fopen(name.c_str(), "w");
+        }
+        NS_ABORT_MSG_IF(!m_file, "Cannot open packet log chunk " << name);
+        std::setvbuf(m_file, nullptr, _IOFBF, 1 << 16);
+        std::fputs("time,node,event,uid,bytes\n", m_file);
+        m_records = 0;
+    }
+
+    void CloseChunk(void) {
+        if (!m_file) {
+            return;
+        }
+        if (m_compress) {
+            pclose(m_file);
+        } else {
+            std::fclose(m_file);
+        }
+        m_file = nullptr;
+    }
+
+    std::string m_prefix;
+    uint32_t m_sampleEvery;
+    uint64_t m_recordsPerChunk;
+    bool m_compress;
+    FILE* m_file;
+    uint32_t m_chunk;
+    uint64_t m_records;
+    std::set<Ipv4Address> m_ueAddresses;
+    AnimationInterface* m_anim;
+    uint32_t m_txCounter;
+    uint32_t m_rxCounter;
+    std::map<uint32_t, uint32_t> m_sampledTx;   // by node id
+    std::map<uint32_t, uint32_t> m_sampledRx;
+};
+
+} // namespace ns3
+
+#endif // BOUNDED_ANIMATION_H
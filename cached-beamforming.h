@@ -0,0 +1,256 @@
+#ifndef CACHED_BEAMFORMING_H
+#define CACHED_BEAMFORMING_H
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/spectrum-module.h"
+#include "ns3/antenna-module.h"
+#include "ns3/beamforming-vector.h"
+#include "ns3/ideal-beamforming-algorithm.h"
+#include "ns3/nr-spectrum-phy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <map>
+#include <tuple>
+
+namespace ns3 {
+
+// CellScanBeamforming with a per-link beam cache, re-evaluated incrementally.
+// On every beamforming update of a gNB-UE link:
+//  - a UE that has not moved since the last update keeps its beam pair;
+//  - a UE that moved less than MovementThreshold since the last exhaustive
+//    search gets a local coarse-then-fine refinement around its cached pair:
+//    a sweep with CoarseFactor times the angle step over the neighbouring
+//    sectors and elevations, then a full-resolution sweep around the best
+//    coarse beam, for the gNB and the UE beam each in its own window;
+//  - a UE that moved further, or a link seen for the first time, gets the
+//    exhaustive CellScanBeamforming sweep.
+// Exhaustive results are also kept per quantized relative position (at most
+// MaxPositionEntries, oldest dropped first), so a UE coming back to an
+// already visited spot, or a static UE after a re-attach, reuses the search.
+class CachedCellScanBeamforming : public CellScanBeamforming {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::CachedCellScanBeamforming")
+            .SetParent<CellScanBeamforming>()
+            .SetGroupName("Nr")
+            .AddConstructor<CachedCellScanBeamforming>()
+            .AddAttribute("MovementThreshold",
+                          "Distance (m) a UE has to move before its beams are searched again",
+                          DoubleValue(2.0),
+                          MakeDoubleAccessor(&CachedCellScanBeamforming::m_movementThreshold),
+                          MakeDoubleChecker<double>(0.0))
+            .AddAttribute("PositionQuantum",
+                          "Grid size (m) of the relative positions used as cache keys",
+                          DoubleValue(1.0),
+                          MakeDoubleAccessor(&CachedCellScanBeamforming::m_positionQuantum),
+                          MakeDoubleChecker<double>(0.01))
+            .AddAttribute("CoarseFactor",
+                          "Angle step multiplier of the coarse pass of a local refinement",
+                          UintegerValue(4),
+                          MakeUintegerAccessor(&CachedCellScanBeamforming::m_coarseFactor),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("MaxPositionEntries",
+                          "Maximum number of exhaustive searches kept by relative position",
+                          UintegerValue(4096),
+                          MakeUintegerAccessor(&CachedCellScanBeamforming::m_maxPositionEntries),
+                          MakeUintegerChecker<uint32_t>(1));
+        return tid;
+    }
+
+    CachedCellScanBeamforming()
+        : m_movementThreshold(2.0),
+          m_positionQuantum(1.0),
+          m_coarseFactor(4),
+          m_maxPositionEntries(4096),
+          m_hits(0),
+          m_refinements(0),
+          m_searches(0) {}
+
+    BeamformingVectorPair GetBeamformingVectors(const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                                                const Ptr<NrSpectrumPhy>& ueSpectrumPhy) const override {
+        Vector rel = ueSpectrumPhy->GetMobility()->GetPosition() - gnbSpectrumPhy->GetMobility()->GetPosition();
+        LinkKey link(PeekPointer(gnbSpectrumPhy), PeekPointer(ueSpectrumPhy));
+
+        auto it = m_links.find(link);
+        if (it != m_links.end() && CalculateDistance(rel, it->second.searchedAt) <= m_movementThreshold) {
+            LinkEntry& entry = it->second;
+            if (CalculateDistance(rel, entry.updatedAt) == 0.0) {
+                m_hits++;
+                return entry.vectors;
+            }
+            m_refinements++;
+            entry.vectors = LocalSearch(gnbSpectrumPhy, ueSpectrumPhy, entry.vectors);
+            entry.updatedAt = rel;
+            return entry.vectors;
+        }
+
+        PositionKey key(link.first, link.second, Quantize(rel.x), Quantize(rel.y), Quantize(rel.z));
+        auto cached = m_byPosition.find(key);
+        if (cached != m_byPosition.end()) {
+            m_hits++;
+            m_links[link] = {rel, rel, cached->second};
+            return cached->second;
+        }
+
+        m_searches++;
+        BeamformingVectorPair vectors = CellScanBeamforming::GetBeamformingVectors(gnbSpectrumPhy, ueSpectrumPhy);
+        if (m_byPosition.size() >= m_maxPositionEntries) {
+            m_byPosition.erase(m_positionOrder.front());
+            m_positionOrder.pop_front();
+        }
+        m_byPosition[key] = vectors;
+        m_positionOrder.push_back(key);
+        m_links[link] = {rel, rel, vectors};
+        return vectors;
+    }
+
+    uint64_t GetCacheHits(void) const { return m_hits; }
+    uint64_t GetRefinements(void) const { return m_refinements; }
+    uint64_t GetSearches(void) const { return m_searches; }
+
+    void ClearCache(void) {
+        m_links.clear();
+        m_byPosition.clear();
+        m_positionOrder.clear();
+    }
+
+protected:
+    void DoDispose(void) override {
+        ClearCache();
+        CellScanBeamforming::DoDispose();
+    }
+
+private:
+    typedef std::pair<const NrSpectrumPhy*, const NrSpectrumPhy*> LinkKey;
+    typedef std::tuple<const NrSpectrumPhy*, const NrSpectrumPhy*, int64_t, int64_t, int64_t> PositionKey;
+
+    struct LinkEntry {
+        Vector searchedAt;            // relative position of the last exhaustive search
+        Vector updatedAt;             // relative position of the last update
+        BeamformingVectorPair vectors;
+    };
+
+    int64_t Quantize(double v) const { return static_cast<int64_t>(std::floor(v / m_positionQuantum)); }
+
+    // Average received power over the band for one gNB / UE beam combination
+    static double BeamPower(const Ptr<NrSpectrumPhy>& gnbSpectrumPhy, const Ptr<NrSpectrumPhy>& ueSpectrumPhy,
+                            const Ptr<PhasedArraySpectrumPropagationLossModel>& model,
+                            const Ptr<const SpectrumSignalParameters>& txParams) {
+        Ptr<SpectrumSignalParameters> rxParams = model->CalcRxPowerSpectralDensity(
+            txParams, gnbSpectrumPhy->GetMobility(), ueSpectrumPhy->GetMobility(),
+            gnbSpectrumPhy->GetAntenna()->GetObject<PhasedArrayModel>(),
+            ueSpectrumPhy->GetAntenna()->GetObject<PhasedArrayModel>());
+        return Sum(*rxParams->psd) / rxParams->psd->GetSpectrumModel()->GetNumBands();
+    }
+
+    struct Beam {
+        uint16_t sector;
+        double theta;
+    };
+
+    // Elevation and sector range searched for one antenna
+    struct Window {
+        double thetaMin;
+        double thetaMax;
+        uint16_t sectorMin;
+        uint16_t sectorMax;
+    };
+
+    // Window of +-halfWidth degrees and +-sectors around beam, clipped to the
+    // 60..120 degree elevations and 0..numRows sectors of CellScanBeamforming
+    static Window Around(const Beam& beam, double halfWidth, uint16_t sectors, uint16_t numRows) {
+        return {std::max(60.0, beam.theta - halfWidth), std::min(120.0, beam.theta + halfWidth),
+                static_cast<uint16_t>(beam.sector > sectors ? beam.sector - sectors : 0),
+                std::min<uint16_t>(beam.sector + sectors, numRows)};
+    }
+
+    // Best (gNB, UE) beam over a window of each antenna
+    static double Sweep(const Ptr<NrSpectrumPhy>& gnbSpectrumPhy, const Ptr<NrSpectrumPhy>& ueSpectrumPhy,
+                        const Ptr<PhasedArraySpectrumPropagationLossModel>& model,
+                        const Ptr<const SpectrumSignalParameters>& txParams,
+                        const Window& gnbWindow, const Window& ueWindow, double step,
+                        Beam& bestGnb, Beam& bestUe) {
+        Ptr<UniformPlanarArray> gnbAntenna = gnbSpectrumPhy->GetAntenna()->GetObject<UniformPlanarArray>();
+        Ptr<UniformPlanarArray> ueAntenna = ueSpectrumPhy->GetAntenna()->GetObject<UniformPlanarArray>();
+        double best = -1.0;
+        for (double gnbTheta = gnbWindow.thetaMin; gnbTheta <= gnbWindow.thetaMax; gnbTheta += step) {
+            for (uint16_t gnbSector = gnbWindow.sectorMin; gnbSector <= gnbWindow.sectorMax; ++gnbSector) {
+                gnbAntenna->SetBeamformingVector(CreateDirectionalBfv(gnbAntenna, gnbSector, gnbTheta));
+                for (double ueTheta = ueWindow.thetaMin; ueTheta <= ueWindow.thetaMax; ueTheta += step) {
+                    for (uint16_t ueSector = ueWindow.sectorMin; ueSector <= ueWindow.sectorMax; ++ueSector) {
+                        ueAntenna->SetBeamformingVector(CreateDirectionalBfv(ueAntenna, ueSector, ueTheta));
+                        double power = BeamPower(gnbSpectrumPhy, ueSpectrumPhy, model, txParams);
+                        if (power > best) {
+                            best = power;
+                            bestGnb = {gnbSector, gnbTheta};
+                            bestUe = {ueSector, ueTheta};
+                        }
+                    }
+                }
+            }
+        }
+        return best;
+    }
+
+    // Coarse-then-fine search around the beams of a cached pair
+    BeamformingVectorPair LocalSearch(const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                                      const Ptr<NrSpectrumPhy>& ueSpectrumPhy,
+                                      const BeamformingVectorPair& cached) const {
+        Ptr<UniformPlanarArray> gnbAntenna = gnbSpectrumPhy->GetAntenna()->GetObject<UniformPlanarArray>();
+        Ptr<UniformPlanarArray> ueAntenna = ueSpectrumPhy->GetAntenna()->GetObject<UniformPlanarArray>();
+        Ptr<PhasedArraySpectrumPropagationLossModel> model =
+            gnbSpectrumPhy->GetSpectrumChannel()->GetPhasedArraySpectrumPropagationLossModel();
+        NS_ABORT_MSG_IF(!model, "Beam search needs a phased-array spectrum propagation loss model");
+
+        Ptr<SpectrumValue> psd = Create<SpectrumValue>(gnbSpectrumPhy->GetRxSpectrumModel());
+        *psd = 1.0;
+        Ptr<SpectrumSignalParameters> txParams = Create<SpectrumSignalParameters>();
+        txParams->psd = psd;
+
+        DoubleValue stepValue;
+        GetAttribute("BeamSearchAngleStep", stepValue);
+        double step = stepValue.Get();
+        double coarseStep = step * m_coarseFactor;
+        uint16_t gnbSectors = gnbAntenna->GetNumRows();
+        uint16_t ueSectors = ueAntenna->GetNumRows();
+
+        Beam gnb{cached.first.second.GetSector(), cached.first.second.GetElevation()};
+        Beam ue{cached.second.second.GetSector(), cached.second.second.GetElevation()};
+
+        // Coarse: neighbouring sectors, two coarse steps either side
+        Sweep(gnbSpectrumPhy, ueSpectrumPhy, model, txParams,
+              Around(gnb, 2 * coarseStep, 1, gnbSectors), Around(ue, 2 * coarseStep, 1, ueSectors),
+              coarseStep, gnb, ue);
+        // Fine: full resolution, one coarse step either side of each beam
+        Sweep(gnbSpectrumPhy, ueSpectrumPhy, model, txParams,
+              Around(gnb, coarseStep, 0, gnbSectors), Around(ue, coarseStep, 0, ueSectors),
+              step, gnb, ue);
+
+        BeamformingVector gnbBfv(CreateDirectionalBfv(gnbAntenna, gnb.sector, gnb.theta),
+                                 BeamId(gnb.sector, gnb.theta));
+        BeamformingVector ueBfv(CreateDirectionalBfv(ueAntenna, ue.sector, ue.theta),
+                                BeamId(ue.sector, ue.theta));
+        return BeamformingVectorPair(gnbBfv, ueBfv);
+    }
+
+    double m_movementThreshold;
+    double m_positionQuantum;
+    uint32_t m_coarseFactor;
+    uint32_t m_maxPositionEntries;
+
+    mutable std::map<LinkKey, LinkEntry> m_links;
+    mutable std::map<PositionKey, BeamformingVectorPair> m_byPosition;
+    mutable std::deque<PositionKey> m_positionOrder;   // insertion order of m_byPosition
+    mutable uint64_t m_hits;
+    mutable uint64_t m_refinements;
+    mutable uint64_t m_searches;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(CachedCellScanBeamforming);
+
+} // namespace ns3
+
+#endif // CACHED_BEAMFORMING_H
@@ -0,0 +1,164 @@
+#ifndef CACHED_PROPAGATION_LOSS_H
+#define CACHED_PROPAGATION_LOSS_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-module.h"
+#include "ns3/spectrum-module.h"
+#include "ns3/wifi-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+// Propagation loss lookup table for static topologies. The loss of the
+// wrapped model between two mobility models is computed once and kept in a
+// dense matrix, so every later transmission between the same pair costs one
+// hash lookup per end and one array read instead of a pathloss evaluation.
+// Precompute fills the matrix for all pairs of a node set once mobility is
+// installed; nodes it did not cover get an index, and their losses, the first
+// time they are seen.
+//
+// Only valid when nodes do not move and the wrapped model is deterministic,
+// since the loss is assumed to be independent of time and transmit power:
+// e.g. LogDistancePropagationLossModel (the YansWifiChannelHelper default),
+// or ThreeGppPropagationLossModel with shadowing disabled and a channel
+// condition that never changes (an always-LOS or always-NLOS scenario).
+class CachedPropagationLossModel : public PropagationLossModel {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::CachedPropagationLossModel")
+            .SetParent<PropagationLossModel>()
+            .SetGroupName("Propagation")
+            .AddConstructor<CachedPropagationLossModel>()
+            .AddAttribute("Inner",
+                          "The propagation loss model whose results are cached",
+                          PointerValue(),
+                          MakePointerAccessor(&CachedPropagationLossModel::m_inner),
+                          MakePointerChecker<PropagationLossModel>());
+        return tid;
+    }
+
+    CachedPropagationLossModel()
+        : m_size(0),
+          m_capacity(0) {}
+
+    void SetInner(Ptr<PropagationLossModel> inner) {
+        m_inner = inner;
+        m_index.clear();
+        m_loss.clear();
+        m_size = 0;
+        m_capacity = 0;
+    }
+
+    // Fills the matrix for all pairs of the given nodes, which must already
+    // have their mobility models
+    void Precompute(const NodeContainer& nodes) {
+        std::vector<Ptr<MobilityModel>> models;
+        for (auto it = nodes.Begin(); it != nodes.End(); ++it) {
+            Ptr<MobilityModel> m = (*it)->GetObject<MobilityModel>();
+            NS_ABORT_MSG_IF(!m, "Node " << (*it)->GetId() << " has no mobility model");
+            models.push_back(m);
+            Index(m);
+        }
+        for (const auto& a : models) {
+            for (const auto& b : models) {
+                if (a != b) {
+                    Lookup(a, b);
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr double kUnknown = std::numeric_limits<double>::quiet_NaN();
+
+    double DoCalcRxPower(double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const override {
+        return txPowerDbm - Lookup(a, b);
+    }
+
+    int64_t DoAssignStreams(int64_t stream) override {
+        return m_inner ? m_inner->AssignStreams(stream) : 0;
+    }
+
+    uint32_t Index(const Ptr<MobilityModel>& m) const {
+        auto it = m_index.find(PeekPointer(m));
+        if (it != m_index.end()) {
+            return it->second;
+        }
+        uint32_t index = m_size;
+        m_index[PeekPointer(m)] = index;
+        Grow(m_size + 1);
+        return index;
+    }
+
+    // Resizes the square matrix, keeping the entries computed so far
+    void Grow(uint32_t size) const {
+        if (size > m_capacity) {
+            uint32_t newCapacity = std::max(size, m_capacity * 2);
+            std::vector<double> loss(static_cast<size_t>(newCapacity) * newCapacity, kUnknown);
+            for (uint32_t i = 0; i < m_size; ++i) {
+                for (uint32_t j = 0; j < m_size; ++j) {
+                    loss[static_cast<size_t>(i) * newCapacity + j] = m_loss[static_cast<size_t>(i) * m_capacity + j];
+                }
+            }
+            m_loss.swap(loss);
+            m_capacity = newCapacity;
+        }
+        m_size = size;
+    }
+
+    double Lookup(const Ptr<MobilityModel>& a, const Ptr<MobilityModel>& b) const {
+        NS_ABORT_MSG_IF(!m_inner, "CachedPropagationLossModel has no inner model");
+        uint32_t i = Index(a);
+        uint32_t j = Index(b);
+        double& loss = m_loss[static_cast<size_t>(i) * m_capacity + j];
+        if (std::isnan(loss)) {
+            // Loss in dB; reference power 0 dBm
+            loss = -m_inner->CalcRxPower(0.0, a, b);
+        }
+        return loss;
+    }
+
+    Ptr<PropagationLossModel> m_inner;
+    mutable std::unordered_map<const MobilityModel*, uint32_t> m_index;
+    mutable std::vector<double> m_loss;   // row-major, m_capacity x m_capacity
+    mutable uint32_t m_size;
+    mutable uint32_t m_capacity;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(CachedPropagationLossModel);
+
+// YansWifiChannel equivalent to YansWifiChannelHelper::Default() whose
+// log-distance loss is served from the given table
+inline Ptr<YansWifiChannel> CreateStaticWifiChannel(Ptr<CachedPropagationLossModel> loss) {
+    loss->SetInner(CreateObject<LogDistancePropagationLossModel>());
+    Ptr<YansWifiChannel> channel = CreateObject<YansWifiChannel>();
+    channel->SetPropagationLossModel(loss);
+    channel->SetPropagationDelayModel(CreateObject<ConstantSpeedPropagationDelayModel>());
+    return channel;
+}
+
+// Serves the pathloss of a spectrum channel (e.g. the ThreeGppPropagation-
+// LossModel of an NR bandwidth part) from a table; returns the table, the
+// existing one if the channel is shared and already wrapped
+inline Ptr<CachedPropagationLossModel> CacheSpectrumChannelLoss(Ptr<SpectrumChannel> channel) {
+    Ptr<PropagationLossModel> pathloss = channel->GetPropagationLossModel();
+    NS_ABORT_MSG_IF(!pathloss, "The spectrum channel has no propagation loss model");
+    if (Ptr<CachedPropagationLossModel> cached = DynamicCast<CachedPropagationLossModel>(pathloss)) {
+        return cached;
+    }
+    Ptr<CachedPropagationLossModel> loss = CreateObject<CachedPropagationLossModel>();
+    loss->SetInner(pathloss);
+    channel->SetAttribute("PropagationLossModel", PointerValue(loss));
+    return loss;
+}
+
+} // namespace ns3
+
+#endif // CACHED_PROPAGATION_LOSS_H
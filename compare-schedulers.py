@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""Run one NR scenario under several MAC schedulers and compare them.
+
+Every scheduler TypeId is run on the same topology and seed (tdma or tdma2,
+selected with --scenario), one run at a time. Each run writes a scheduler
+report (--schedulerReport) and an event profile (--profileEvents), from which
+the comparison takes
+
+    cell_mbps       throughput of all flows together
+    ue_p5_mbps      5th percentile of the per-UE throughput (DL + UL)
+    delay_p50_ms    median packet delay, from the FlowMonitor histograms
+    delay_p95_ms    95th percentile packet delay
+    gnb_us_per_tti  wall time of the gNB PHY/MAC/scheduler events per slot,
+                    over the whole run (profile and slot count both start at t=0)
+    wall_s          wall-clock time of the whole program
+    peak_rss_mb     peak resident set size of the program
+
+The table is printed and written to <out>/comparison.json, the delay CDFs to
+<out>/delay-cdf.csv (scheduler, delay_s, cdf). gnb_us_per_tti includes the
+gNB PHY work of every slot, which is the same for all schedulers, so compare
+its differences rather than its absolute value.
+
+Examples:
+    ./compare-schedulers.py
+    ./compare-schedulers.py --scenario tdma2 --args="--numUes=20 --simTime=5"
+    ./compare-schedulers.py --schedulers ns3::NrMacSchedulerTdmaRR,ns3::NrMacSchedulerOfdmaPF \\
+        --exe "build/scratch/ns3.44-{name}-optimized"
+
+Programs are started like in run-benchmarks.py: through
+"./ns3 run --no-build scratch/<name>" or, with --exe, from a path pattern.
+"""
+
+import argparse
+import json
+import os
+import re
+import shlex
+import subprocess
+import sys
+import time
+
+SCHEDULERS = [
+    "ns3::NrMacSchedulerTdmaRR",
+    "ns3::NrMacSchedulerTdmaPF",
+    "ns3::NrMacSchedulerTdmaMR",
+    "ns3::NrMacSchedulerTdmaQos",
+    "ns3::NrMacSchedulerOfdmaRR",
+    "ns3::NrMacSchedulerOfdmaPF",
+    "ns3::NrMacSchedulerOfdmaMR",
+    "ns3::NrMacSchedulerOfdmaQos",
+]
+
+# Event targets charged to the gNB slot processing in the profile
+GNB_TARGET_RE = re.compile(r"NrGnbPhy|NrGnbMac|NrMacScheduler")
+PROFILE_ROW_RE = re.compile(r"^\s*[\d.]+\s+([\d.]+)\s+(\d+)\s+[\d.]+\s+[\d.]+\s+(.*)$")
+
+COLUMNS = ["cell_mbps", "ue_p5_mbps", "delay_p50_ms", "delay_p95_ms", "gnb_us_per_tti", "wall_s", "peak_rss_mb"]
+
+
+def build_command(args, name, extra):
+    if args.exe:
+        return [os.path.abspath(args.exe.format(name=name))] + extra, None
+    program = " ".join(["scratch/" + name] + [shlex.quote(a) for a in extra])
+    return [os.path.abspath(args.ns3), "run", "--no-build", program], os.path.dirname(os.path.abspath(args.ns3))
+
+
+def percentile(cdf, q):
+    for edge, fraction in cdf:
+        if fraction >= q:
+            return edge
+    return float("nan")
+
+
+def gnb_seconds(profile_file):
+    seconds = 0.0
+    with open(profile_file) as f:
+        for line in f:
+            match = PROFILE_ROW_RE.match(line)
+            if match and GNB_TARGET_RE.search(match.group(3)):
+                seconds += float(match.group(1))
+    return seconds
+
+
+def run_one(args, scheduler):
+    run_dir = os.path.abspath(os.path.join(args.out, scheduler.split("::")[-1]))
+    # tdma writes its outputs below ./results
+    os.makedirs(os.path.join(run_dir, "results"), exist_ok=True)
+    report = os.path.join(run_dir, "report.json")
+    profile = os.path.join(run_dir, "profile.txt")
+    extra = shlex.split(args.args) + [
+        "--schedulerType=" + scheduler,
+        "--schedulerReport=" + report,
+        "--profileEvents=true",
+        "--ns3::ProfilingSimulatorImpl::OutputFile=" + profile,
+        "--ns3::ProfilingSimulatorImpl::MaxEntries=0",
+    ]
+    cmd, cwd = build_command(args, args.scenario, extra)
+    if cwd is None:
+        cwd = run_dir
+    else:
+        cmd[2:2] = ["--cwd", run_dir]
+
+    start = time.monotonic()
+    with open(os.path.join(run_dir, "stdout.log"), "w") as out, \
+            open(os.path.join(run_dir, "stderr.log"), "w") as err:
+        proc = subprocess.Popen(cmd, cwd=cwd, stdout=out, stderr=err)
+        _, status, usage = os.wait4(proc.pid, 0)
+        rc = os.waitstatus_to_exitcode(status)
+    wall = time.monotonic() - start
+
+    result = {"rc": rc, "wall_s": wall, "peak_rss_mb": usage.ru_maxrss / 1024.0}
+    if rc != 0 or not os.path.exists(report):
+        return result, []
+    with open(report) as f:
+        data = json.load(f)
+    cdf = data["delay_cdf"]
+    result["cell_mbps"] = data["cell_throughput_mbps"]
+    result["ue_p5_mbps"] = data["ue_throughput_p5_mbps"]
+    result["delay_p50_ms"] = 1000.0 * percentile(cdf, 0.5)
+    result["delay_p95_ms"] = 1000.0 * percentile(cdf, 0.95)
+    if os.path.exists(profile) and data["ttis"] > 0:
+        result["gnb_us_per_tti"] = 1e6 * gnb_seconds(profile) / data["ttis"]
+    return result, cdf
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--scenario", choices=["tdma", "tdma2"], default="tdma", help="NR scenario to run")
+    parser.add_argument("--schedulers", default=",".join(SCHEDULERS),
+                        help="comma separated scheduler TypeIds")
+    parser.add_argument("--args", default="", help="extra arguments passed to every run")
+    parser.add_argument("--exe", help="executable path pattern, {name} is the scenario name")
+    parser.add_argument("--ns3", default="./ns3", help="path to the ns3 driver script")
+    parser.add_argument("--out", default="scheduler-comparison", help="output directory")
+    args = parser.parse_args()
+
+    os.makedirs(args.out, exist_ok=True)
+    results = {}
+    failed = False
+    print("%-30s" % "scheduler" + "".join("%15s" % c for c in COLUMNS))
+    with open(os.path.join(args.out, "delay-cdf.csv"), "w") as csv:
+        csv.write("scheduler,delay_s,cdf\n")
+        for scheduler in args.schedulers.split(","):
+            result, cdf = run_one(args, scheduler)
+            results[scheduler] = result
+            if result["rc"] != 0 or "cell_mbps" not in result:
+                failed = True
+                print("%-30s FAILED (exit %d)" % (scheduler, result["rc"]))
+                continue
+            print("%-30s" % scheduler.split("::")[-1]
+                  + "".join("%15.3f" % result.get(c, float("nan")) for c in COLUMNS))
+            for edge, fraction in cdf:
+                csv.write("%s,%g,%g\n" % (scheduler, edge, fraction))
+
+    with open(os.path.join(args.out, "comparison.json"), "w") as f:
+        json.dump({"scenario": args.scenario, "args": args.args, "results": results}, f, indent=2, sort_keys=True)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,27 @@
+#ifndef CONFIG_CONTEXT_H
+#define CONFIG_CONTEXT_H
+
+#include "ns3/abort.h"
+
+#include <cstdint>
+#include <string>
+
+namespace ns3 {
+
+// Node id of a Config::Connect context "/NodeList/<id>/..."
+inline uint32_t NodeOfContext(const std::string& context) {
+    return std::stoul(context.substr(10, context.find('/', 10) - 10));
+}
+
+// Index that follows "/<list>/" in a Config::Connect context, e.g. the RNTI
+// of ".../NrGnbRrc/UeMap/<rnti>/..."
+inline uint32_t IndexOfContext(const std::string& context, const std::string& list) {
+    std::size_t at = context.find("/" + list + "/");
+    NS_ABORT_MSG_IF(at == std::string::npos, "No /" << list << "/ in the trace context " << context);
+    std::size_t begin = at + list.size() + 2;
+    return std::stoul(context.substr(begin, context.find('/', begin) - begin));
+}
+
+} // namespace ns3
+
+#endif // CONFIG_CONTEXT_H
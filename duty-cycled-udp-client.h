@@ -0,0 +1,263 @@
+#ifndef DUTY_CYCLED_UDP_CLIENT_H
+#define DUTY_CYCLED_UDP_CLIENT_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+// UdpClient that only transmits inside its on-windows. The windows are either
+// periodic (Offset, OnDuration, Period) or an explicit list added with
+// AddWindow(), in absolute simulation time. A single application lives for
+// the whole run and keeps one pending event: the next transmission, which is
+// pushed to the start of the next window whenever the current one closes.
+// Packets carry a SeqTsHeader so they are accounted for by UdpServer.
+class DutyCycledUdpClient : public Application {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::DutyCycledUdpClient")
+            .SetParent<Application>()
+            .SetGroupName("Applications")
+            .AddConstructor<DutyCycledUdpClient>()
+            .AddAttribute("RemoteAddress",
+                          "The destination address of the outbound packets",
+                          AddressValue(),
+                          MakeAddressAccessor(&DutyCycledUdpClient::m_peerAddress),
+                          MakeAddressChecker())
+            .AddAttribute("RemotePort",
+                          "The destination port of the outbound packets",
+                          UintegerValue(100),
+                          MakeUintegerAccessor(&DutyCycledUdpClient::m_peerPort),
+                          MakeUintegerChecker<uint16_t>())
+            .AddAttribute("PacketSize",
+                          "Size of the packets, including the 12 bytes of SeqTsHeader",
+                          UintegerValue(1024),
+                          MakeUintegerAccessor(&DutyCycledUdpClient::m_size),
+                          MakeUintegerChecker<uint32_t>(12, 65507))
+            .AddAttribute("Interval",
+                          "Time between two packets inside an on-window",
+                          TimeValue(Seconds(0.01)),
+                          MakeTimeAccessor(&DutyCycledUdpClient::m_interval),
+                          MakeTimeChecker())
+            .AddAttribute("MaxPackets",
+                          "Maximum number of packets over the whole run, 0 for unlimited",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&DutyCycledUdpClient::m_maxPackets),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("Offset",
+                          "Start of the first periodic on-window",
+                          TimeValue(Seconds(0.0)),
+                          MakeTimeAccessor(&DutyCycledUdpClient::m_offset),
+                          MakeTimeChecker())
+            .AddAttribute("OnDuration",
+                          "Length of every periodic on-window, 0 to always transmit",
+                          TimeValue(Seconds(0.0)),
+                          MakeTimeAccessor(&DutyCycledUdpClient::m_onDuration),
+                          MakeTimeChecker())
+            .AddAttribute("Period",
+                          "Time between the starts of two periodic on-windows",
+                          TimeValue(Seconds(0.0)),
+                          MakeTimeAccessor(&DutyCycledUdpClient::m_period),
+                          MakeTimeChecker())
+            .AddTraceSource("Tx",
+                            "A new packet was created and accepted by the socket",
+                            MakeTraceSourceAccessor(&DutyCycledUdpClient::m_txTrace),
+                            "ns3::Packet::TracedCallback");
+        return tid;
+    }
+
+    DutyCycledUdpClient()
+        : m_peerPort(100),
+          m_size(1024),
+          m_maxPackets(0),
+          m_sent(0),
+          m_nextWindow(0) {}
+
+    void SetRemote(Address address, uint16_t port) {
+        m_peerAddress = address;
+        m_peerPort = port;
+    }
+
+    // Periodic windows [offset + k * period, offset + k * period + onDuration),
+    // checked when the application starts
+    void SetPeriodicWindows(Time offset, Time onDuration, Time period) {
+        m_offset = offset;
+        m_onDuration = onDuration;
+        m_period = period;
+    }
+
+    // Explicit window [start, start + duration); once a window is added the
+    // periodic description is ignored
+    void AddWindow(Time start, Time duration) {
+        auto window = std::make_pair(start, start + duration);
+        m_windows.insert(std::upper_bound(m_windows.begin(), m_windows.end(), window), window);
+    }
+
+    uint64_t GetTotalTx(void) const { return m_sent; }
+
+protected:
+    void DoDispose(void) override {
+        m_socket = nullptr;
+        Application::DoDispose();
+    }
+
+private:
+    void StartApplication(void) override {
+        // The windows may have been set through the attributes as well
+        NS_ABORT_MSG_IF(m_windows.empty() && !m_period.IsZero() && m_onDuration > m_period,
+                        "DutyCycledUdpClient: OnDuration " << m_onDuration.As(Time::S)
+                            << " longer than Period " << m_period.As(Time::S));
+        if (!m_socket) {
+            TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
+            m_socket = Socket::CreateSocket(GetNode(), tid);
+            if (Ipv4Address::IsMatchingType(m_peerAddress)) {
+                m_socket->Bind();
+                m_socket->Connect(InetSocketAddress(Ipv4Address::ConvertFrom(m_peerAddress), m_peerPort));
+            } else if (Ipv6Address::IsMatchingType(m_peerAddress)) {
+                m_socket->Bind6();
+                m_socket->Connect(Inet6SocketAddress(Ipv6Address::ConvertFrom(m_peerAddress), m_peerPort));
+            } else if (InetSocketAddress::IsMatchingType(m_peerAddress)) {
+                m_socket->Bind();
+                m_socket->Connect(m_peerAddress);
+            } else {
+                NS_FATAL_ERROR("Incompatible address type: " << m_peerAddress);
+            }
+            m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+            m_socket->SetAllowBroadcast(true);
+        }
+        ScheduleTx(Simulator::Now());
+    }
+
+    void StopApplication(void) override {
+        Simulator::Cancel(m_sendEvent);
+        if (m_socket) {
+            m_socket->Close();
+        }
+    }
+
+    // Finds the window containing t, or the first one after it. Time only
+    // moves forward, so the list cursor never goes back.
+    bool FindWindow(Time t, Time& start, Time& end) {
+        if (!m_windows.empty()) {
+            while (m_nextWindow < m_windows.size() && m_windows[m_nextWindow].second <= t) {
+                ++m_nextWindow;
+            }
+            if (m_nextWindow == m_windows.size()) {
+                return false;
+            }
+            start = m_windows[m_nextWindow].first;
+            end = m_windows[m_nextWindow].second;
+            return true;
+        }
+
+        if (m_onDuration.IsZero() || m_period.IsZero()) {
+            // No duty cycle configured: behave like a plain UdpClient
+            start = t;
+            end = Time::Max();
+            return true;
+        }
+        if (t < m_offset) {
+            start = m_offset;
+        } else {
+            int64_t k = (t - m_offset).GetTimeStep() / m_period.GetTimeStep();
+            start = m_offset + TimeStep(k * m_period.GetTimeStep());
+            if (t >= start + m_onDuration) {
+                start += m_period;
+            }
+        }
+        end = start + m_onDuration;
+        return true;
+    }
+
+    // Arms the single send event for the first instant >= t inside a window
+    void ScheduleTx(Time t) {
+        Time start, end;
+        if (!FindWindow(t, start, end)) {
+            return;
+        }
+        Time when = std::max(t, start);
+        m_sendEvent = Simulator::Schedule(when - Simulator::Now(), &DutyCycledUdpClient::Send, this);
+    }
+
+    void Send(void) {
+        SeqTsHeader seqTs;
+        seqTs.SetSeq(m_sent);
+        Ptr<Packet> p = Create<Packet>(m_size - seqTs.GetSerializedSize());
+        p->AddHeader(seqTs);
+        if (m_socket->Send(p) >= 0) {
+            m_txTrace(p);
+            ++m_sent;
+        }
+
+        if (m_maxPackets == 0 || m_sent < m_maxPackets) {
+            ScheduleTx(Simulator::Now() + m_interval);
+        }
+    }
+
+    Ptr<Socket> m_socket;
+    Address m_peerAddress;
+    uint16_t m_peerPort;
+    uint32_t m_size;
+    Time m_interval;
+    uint32_t m_maxPackets;
+    uint64_t m_sent;
+    EventId m_sendEvent;
+
+    Time m_offset;
+    Time m_onDuration;
+    Time m_period;
+    std::vector<std::pair<Time, Time>> m_windows;  // [start, end), sorted
+    std::size_t m_nextWindow;
+
+    TracedCallback<Ptr<const Packet>> m_txTrace;
+};
+
+// Counterpart of UdpClientHelper for DutyCycledUdpClient
+class DutyCycledUdpClientHelper {
+public:
+    DutyCycledUdpClientHelper(Address address, uint16_t port) {
+        m_factory.SetTypeId("ns3::DutyCycledUdpClient");
+        m_factory.Set("RemoteAddress", AddressValue(address));
+        m_factory.Set("RemotePort", UintegerValue(port));
+    }
+
+    void SetAttribute(std::string name, const AttributeValue& value) {
+        m_factory.Set(name, value);
+    }
+
+    // Periodic on-windows for every client installed afterwards
+    void SetPeriodicWindows(Time offset, Time onDuration, Time period) {
+        m_factory.Set("Offset", TimeValue(offset));
+        m_factory.Set("OnDuration", TimeValue(onDuration));
+        m_factory.Set("Period", TimeValue(period));
+    }
+
+    ApplicationContainer Install(Ptr<Node> node) const {
+        Ptr<Application> app = m_factory.Create<DutyCycledUdpClient>();
+        node->AddApplication(app);
+        return ApplicationContainer(app);
+    }
+
+    ApplicationContainer Install(NodeContainer nodes) const {
+        ApplicationContainer apps;
+        for (auto it = nodes.Begin(); it != nodes.End(); ++it) {
+            apps.Add(Install(*it));
+        }
+        return apps;
+    }
+
+private:
+    ObjectFactory m_factory;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(DutyCycledUdpClient);
+
+} // namespace ns3
+
+#endif // DUTY_CYCLED_UDP_CLIENT_H
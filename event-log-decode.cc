@@ -0,0 +1,160 @@
+// Decodes a binary event log written by EventLog (e.g. tdma --eventLog) into
+// CSV, or counts its records per event type.
+//
+// Usage: event-log-decode <input.evlog> [output.csv] [--summary]
+//                         [--component=NAME] [--level=DEBUG|INFO|WARN|ERROR]
+// Without an output file the CSV goes to stdout.
+
+#include "event-log-format.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct EventType {
+    std::string component;
+    std::string event;
+    std::string field[2];
+};
+
+// Exact seconds of a simulation time, e.g. 12.345678901
+static const char* FormatSeconds(int64_t ns, char (&buffer)[32]) {
+    std::snprintf(buffer, sizeof(buffer), "%lld.%09lld", static_cast<long long>(ns / 1000000000),
+                  static_cast<long long>(ns % 1000000000));
+    return buffer;
+}
+
+static uint8_t ParseLevel(const std::string& name) {
+    for (uint8_t level = EVLOG_DEBUG; level <= EVLOG_ERROR; ++level) {
+        if (name == EventLogLevelName(level)) {
+            return level;
+        }
+    }
+    std::cerr << "Unknown level " << name << ", using DEBUG\n";
+    return EVLOG_DEBUG;
+}
+
+int main(int argc, char *argv[]) {
+    std::string input;
+    std::string output;
+    std::string component;
+    uint8_t minLevel = EVLOG_DEBUG;
+    bool summary = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--summary") {
+            summary = true;
+        } else if (arg.rfind("--component=", 0) == 0) {
+            component = arg.substr(12);
+        } else if (arg.rfind("--level=", 0) == 0) {
+            minLevel = ParseLevel(arg.substr(8));
+        } else if (input.empty()) {
+            input = arg;
+        } else {
+            output = arg;
+        }
+    }
+    if (input.empty()) {
+        std::cerr << "Usage: " << argv[0] << " <input.evlog> [output.csv] [--summary]"
+                  << " [--component=NAME] [--level=DEBUG|INFO|WARN|ERROR]\n";
+        return 1;
+    }
+
+    std::ifstream in(input, std::ios::in | std::ios::binary);
+    if (!in) {
+        std::cerr << "Cannot open " << input << "\n";
+        return 1;
+    }
+
+    EventLogFileHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || !IsEventLogHeader(header)) {
+        std::cerr << input << " is not an event log of version " << kEventLogVersion << "\n";
+        return 1;
+    }
+
+    // The type table follows the records; an unclosed log has none
+    std::vector<EventType> types;
+    uint64_t count = header.recordCount;
+    if (header.flags & EVLOG_CLOSED) {
+        in.seekg(sizeof(header) + count * sizeof(EventLogRecord));
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            EventType t;
+            std::getline(fields, t.component, '\t');
+            std::getline(fields, t.event, '\t');
+            std::getline(fields, t.field[0], '\t');
+            std::getline(fields, t.field[1], '\t');
+            types.push_back(t);
+        }
+        in.clear();
+        in.seekg(sizeof(header));
+    } else {
+        in.seekg(0, std::ios::end);
+        count = (static_cast<uint64_t>(in.tellg()) - sizeof(header)) / sizeof(EventLogRecord);
+        in.seekg(sizeof(header));
+        std::cerr << input << " was not closed, decoding " << count << " records without type names\n";
+    }
+
+    std::vector<char> outBuffer(1 << 20);
+    std::ofstream file;
+    if (!output.empty()) {
+        file.rdbuf()->pubsetbuf(outBuffer.data(), outBuffer.size());
+        file.open(output);
+        if (!file) {
+            std::cerr << "Cannot open " << output << "\n";
+            return 1;
+        }
+    }
+    std::ostream& out = output.empty() ? std::cout : file;
+    // All the significant digits of a double; the default 6 merge nearby values
+    out.precision(std::numeric_limits<double>::digits10);
+    if (!summary) {
+        out << "Time(s),Context,Level,Component,Event,Field0,Value0,Field1,Value1\n";
+    }
+
+    const EventType unknown = {"?", "?", {"", ""}};
+    std::map<uint16_t, uint64_t> perType;
+
+    // Records are read in blocks to keep the decoder I/O bound
+    const std::size_t kBlock = 4096;
+    std::vector<EventLogRecord> records(kBlock);
+    uint64_t left = count;
+    uint64_t written = 0;
+    char seconds[32];
+    while (left > 0 && in) {
+        std::size_t want = left < kBlock ? left : kBlock;
+        in.read(reinterpret_cast<char*>(records.data()), want * sizeof(EventLogRecord));
+        std::size_t n = in.gcount() / sizeof(EventLogRecord);
+        left -= n;
+        for (std::size_t i = 0; i < n; ++i) {
+            const EventLogRecord& r = records[i];
+            const EventType& t = r.type < types.size() ? types[r.type] : unknown;
+            if (r.level < minLevel || (!component.empty() && t.component != component)) {
+                continue;
+            }
+            written++;
+            if (summary) {
+                perType[r.type]++;
+                continue;
+            }
+            out << FormatSeconds(r.timeNs, seconds) << ',' << r.context << ',' << EventLogLevelName(r.level) << ','
+                << t.component << ',' << t.event << ',' << t.field[0] << ',' << r.value[0] << ','
+                << t.field[1] << ',' << r.value[1] << '\n';
+        }
+    }
+
+    if (summary) {
+        for (const auto& entry : perType) {
+            const EventType& t = entry.first < types.size() ? types[entry.first] : unknown;
+            out << t.component << '\t' << t.event << '\t' << entry.second << '\n';
+        }
+    }
+    std::cerr << "Decoded " << written << " of " << count << " records\n";
+    return 0;
+}
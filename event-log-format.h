@@ -0,0 +1,59 @@
+#ifndef EVENT_LOG_FORMAT_H
+#define EVENT_LOG_FORMAT_H
+
+#include <cstdint>
+#include <cstring>
+
+// On-disk layout of the binary event log written by EventLog and read back by
+// event-log-decode. The file is an EventLogFileHeader, recordCount
+// fixed-width EventLogRecords in host byte order, then the type table: one
+// text line per registered event type, "component\tevent\tfield0\tfield1\n",
+// the type id being the line number. The header is rewritten with
+// EVLOG_CLOSED and the record count when the log is closed; a file without
+// that flag was not closed and is decoded up to its last complete record,
+// without names.
+
+static const char kEventLogMagic[4] = {'E', 'V', 'L', 'G'};
+static const uint32_t kEventLogVersion = 2;
+
+// EventLogFileHeader::flags
+static const uint32_t EVLOG_CLOSED = 1;
+
+enum EventLogLevel : uint8_t {
+    EVLOG_DEBUG = 0,
+    EVLOG_INFO = 1,
+    EVLOG_WARN = 2,
+    EVLOG_ERROR = 3
+};
+
+struct EventLogFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t recordSize;    // sizeof(EventLogRecord) of the writer
+    uint32_t flags;
+    uint64_t recordCount;   // valid once EVLOG_CLOSED is set
+};
+
+struct EventLogRecord {
+    int64_t timeNs;
+    uint32_t context;       // node id, or the sink's own context
+    uint16_t type;          // line of the type table
+    uint8_t level;
+    uint8_t reserved;
+    double value[2];
+};
+
+static_assert(sizeof(EventLogFileHeader) == 24, "EventLogFileHeader must not be padded");
+static_assert(sizeof(EventLogRecord) == 32, "EventLogRecord must not be padded");
+
+inline bool IsEventLogHeader(const EventLogFileHeader& header) {
+    return std::memcmp(header.magic, kEventLogMagic, sizeof(kEventLogMagic)) == 0 &&
+           header.version == kEventLogVersion && header.recordSize == sizeof(EventLogRecord);
+}
+
+inline const char* EventLogLevelName(uint8_t level) {
+    static const char* names[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+    return level <= EVLOG_ERROR ? names[level] : "?";
+}
+
+#endif // EVENT_LOG_FORMAT_H
@@ -0,0 +1,112 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include "ns3/core-module.h"
+
+#include "event-log-format.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Levels below EVENT_LOG_MIN_LEVEL are removed at compile time, e.g.
+// -DEVENT_LOG_MIN_LEVEL=0 keeps the DEBUG events
+#ifndef EVENT_LOG_MIN_LEVEL
+#define EVENT_LOG_MIN_LEVEL EVLOG_INFO
+#endif
+
+namespace ns3 {
+
+// Binary replacement for text logging in long runs. A component registers
+// its event types once (name and the meaning of the two values) and then
+// appends fixed 32 byte records: no string formatting, no stream, no lock.
+// The simulator runs every event on one thread, so the log has a single
+// writer; parallel runs (MPI ranks, replications) each open their own file.
+// Records are collected in a block and written with one call when the block
+// is full. Decode the file with event-log-decode.
+//
+// Log<Level> is compiled to nothing when Level is below EVENT_LOG_MIN_LEVEL
+// and costs one branch while the log is closed.
+class EventLog {
+public:
+    EventLog() : m_blockSize(4096), m_count(0) {}
+    ~EventLog() { Close(); }
+
+    // Returns the id of a new event type of component
+    uint16_t Register(const std::string& component, const std::string& event,
+                      const std::string& field0 = "", const std::string& field1 = "") {
+        NS_ABORT_MSG_IF(m_types.size() >= 0xffff, "Too many event log types");
+        m_types.push_back(component + "\t" + event + "\t" + field0 + "\t" + field1 + "\n");
+        return m_types.size() - 1;
+    }
+
+    bool Open(const std::string& filename) {
+        m_file.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!m_file.is_open()) {
+            return false;
+        }
+        EventLogFileHeader header = MakeHeader(0, 0);
+        m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        m_block.reserve(m_blockSize);
+        m_count = 0;
+        return true;
+    }
+
+    bool IsOpen(void) const { return m_file.is_open(); }
+    uint64_t GetNRecords(void) const { return m_count + m_block.size(); }
+
+    template <uint8_t Level>
+    void Log(uint16_t type, uint32_t context, double value0 = 0.0, double value1 = 0.0) {
+        if constexpr (Level >= EVENT_LOG_MIN_LEVEL) {
+            if (!m_file.is_open()) {
+                return;
+            }
+            m_block.push_back({Simulator::Now().GetNanoSeconds(), context, type, Level, 0, {value0, value1}});
+            if (m_block.size() == m_blockSize) {
+                Flush();
+            }
+        }
+    }
+
+    // Writes the pending records and the type table and completes the header
+    void Close(void) {
+        if (!m_file.is_open()) {
+            return;
+        }
+        Flush();
+        for (const auto& type : m_types) {
+            m_file.write(type.data(), type.size());
+        }
+        EventLogFileHeader header = MakeHeader(EVLOG_CLOSED, m_count);
+        m_file.seekp(0);
+        m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        m_file.close();
+    }
+
+private:
+    static EventLogFileHeader MakeHeader(uint32_t flags, uint64_t count) {
+        EventLogFileHeader header;
+        std::memcpy(header.magic, kEventLogMagic, sizeof(kEventLogMagic));
+        header.version = kEventLogVersion;
+        header.recordSize = sizeof(EventLogRecord);
+        header.flags = flags;
+        header.recordCount = count;
+        return header;
+    }
+
+    void Flush(void) {
+        m_file.write(reinterpret_cast<const char*>(m_block.data()), m_block.size() * sizeof(EventLogRecord));
+        m_count += m_block.size();
+        m_block.clear();
+    }
+
+    std::ofstream m_file;
+    std::vector<EventLogRecord> m_block;
+    std::size_t m_blockSize;
+    uint64_t m_count;
+    std::vector<std::string> m_types;
+};
+
+} // namespace ns3
+
+#endif // EVENT_LOG_H
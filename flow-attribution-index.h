@@ -0,0 +1,123 @@
+#ifndef FLOW_ATTRIBUTION_INDEX_H
+#define FLOW_ATTRIBUTION_INDEX_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/flow-monitor-module.h"
+
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+enum FlowDirection : uint8_t {
+    FLOW_UPLINK,
+    FLOW_DOWNLINK,
+    FLOW_UNKNOWN
+};
+
+// UE, BS and direction a FlowMonitor flow belongs to
+struct FlowAttribution {
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    uint32_t ue;
+    uint32_t bs;
+    FlowDirection direction;
+    Ipv4FlowClassifier::FiveTuple tuple;
+};
+
+// Maps FlowMonitor flows to the UE and BS they belong to. The index is built
+// once from the Ipv4InterfaceContainers of the scenario: UE and BS addresses
+// go into a hash map and well-known destination ports into a port table.
+// Classifying a flow is then O(1), and the result is cached per FlowId, so
+// the post-processing loops no longer scan every UE address for every flow.
+class FlowAttributionIndex {
+public:
+    explicit FlowAttributionIndex(Ptr<Ipv4FlowClassifier> classifier)
+        : m_classifier(classifier) {}
+
+    void AddUe(Ipv4Address address, uint32_t ue, uint32_t bs) {
+        m_nodes[address.Get()] = {ue, bs, true};
+    }
+
+    // Interface i of the container is UE firstUe + i, served by BS bs
+    void AddUes(const Ipv4InterfaceContainer& interfaces, uint32_t firstUe, uint32_t bs) {
+        for (uint32_t i = 0; i < interfaces.GetN(); ++i) {
+            AddUe(interfaces.GetAddress(i), firstUe + i, bs);
+        }
+    }
+
+    // Interface i of the container is BS firstBs + i
+    void AddBss(const Ipv4InterfaceContainer& interfaces, uint32_t firstBs = 0) {
+        for (uint32_t i = 0; i < interfaces.GetN(); ++i) {
+            m_nodes[interfaces.GetAddress(i).Get()] = {FlowAttribution::NONE, firstBs + i, false};
+        }
+    }
+
+    // Flows towards this destination port have a known direction. Flows on
+    // other ports get theirs from which end is the UE.
+    void SetPortDirection(uint16_t port, FlowDirection direction) {
+        m_ports[port] = direction;
+    }
+
+    // The reference stays valid until the next call
+    const FlowAttribution& Classify(FlowId flowId) {
+        if (flowId >= m_cache.size()) {
+            m_cache.resize(flowId + 1);
+            m_cached.resize(flowId + 1, false);
+        }
+        if (!m_cached[flowId]) {
+            m_cache[flowId] = Lookup(m_classifier->FindFlow(flowId));
+            m_cached[flowId] = true;
+        }
+        return m_cache[flowId];
+    }
+
+private:
+    struct NodeEntry {
+        uint32_t ue;
+        uint32_t bs;
+        bool isUe;
+    };
+
+    FlowAttribution Lookup(const Ipv4FlowClassifier::FiveTuple& t) const {
+        FlowAttribution a{FlowAttribution::NONE, FlowAttribution::NONE, FLOW_UNKNOWN, t};
+        auto src = m_nodes.find(t.sourceAddress.Get());
+        auto dst = m_nodes.find(t.destinationAddress.Get());
+        bool srcIsUe = src != m_nodes.end() && src->second.isUe;
+        bool dstIsUe = dst != m_nodes.end() && dst->second.isUe;
+
+        auto port = m_ports.find(t.destinationPort);
+        if (port != m_ports.end()) {
+            a.direction = port->second;
+        } else if (srcIsUe) {
+            a.direction = FLOW_UPLINK;
+        } else if (dstIsUe) {
+            a.direction = FLOW_DOWNLINK;
+        }
+
+        if (srcIsUe && (a.direction != FLOW_DOWNLINK || !dstIsUe)) {
+            a.ue = src->second.ue;
+            a.bs = src->second.bs;
+        } else if (dstIsUe) {
+            a.ue = dst->second.ue;
+            a.bs = dst->second.bs;
+        } else if (src != m_nodes.end()) {
+            a.bs = src->second.bs;
+        } else if (dst != m_nodes.end()) {
+            a.bs = dst->second.bs;
+        }
+        return a;
+    }
+
+    Ptr<Ipv4FlowClassifier> m_classifier;
+    std::unordered_map<uint32_t, NodeEntry> m_nodes;    // keyed by Ipv4Address::Get()
+    std::unordered_map<uint16_t, FlowDirection> m_ports;
+    std::vector<FlowAttribution> m_cache;               // indexed by FlowId
+    std::vector<bool> m_cached;
+};
+
+} // namespace ns3
+
+#endif // FLOW_ATTRIBUTION_INDEX_H
@@ -0,0 +1,173 @@
+#ifndef FLOW_INTERVAL_COLLECTOR_H
+#define FLOW_INTERVAL_COLLECTOR_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/flow-monitor-module.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace ns3 {
+
+// Turns the cumulative FlowMonitor counters into per-interval deltas. The
+// previous snapshot of every flow is kept in a flat array indexed by FlowId
+// (ids are dense and start at 1), and the five-tuple of a flow is looked up
+// once, when the flow first shows up.
+//
+// A sample only visits the flows whose counters may have moved, not every
+// flow the monitor knows:
+// - flows a packet was sent or delivered on since the last sample, marked
+//   from the same Ipv4L3Protocol traces as the flow probes (SendOutgoing,
+//   LocalDeliver) at O(log flows) per packet, like the classifier itself;
+// - flows that still had packets in flight at the last sample (more tx than
+//   rx and lost), whose losses the monitor may declare without any packet
+//   passing, e.g. in CheckForLostPackets after the flow's last packet;
+// - new flows, taken from the ids above the highest one seen.
+// A flow whose every packet was received or declared lost is not visited
+// until it sends again. Lost packets are the delta of lostPackets; packets
+// still in flight are not counted as lost.
+//
+// Construct it after the internet stacks are installed, and keep it alive
+// until the simulation is destroyed.
+class FlowIntervalCollector {
+public:
+    struct Delta {
+        FlowId flowId;
+        Ipv4Address source;
+        Ipv4Address destination;
+        uint64_t txBytes;
+        uint64_t rxBytes;
+        uint32_t txPackets;
+        uint32_t rxPackets;
+        uint32_t lostPackets;
+        Time delaySum;
+        Time jitterSum;
+    };
+
+    FlowIntervalCollector(Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier)
+        : m_monitor(monitor),
+          m_classifier(classifier) {
+        Config::ConnectWithoutContextFailSafe("/NodeList/*/$ns3::Ipv4L3Protocol/SendOutgoing",
+                                              MakeCallback(&FlowIntervalCollector::Seen, this));
+        Config::ConnectWithoutContextFailSafe("/NodeList/*/$ns3::Ipv4L3Protocol/LocalDeliver",
+                                              MakeCallback(&FlowIntervalCollector::Seen, this));
+    }
+
+    // The traces are bound to this object
+    FlowIntervalCollector(const FlowIntervalCollector&) = delete;
+    FlowIntervalCollector& operator=(const FlowIntervalCollector&) = delete;
+
+    // Deltas of every flow that sent, received or lost something since the
+    // last call, by FlowId. The returned vector is reused by the next call.
+    const std::vector<Delta>& Collect(void) {
+        const FlowMonitor::FlowStatsContainer& stats = m_monitor->GetFlowStats();
+        m_changed.clear();
+
+        // Flows classified since the last call
+        for (auto it = stats.lower_bound(m_last.size()); it != stats.end(); ++it) {
+            if (it->first >= m_last.size()) {
+                m_last.resize(it->first + 1);
+            }
+            Ipv4FlowClassifier::FiveTuple t = m_classifier->FindFlow(it->first);
+            m_last[it->first].source = t.sourceAddress;
+            m_last[it->first].destination = t.destinationAddress;
+            m_flowOf[t] = it->first;
+            MarkDirty(it->first);
+        }
+        for (FlowId id : m_inFlight) {
+            MarkDirty(id);
+        }
+        m_inFlight.clear();
+
+        std::sort(m_dirty.begin(), m_dirty.end());
+        for (FlowId id : m_dirty) {
+            Snapshot& last = m_last[id];
+            last.dirty = false;
+            auto it = stats.find(id);
+            if (it == stats.end()) {
+                continue;
+            }
+            const FlowMonitor::FlowStats& st = it->second;
+            if (st.txPackets > st.rxPackets + st.lostPackets) {
+                m_inFlight.push_back(id);
+            }
+            if (st.txPackets == last.txPackets && st.rxPackets == last.rxPackets &&
+                st.lostPackets == last.lostPackets) {
+                continue;
+            }
+
+            m_changed.push_back({id, last.source, last.destination,
+                                 st.txBytes - last.txBytes, st.rxBytes - last.rxBytes,
+                                 st.txPackets - last.txPackets, st.rxPackets - last.rxPackets,
+                                 st.lostPackets - last.lostPackets, st.delaySum - last.delaySum, st.jitterSum - last.jitterSum});
+
+            last.txBytes = st.txBytes;
+            last.rxBytes = st.rxBytes;
+            last.txPackets = st.txPackets;
+            last.rxPackets = st.rxPackets;
+            last.lostPackets = st.lostPackets;
+            last.delaySum = st.delaySum;
+            last.jitterSum = st.jitterSum;
+        }
+        m_dirty.clear();
+        return m_changed;
+    }
+
+private:
+    struct Snapshot {
+        uint64_t txBytes = 0;
+        uint64_t rxBytes = 0;
+        uint32_t txPackets = 0;
+        uint32_t rxPackets = 0;
+        uint32_t lostPackets = 0;
+        Time delaySum;
+        Time jitterSum;
+        Ipv4Address source;
+        Ipv4Address destination;
+        bool dirty = false;
+    };
+
+    void MarkDirty(FlowId id) {
+        if (!m_last[id].dirty) {
+            m_last[id].dirty = true;
+            m_dirty.push_back(id);
+        }
+    }
+
+    // Marks the flow of a packet, if the collector knows it yet; an unknown
+    // flow is a new one, found by the next Collect
+    void Seen(const Ipv4Header& header, Ptr<const Packet> payload, uint32_t interface) {
+        uint8_t protocol = header.GetProtocol();
+        if ((protocol != UdpL4Protocol::PROT_NUMBER && protocol != TcpL4Protocol::PROT_NUMBER) ||
+            header.GetFragmentOffset() != 0 || payload->GetSize() < 4) {
+            return;
+        }
+        // Source and destination ports lead both the UDP and the TCP header
+        uint8_t ports[4];
+        payload->CopyData(ports, sizeof(ports));
+        Ipv4FlowClassifier::FiveTuple t;
+        t.sourceAddress = header.GetSource();
+        t.destinationAddress = header.GetDestination();
+        t.protocol = protocol;
+        t.sourcePort = (ports[0] << 8) | ports[1];
+        t.destinationPort = (ports[2] << 8) | ports[3];
+        auto it = m_flowOf.find(t);
+        if (it != m_flowOf.end()) {
+            MarkDirty(it->second);
+        }
+    }
+
+    Ptr<FlowMonitor> m_monitor;
+    Ptr<Ipv4FlowClassifier> m_classifier;
+    std::vector<Snapshot> m_last;
+    std::map<Ipv4FlowClassifier::FiveTuple, FlowId> m_flowOf;
+    std::vector<FlowId> m_dirty;
+    std::vector<FlowId> m_inFlight;   // flows with packets in flight at the last sample
+    std::vector<Delta> m_changed;
+};
+
+} // namespace ns3
+
+#endif // FLOW_INTERVAL_COLLECTOR_H
@@ -0,0 +1,46 @@
+#ifndef FLOW_METRICS_FORMAT_H
+#define FLOW_METRICS_FORMAT_H
+
+#include <cstdint>
+#include <cstring>
+
+// On-disk layout of the binary per-interval flow metrics written by
+// FlowMetricsSampler and read back by flow-metrics-to-csv. The file is a
+// FlowMetricsFileHeader followed by fixed-width FlowMetricsRecords in host
+// byte order. Fields are ordered so that neither struct has padding.
+
+static const char kFlowMetricsMagic[4] = {'F', 'L', 'M', 'S'};
+static const uint32_t kFlowMetricsVersion = 1;
+
+struct FlowMetricsFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t recordSize;    // sizeof(FlowMetricsRecord) of the writer
+    uint32_t reserved;
+    double intervalSeconds;
+};
+
+struct FlowMetricsRecord {
+    double time;            // end of the interval (s)
+    uint64_t rxBytes;
+    double throughputKbps;
+    double jitterSeconds;
+    double delaySeconds;
+    double lossPercent;     // lost / (received + lost) in the interval
+    uint32_t sample;
+    uint32_t flowId;
+    uint32_t source;        // IPv4 address in host order
+    uint32_t destination;
+    uint32_t txPackets;
+    uint32_t rxPackets;
+};
+
+static_assert(sizeof(FlowMetricsFileHeader) == 24, "FlowMetricsFileHeader must not be padded");
+static_assert(sizeof(FlowMetricsRecord) == 72, "FlowMetricsRecord must not be padded");
+
+inline bool IsFlowMetricsHeader(const FlowMetricsFileHeader& header) {
+    return std::memcmp(header.magic, kFlowMetricsMagic, sizeof(kFlowMetricsMagic)) == 0 &&
+           header.version == kFlowMetricsVersion && header.recordSize == sizeof(FlowMetricsRecord);
+}
+
+#endif // FLOW_METRICS_FORMAT_H
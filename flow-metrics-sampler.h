@@ -0,0 +1,150 @@
+#ifndef FLOW_METRICS_SAMPLER_H
+#define FLOW_METRICS_SAMPLER_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/flow-monitor-module.h"
+
+#include "flow-interval-collector.h"
+#include "flow-metrics-format.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+// Periodic per-flow QoS sampler. Every interval it writes one row per flow
+// that was active during that interval (see FlowIntervalCollector), either as
+// CSV or as fixed-width binary records (flow-metrics-format.h, converted
+// offline by flow-metrics-to-csv). The output goes through a large
+// user-space buffer and is only flushed on Close(). The sampler stops
+// rescheduling itself once the next sample would fall at or past the stop
+// time, so it leaves no events behind the end of the run; Close() writes one
+// last, possibly shorter, sample with whatever happened after the last
+// periodic one, including the losses CheckForLostPackets declares at the end.
+class FlowMetricsSampler {
+public:
+    enum Format {
+        CSV,
+        BINARY
+    };
+
+    FlowMetricsSampler(Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier)
+        : m_monitor(monitor),
+          m_collector(monitor, classifier),
+          m_format(CSV),
+          m_sample(0) {}
+
+    ~FlowMetricsSampler() {
+        if (m_file.is_open()) {
+            m_file.close();
+        }
+    }
+
+    bool Open(const std::string& filename, Format format, std::size_t bufferBytes = 1 << 20) {
+        m_format = format;
+        m_buffer.resize(bufferBytes);
+        // The buffer has to be installed before the file is opened
+        m_file.rdbuf()->pubsetbuf(m_buffer.data(), m_buffer.size());
+        m_file.open(filename, format == BINARY ? std::ios::out | std::ios::binary : std::ios::out);
+        return m_file.is_open();
+    }
+
+    // First sample at startTime + interval, last one strictly before stopTime
+    void Start(Time interval, Time stopTime) {
+        NS_ASSERT_MSG(m_file.is_open(), "Open() must be called before Start()");
+        NS_ASSERT_MSG(interval.IsStrictlyPositive(), "Sampling interval must be positive");
+        m_interval = interval;
+        m_stopTime = stopTime;
+        m_lastSample = Simulator::Now();
+        WriteHeader();
+        if (Simulator::Now() + m_interval < m_stopTime) {
+            m_event = Simulator::Schedule(m_interval, &FlowMetricsSampler::Sample, this);
+        }
+    }
+
+    // Takes the final sample and closes the file. Must be called after
+    // Simulator::Run() and before Simulator::Destroy().
+    void Close(void) {
+        Simulator::Cancel(m_event);
+        if (m_file.is_open()) {
+            m_monitor->CheckForLostPackets();
+            if (Simulator::Now() > m_lastSample) {
+                Write(Simulator::Now() - m_lastSample);
+            }
+            m_file.close();
+        }
+    }
+
+private:
+    void WriteHeader(void) {
+        if (m_format == BINARY) {
+            FlowMetricsFileHeader header;
+            std::memcpy(header.magic, kFlowMetricsMagic, sizeof(header.magic));
+            header.version = kFlowMetricsVersion;
+            header.recordSize = sizeof(FlowMetricsRecord);
+            header.reserved = 0;
+            header.intervalSeconds = m_interval.GetSeconds();
+            m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        } else {
+            m_file << "Sample,Time,FlowID,SourceIP,DestinationIP,TxPackets,RxPackets,RxBytes,"
+                      "Throughput(kbps),Jitter(s),Delay(s),PacketLoss(%)\n";
+        }
+    }
+
+    void Sample(void) {
+        if (Simulator::Now() + m_interval < m_stopTime) {
+            m_event = Simulator::Schedule(m_interval, &FlowMetricsSampler::Sample, this);
+        }
+        Write(Simulator::Now() - m_lastSample);
+    }
+
+    // One row per flow that changed over the last span
+    void Write(Time span) {
+        m_lastSample = Simulator::Now();
+        double seconds = span.GetSeconds();
+        for (const FlowIntervalCollector::Delta& d : m_collector.Collect()) {
+            FlowMetricsRecord r;
+            r.time = Simulator::Now().GetSeconds();
+            r.rxBytes = d.rxBytes;
+            r.throughputKbps = d.rxBytes * 8.0 / seconds / 1000.0;
+            r.jitterSeconds = d.rxPackets > 0 ? d.jitterSum.GetSeconds() / d.rxPackets : 0.0;
+            r.delaySeconds = d.rxPackets > 0 ? d.delaySum.GetSeconds() / d.rxPackets : 0.0;
+            // Share of the packets whose fate was settled in this interval
+            r.lossPercent = d.lostPackets > 0 ? 100.0 * d.lostPackets / (d.rxPackets + d.lostPackets) : 0.0;
+            r.sample = m_sample;
+            r.flowId = d.flowId;
+            r.source = d.source.Get();
+            r.destination = d.destination.Get();
+            r.txPackets = d.txPackets;
+            r.rxPackets = d.rxPackets;
+
+            if (m_format == BINARY) {
+                m_file.write(reinterpret_cast<const char*>(&r), sizeof(r));
+            } else {
+                m_file << r.sample << ',' << r.time << ',' << r.flowId << ','
+                       << d.source << ',' << d.destination << ','
+                       << r.txPackets << ',' << r.rxPackets << ',' << r.rxBytes << ','
+                       << r.throughputKbps << ',' << r.jitterSeconds << ','
+                       << r.delaySeconds << ',' << r.lossPercent << '\n';
+            }
+        }
+        m_sample++;
+    }
+
+    Ptr<FlowMonitor> m_monitor;
+    FlowIntervalCollector m_collector;
+    Format m_format;
+    std::vector<char> m_buffer;
+    std::ofstream m_file;
+    Time m_interval;
+    Time m_stopTime;
+    Time m_lastSample;
+    EventId m_event;
+    uint32_t m_sample;
+};
+
+} // namespace ns3
+
+#endif // FLOW_METRICS_SAMPLER_H
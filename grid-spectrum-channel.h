@@ -0,0 +1,314 @@
+#ifndef GRID_SPECTRUM_CHANNEL_H
+#define GRID_SPECTRUM_CHANNEL_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-module.h"
+#include "ns3/spectrum-module.h"
+#include "ns3/antenna-module.h"
+
+#include <cmath>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+// Spectrum channel that only delivers a transmission to the PHYs within
+// MaxRange of the transmitter. StartTx asks a uniform grid of PHY positions
+// for the candidate receivers and computes loss, delay and the reception
+// event for those alone, so a transmission costs in proportion to the
+// neighbourhood rather than to the number of PHYs on the channel.
+//
+// The grid is rebuilt lazily, when PHYs are added or removed or once it is
+// older than IndexRefresh, and lookups are widened by the distance a node
+// can have moved since (MaxNodeSpeed). The candidates are then checked at
+// their exact distance. PHYs marked with ExemptFromRange, and PHYs without
+// a mobility model, send to and hear every PHY on the channel.
+class GridSpectrumChannel : public SpectrumChannel {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::GridSpectrumChannel")
+            .SetParent<SpectrumChannel>()
+            .SetGroupName("Spectrum")
+            .AddConstructor<GridSpectrumChannel>()
+            .AddAttribute("MaxRange",
+                          "Distance (m) beyond which a signal is not delivered",
+                          DoubleValue(150.0),
+                          MakeDoubleAccessor(&GridSpectrumChannel::m_maxRange),
+                          MakeDoubleChecker<double>(0.0))
+            .AddAttribute("GridCellSize",
+                          "Cell size (m) of the receiver index, 0 to use MaxRange",
+                          DoubleValue(0.0),
+                          MakeDoubleAccessor(&GridSpectrumChannel::m_cellSize),
+                          MakeDoubleChecker<double>(0.0))
+            .AddAttribute("MaxNodeSpeed",
+                          "Upper bound (m/s) of the node speeds, used to widen lookups in a stale index",
+                          DoubleValue(50.0),
+                          MakeDoubleAccessor(&GridSpectrumChannel::m_maxNodeSpeed),
+                          MakeDoubleChecker<double>(0.0))
+            .AddAttribute("IndexRefresh",
+                          "Maximum age of the receiver index before it is rebuilt",
+                          TimeValue(Seconds(1.0)),
+                          MakeTimeAccessor(&GridSpectrumChannel::m_indexRefresh),
+                          MakeTimeChecker());
+        return tid;
+    }
+
+    GridSpectrumChannel()
+        : m_maxRange(150.0),
+          m_cellSize(0.0),
+          m_maxNodeSpeed(50.0),
+          m_indexRefresh(Seconds(1.0)),
+          m_indexCellSize(0.0),
+          m_indexDirty(true) {}
+
+    // Takes the loss, spectrum loss and delay models of another channel,
+    // e.g. one a helper has configured, before any PHY is attached
+    void CopyModelsFrom(Ptr<SpectrumChannel> other) {
+        if (Ptr<PropagationLossModel> loss = other->GetPropagationLossModel()) {
+            AddPropagationLossModel(loss);
+        }
+        if (Ptr<SpectrumPropagationLossModel> loss = other->GetSpectrumPropagationLossModel()) {
+            AddSpectrumPropagationLossModel(loss);
+        }
+        if (Ptr<PhasedArraySpectrumPropagationLossModel> loss = other->GetPhasedArraySpectrumPropagationLossModel()) {
+            AddPhasedArraySpectrumPropagationLossModel(loss);
+        }
+        if (Ptr<PropagationDelayModel> delay = other->GetPropagationDelayModel()) {
+            SetPropagationDelayModel(delay);
+        }
+    }
+
+    // Signals to and from this PHY are delivered at any distance
+    void ExemptFromRange(Ptr<const SpectrumPhy> phy) {
+        m_exempt.insert(PeekPointer(phy));
+        m_indexDirty = true;
+    }
+
+    void AddRx(Ptr<SpectrumPhy> phy) override {
+        for (const auto& p : m_phys) {
+            if (p == phy) {
+                return;
+            }
+        }
+        m_phys.push_back(phy);
+        m_indexDirty = true;
+    }
+
+    void RemoveRx(Ptr<SpectrumPhy> phy) override {
+        for (auto it = m_phys.begin(); it != m_phys.end(); ++it) {
+            if (*it == phy) {
+                m_phys.erase(it);
+                m_indexDirty = true;
+                return;
+            }
+        }
+    }
+
+    void StartTx(Ptr<SpectrumSignalParameters> txParams) override {
+        NS_ASSERT_MSG(txParams->txPhy, "NULL txPhy");
+        m_txSigParamsTrace(txParams->Copy());
+
+        Ptr<MobilityModel> txMobility = txParams->txPhy->GetMobility();
+        if (!txMobility || m_exempt.count(PeekPointer(txParams->txPhy))) {
+            for (const auto& rx : m_phys) {
+                Deliver(txParams, txMobility, rx);
+            }
+            return;
+        }
+
+        FindCandidates(txMobility);
+        for (SpectrumPhy* rx : m_candidates) {
+            Deliver(txParams, txMobility, rx);
+        }
+    }
+
+    std::size_t GetNDevices(void) const override { return m_phys.size(); }
+
+    Ptr<NetDevice> GetDevice(std::size_t i) const override { return m_phys.at(i)->GetDevice(); }
+
+protected:
+    void DoDispose(void) override {
+        m_phys.clear();
+        m_grid.clear();
+        m_unplaced.clear();
+        m_candidates.clear();
+        m_exempt.clear();
+        m_converters.clear();
+        SpectrumChannel::DoDispose();
+    }
+
+private:
+    // Same per-receiver path as MultiModelSpectrumChannel::StartTx
+    void Deliver(Ptr<SpectrumSignalParameters> txParams, Ptr<MobilityModel> txMobility, Ptr<SpectrumPhy> rxPhy) {
+        if (rxPhy == txParams->txPhy) {
+            return;
+        }
+        Ptr<NetDevice> rxNetDevice = rxPhy->GetDevice();
+        Ptr<NetDevice> txNetDevice = txParams->txPhy->GetDevice();
+        if (rxNetDevice && txNetDevice && rxNetDevice->GetNode()->GetId() == txNetDevice->GetNode()->GetId()) {
+            return;
+        }
+        if (m_filter && m_filter->Filter(txParams, rxPhy)) {
+            return;
+        }
+
+        Ptr<SpectrumSignalParameters> rxParams = txParams->Copy();
+        rxParams->psd = Convert(txParams->psd, rxPhy->GetRxSpectrumModel());
+        Time delay = MicroSeconds(0);
+        Ptr<MobilityModel> rxMobility = rxPhy->GetMobility();
+        if (txMobility && rxMobility) {
+            double txAntennaGain = 0.0;
+            double rxAntennaGain = 0.0;
+            double propagationGainDb = 0.0;
+            double pathLossDb = 0.0;
+            if (rxParams->txAntenna) {
+                Angles txAngles(rxMobility->GetPosition(), txMobility->GetPosition());
+                txAntennaGain = rxParams->txAntenna->GetGainDb(txAngles);
+                pathLossDb -= txAntennaGain;
+            }
+            Ptr<AntennaModel> rxAntenna = DynamicCast<AntennaModel>(rxPhy->GetAntenna());
+            if (rxAntenna) {
+                Angles rxAngles(txMobility->GetPosition(), rxMobility->GetPosition());
+                rxAntennaGain = rxAntenna->GetGainDb(rxAngles);
+                pathLossDb -= rxAntennaGain;
+            }
+            if (m_propagationLoss) {
+                propagationGainDb = m_propagationLoss->CalcRxPower(0, txMobility, rxMobility);
+                pathLossDb -= propagationGainDb;
+            }
+            m_pathLossTrace(txParams->txPhy, rxPhy, pathLossDb);
+            if (pathLossDb > m_maxLossDb) {
+                return;
+            }
+            *(rxParams->psd) *= std::pow(10.0, (txAntennaGain + rxAntennaGain + propagationGainDb) / 10.0);
+
+            if (m_spectrumPropagationLoss) {
+                rxParams->psd = m_spectrumPropagationLoss->CalcRxPowerSpectralDensity(rxParams, txMobility, rxMobility);
+            } else if (m_phasedArraySpectrumPropagationLoss) {
+                Ptr<const PhasedArrayModel> txArray = DynamicCast<PhasedArrayModel>(txParams->txPhy->GetAntenna());
+                Ptr<const PhasedArrayModel> rxArray = DynamicCast<PhasedArrayModel>(rxPhy->GetAntenna());
+                NS_ASSERT_MSG(txArray && rxArray, "PhasedArraySpectrumPropagationLoss needs a PhasedArrayModel at both PHYs");
+                rxParams = m_phasedArraySpectrumPropagationLoss->CalcRxPowerSpectralDensity(rxParams, txMobility, rxMobility,
+                                                                                           txArray, rxArray);
+            }
+            if (m_propagationDelay) {
+                delay = m_propagationDelay->GetDelay(txMobility, rxMobility);
+            }
+        }
+
+        if (rxNetDevice) {
+            Simulator::ScheduleWithContext(rxNetDevice->GetNode()->GetId(), delay,
+                                           &GridSpectrumChannel::StartRx, rxParams, rxPhy);
+        } else {
+            Simulator::Schedule(delay, &GridSpectrumChannel::StartRx, rxParams, rxPhy);
+        }
+    }
+
+    static void StartRx(Ptr<SpectrumSignalParameters> params, Ptr<SpectrumPhy> receiver) {
+        receiver->StartRx(params);
+    }
+
+    // The PSD in the receiver's spectrum model, with one converter per model pair
+    Ptr<SpectrumValue> Convert(Ptr<const SpectrumValue> psd, Ptr<const SpectrumModel> rxModel) {
+        if (!rxModel || psd->GetSpectrumModelUid() == rxModel->GetUid()) {
+            return psd->Copy();
+        }
+        auto key = std::make_pair(psd->GetSpectrumModelUid(), rxModel->GetUid());
+        auto it = m_converters.find(key);
+        if (it == m_converters.end()) {
+            it = m_converters.emplace(key, SpectrumConverter(psd->GetSpectrumModel(), rxModel)).first;
+        }
+        return it->second.Convert(psd);
+    }
+
+    // Shifted as unsigned: a left shift of a negative signed value is undefined
+    uint64_t CellKey(int64_t x, int64_t y) const {
+        return (static_cast<uint64_t>(x) << 32) ^ (static_cast<uint64_t>(y) & 0xffffffff);
+    }
+    int64_t CellOf(double v) const { return static_cast<int64_t>(std::floor(v / m_indexCellSize)); }
+
+    void RebuildIndex(void) {
+        m_grid.clear();
+        m_unplaced.clear();
+        m_indexCellSize = m_cellSize > 0.0 ? m_cellSize : m_maxRange;
+        for (const auto& phy : m_phys) {
+            Ptr<MobilityModel> m = phy->GetMobility();
+            if (!m || m_exempt.count(PeekPointer(phy))) {
+                m_unplaced.push_back(PeekPointer(phy));
+                continue;
+            }
+            Vector p = m->GetPosition();
+            m_grid[CellKey(CellOf(p.x), CellOf(p.y))].push_back(PeekPointer(phy));
+        }
+        m_indexTime = Simulator::Now();
+        m_indexDirty = false;
+    }
+
+    // Fills m_candidates with the PHYs that may be within MaxRange of tx
+    void FindCandidates(Ptr<MobilityModel> tx) {
+        Time now = Simulator::Now();
+        if (m_indexDirty || m_indexCellSize <= 0.0 || now - m_indexTime > m_indexRefresh) {
+            RebuildIndex();
+        }
+        m_candidates.assign(m_unplaced.begin(), m_unplaced.end());
+
+        // Positions in the index may be up to (now - m_indexTime) old
+        Vector p = tx->GetPosition();
+        double radius = m_maxRange + m_maxNodeSpeed * (now - m_indexTime).GetSeconds();
+        for (int64_t x = CellOf(p.x - radius); x <= CellOf(p.x + radius); ++x) {
+            for (int64_t y = CellOf(p.y - radius); y <= CellOf(p.y + radius); ++y) {
+                auto it = m_grid.find(CellKey(x, y));
+                if (it == m_grid.end()) {
+                    continue;
+                }
+                for (SpectrumPhy* rx : it->second) {
+                    if (tx->GetDistanceFrom(rx->GetMobility()) <= m_maxRange) {
+                        m_candidates.push_back(rx);
+                    }
+                }
+            }
+        }
+    }
+
+    double m_maxRange;
+    double m_cellSize;
+    double m_maxNodeSpeed;
+    Time m_indexRefresh;
+    Time m_indexTime;
+    double m_indexCellSize;
+    bool m_indexDirty;
+    std::vector<Ptr<SpectrumPhy>> m_phys;                             // every PHY, in AddRx order
+    std::unordered_map<uint64_t, std::vector<SpectrumPhy*>> m_grid;   // PHYs with a position, by cell
+    std::vector<SpectrumPhy*> m_unplaced;                             // PHYs delivered at any distance
+    std::vector<SpectrumPhy*> m_candidates;                           // receivers of the current StartTx
+    std::unordered_set<const SpectrumPhy*> m_exempt;
+    std::map<std::pair<SpectrumModelUid_t, SpectrumModelUid_t>, SpectrumConverter> m_converters;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(GridSpectrumChannel);
+
+// Spectrum channel for SpectrumWifiPhy with the loss and delay models of
+// YansWifiChannelHelper::Default() followed by a RangePropagationLossModel,
+// which is what the Yans channel of the scenarios uses. Beyond maxRange the
+// received power is already -1000 dBm, so the grid only skips receptions
+// the PHYs would discard anyway.
+inline Ptr<GridSpectrumChannel> CreateCulledWifiChannel(double maxRange) {
+    Ptr<GridSpectrumChannel> channel = CreateObject<GridSpectrumChannel>();
+    channel->SetAttribute("MaxRange", DoubleValue(maxRange));
+    // Each added model is placed in front of the previous ones
+    Ptr<RangePropagationLossModel> range = CreateObject<RangePropagationLossModel>();
+    range->SetAttribute("MaxRange", DoubleValue(maxRange));
+    channel->AddPropagationLossModel(range);
+    channel->AddPropagationLossModel(CreateObject<LogDistancePropagationLossModel>());
+    channel->SetPropagationDelayModel(CreateObject<ConstantSpeedPropagationDelayModel>());
+    return channel;
+}
+
+} // namespace ns3
+
+#endif // GRID_SPECTRUM_CHANNEL_H
@@ -0,0 +1,220 @@
+#ifndef LADDER_SCHEDULER_H
+#define LADDER_SCHEDULER_H
+
+#include "ns3/core-module.h"
+#include "ns3/scheduler.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace ns3 {
+
+// Ladder queue event scheduler (Tang, Goh and Thng, 2005). Events go to one
+// of three tiers:
+//  - Top: an unsorted list of the far future, every event at or after
+//    m_topStart.
+//  - Ladder: rungs of buckets of equal width, each rung spreading one bucket
+//    of the rung above. Inserting is a division and a push_back.
+//  - Bottom: the few events due next, sorted, popped from the back.
+// When Bottom runs dry the next non-empty bucket of the lowest rung is either
+// sorted into Bottom or, if it holds more than BucketThreshold events, spread
+// over a new rung; so is Bottom itself once inserts of near-future events
+// grow it past BucketThreshold. Every event is moved a bounded number of times, so Insert
+// and RemoveNext are amortised O(1) when, as in the TDMA scenarios, events
+// are scheduled at regular offsets (packet intervals, slot boundaries).
+//
+// Select it with --SchedulerType=ns3::LadderScheduler.
+class LadderScheduler : public Scheduler {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::LadderScheduler")
+            .SetParent<Scheduler>()
+            .SetGroupName("Core")
+            .AddConstructor<LadderScheduler>()
+            .AddAttribute("BucketThreshold",
+                          "Bucket size above which a bucket is spread over a new rung",
+                          UintegerValue(50),
+                          MakeUintegerAccessor(&LadderScheduler::m_threshold),
+                          MakeUintegerChecker<uint32_t>(2))
+            .AddAttribute("MaxRungs",
+                          "Maximum number of rungs of the ladder",
+                          UintegerValue(8),
+                          MakeUintegerAccessor(&LadderScheduler::m_maxRungs),
+                          MakeUintegerChecker<uint32_t>(1));
+        return tid;
+    }
+
+    LadderScheduler()
+        : m_threshold(50),
+          m_maxRungs(8),
+          m_count(0),
+          m_topStart(0),
+          m_topMin(std::numeric_limits<uint64_t>::max()),
+          m_topMax(0) {}
+
+    void Insert(const Event& ev) override {
+        m_count++;
+        uint64_t ts = ev.key.m_ts;
+        if (ts >= m_topStart) {
+            m_top.push_back(ev);
+            m_topMin = std::min(m_topMin, ts);
+            m_topMax = std::max(m_topMax, ts);
+            return;
+        }
+        for (auto& rung : m_rungs) {
+            if (ts >= rung.CurrentStart()) {
+                rung.buckets[rung.Index(ts)].push_back(ev);
+                return;
+            }
+        }
+        InsertBottom(ev);
+        // Bottom is a bucket of its own: spread it over a new lowest rung when
+        // it holds too many events, unless they all share one timestamp
+        if (m_bottom.size() > m_threshold && m_rungs.size() < m_maxRungs &&
+            m_bottom.front().key.m_ts != m_bottom.back().key.m_ts) {
+            uint64_t end = m_rungs.empty() ? m_topStart : m_rungs.back().CurrentStart();
+            std::vector<Event> events;
+            events.swap(m_bottom);
+            AddRung(events, events.back().key.m_ts, end);
+        }
+    }
+
+    bool IsEmpty(void) const override { return m_count == 0; }
+
+    Event PeekNext(void) const override {
+        NS_ASSERT(!IsEmpty());
+        Refill();
+        return m_bottom.back();
+    }
+
+    Event RemoveNext(void) override {
+        NS_ASSERT(!IsEmpty());
+        Refill();
+        Event ev = m_bottom.back();
+        m_bottom.pop_back();
+        m_count--;
+        return ev;
+    }
+
+    void Remove(const Event& ev) override {
+        uint64_t ts = ev.key.m_ts;
+        if (ts >= m_topStart) {
+            NS_ABORT_MSG_IF(!EraseUnsorted(m_top, ev), "Event not found");
+            m_count--;
+            return;
+        }
+        for (auto& rung : m_rungs) {
+            if (ts >= rung.CurrentStart()) {
+                NS_ABORT_MSG_IF(!EraseUnsorted(rung.buckets[rung.Index(ts)], ev), "Event not found");
+                m_count--;
+                return;
+            }
+        }
+        auto it = std::lower_bound(m_bottom.begin(), m_bottom.end(), ev, Later);
+        NS_ABORT_MSG_IF(it == m_bottom.end() || it->key.m_uid != ev.key.m_uid, "Event not found");
+        m_bottom.erase(it);
+        m_count--;
+    }
+
+private:
+    struct Rung {
+        uint64_t start;     // timestamp of bucket 0
+        uint64_t width;     // timestamps per bucket
+        uint32_t current;   // first bucket that has not been emptied yet
+        std::vector<std::vector<Event>> buckets;
+
+        uint64_t CurrentStart(void) const { return start + current * width; }
+        uint64_t Index(uint64_t ts) const { return (ts - start) / width; }
+    };
+
+    // Bottom is sorted latest first, so the next event is at the back
+    static bool Later(const Event& a, const Event& b) { return b.key < a.key; }
+
+    static bool EraseUnsorted(std::vector<Event>& events, const Event& ev) {
+        for (auto& e : events) {
+            if (e.key.m_uid == ev.key.m_uid) {
+                e = events.back();
+                events.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void InsertBottom(const Event& ev) const {
+        m_bottom.insert(std::upper_bound(m_bottom.begin(), m_bottom.end(), ev, Later), ev);
+    }
+
+    // Spreads the events, all in [start, end), over a new lowest rung
+    void AddRung(const std::vector<Event>& events, uint64_t start, uint64_t end) const {
+        Rung rung;
+        uint64_t span = std::max<uint64_t>(end - start, 1);
+        uint64_t n = std::max<uint64_t>(events.size(), 1);
+        rung.start = start;
+        rung.width = std::max<uint64_t>((span + n - 1) / n, 1);
+        rung.current = 0;
+        rung.buckets.resize((span + rung.width - 1) / rung.width);
+        for (const auto& e : events) {
+            rung.buckets[rung.Index(e.key.m_ts)].push_back(e);
+        }
+        m_rungs.push_back(std::move(rung));
+    }
+
+    // Makes sure Bottom holds the next event
+    void Refill(void) const {
+        while (m_bottom.empty()) {
+            if (m_rungs.empty()) {
+                // Move Top to a first rung; later events keep going to Top
+                NS_ASSERT(!m_top.empty());
+                std::vector<Event> events;
+                events.swap(m_top);
+                AddRung(events, m_topMin, m_topMax + 1);
+                const Rung& rung = m_rungs.back();
+                m_topStart = rung.start + rung.buckets.size() * rung.width;
+                m_topMin = std::numeric_limits<uint64_t>::max();
+                m_topMax = 0;
+                continue;
+            }
+
+            Rung& rung = m_rungs.back();
+            while (rung.current < rung.buckets.size() && rung.buckets[rung.current].empty()) {
+                rung.current++;
+            }
+            if (rung.current == rung.buckets.size()) {
+                m_rungs.pop_back();
+                continue;
+            }
+
+            std::vector<Event> bucket;
+            bucket.swap(rung.buckets[rung.current]);
+            uint64_t bucketStart = rung.CurrentStart();
+            uint64_t width = rung.width;
+            rung.current++;
+            if (bucket.size() > m_threshold && width > 1 && m_rungs.size() < m_maxRungs) {
+                AddRung(bucket, bucketStart, bucketStart + width);   // invalidates rung
+            } else {
+                std::sort(bucket.begin(), bucket.end(), Later);
+                m_bottom.swap(bucket);
+            }
+        }
+    }
+
+    uint32_t m_threshold;
+    uint32_t m_maxRungs;
+    uint64_t m_count;
+
+    // Refill runs from PeekNext, which is const
+    mutable std::vector<Event> m_top;
+    mutable uint64_t m_topStart;
+    mutable uint64_t m_topMin;
+    mutable uint64_t m_topMax;
+    mutable std::vector<Rung> m_rungs;     // back() is the lowest rung
+    mutable std::vector<Event> m_bottom;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(LadderScheduler);
+
+} // namespace ns3
+
+#endif // LADDER_SCHEDULER_H
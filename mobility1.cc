@@ -8,6 +8,8 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/netanim-module.h"
 
+#include "tdma-client-app.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("TdmaDuplexSimImproved");
@@ -20,105 +22,9 @@ const uint32_t kPacketSize = 1024;
 const uint32_t kPacketsPerSlot = 10; // Reduced from 100 packets/second
 const double kGuardTime = 0.001; // 1ms guard time between slots
 
-// Global variables for coordinated scheduling
-std::vector<std::vector<Ptr<Application>>> uplinkApps;
-std::vector<std::vector<Ptr<Application>>> downlinkApps;
-
-class TdmaClientApp : public Application {
-public:
-    TdmaClientApp();
-    virtual ~TdmaClientApp();
-    
-    void Setup(Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets);
-    void SetStartStopTime(Time startTime, Time stopTime);
-
-private:
-    virtual void StartApplication(void);
-    virtual void StopApplication(void);
-    
-    void SendPacket(void);
-    void ScheduleNextTx(void);
-    
-    Ptr<Socket> m_socket;
-    Address m_peer;
-    uint32_t m_packetSize;
-    uint32_t m_nPackets;
-    uint32_t m_count;
-    EventId m_sendEvent;
-    Time m_interval;
-    Time m_startTime;
-    Time m_stopTime;
-};
-
-TdmaClientApp::TdmaClientApp()
-    : m_socket(0),
-      m_packetSize(0),
-      m_nPackets(0),
-      m_count(0) {
-}
-
-TdmaClientApp::~TdmaClientApp() {
-    m_socket = 0;
-}
-
-void TdmaClientApp::Setup(Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets) {
-    m_socket = socket;
-    m_peer = address;
-    m_packetSize = packetSize;
-    m_nPackets = nPackets;
-    m_interval = Seconds((kSlotDuration - kGuardTime) / nPackets);
-}
-
-void TdmaClientApp::SetStartStopTime(Time startTime, Time stopTime) {
-    m_startTime = startTime;
-    m_stopTime = stopTime;
-    Application::SetStartTime(startTime);
-    Application::SetStopTime(stopTime);
-}
-
-void TdmaClientApp::StartApplication(void) {
-    m_socket->Bind();         // Ensure the socket is bound to local address
-    m_socket->Connect(m_peer); // Connect to peer
-
-    m_count = 0;
-    if (Simulator::Now() < m_startTime) {
-        Simulator::Schedule(m_startTime - Simulator::Now(), &TdmaClientApp::StartApplication, this);
-        return;
-    }
-    if (Simulator::Now() > m_stopTime) {
-        return; // Don't start if current time exceeds stop time
-    }
-    m_sendEvent = Simulator::ScheduleNow(&TdmaClientApp::SendPacket, this);
-
-}
-
-void TdmaClientApp::StopApplication(void) {
-    if (m_sendEvent.IsPending()) {
-        Simulator::Cancel(m_sendEvent);
-    }
-    if (m_socket) {
-        m_socket->Close();
-    }
-}
-
-void TdmaClientApp::SendPacket(void) {
-    NS_LOG_INFO("Sending packet at " << Simulator::Now().GetSeconds());
-    if (Simulator::Now() >= m_stopTime) {
-        return;
-    }
-
-    Ptr<Packet> packet = Create<Packet>(m_packetSize);
-    m_socket->Send(packet);
-    m_count++;
-
-    if (m_count < m_nPackets && Simulator::Now() + m_interval < m_stopTime) {
-        ScheduleNextTx();
-    }
-}
-
-void TdmaClientApp::ScheduleNextTx(void) {
-    m_sendEvent = Simulator::Schedule(m_interval, &TdmaClientApp::SendPacket, this);
-}
+// One persistent TDMA application per UE and direction
+std::vector<Ptr<TdmaClientApp>> uplinkApps;
+std::vector<Ptr<TdmaClientApp>> downlinkApps;
 
 int main(int argc, char *argv[]) {
     // Enhanced command line parsing
@@ -270,46 +176,49 @@ int main(int argc, char *argv[]) {
     NS_LOG_INFO("  Cycle Duration: " << cycleDuration << "s");
     NS_LOG_INFO("  Number of Cycles: " << numCycles);
 
-    for (uint32_t cycle = 0; cycle < numCycles; ++cycle) {
-        double cycleStartTime = cycle * cycleDuration;
-        
-        for (uint32_t i = 0; i < numUes; ++i) {
-            double uplinkStart = cycleStartTime + i * 2 * slotDuration;
-            double downlinkStart = uplinkStart + slotDuration;
-            
-            // Create uplink application (UE -> BS)
-            TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
-            
-            Ptr<Socket> uplinkSocket = Socket::CreateSocket(ueNodes.Get(i), tid);
-            InetSocketAddress uplinkDest = InetSocketAddress(bsInterface.GetAddress(0), uplinkPort);
-
-
-            
-            Ptr<TdmaClientApp> uplinkApp = CreateObject<TdmaClientApp>();
-            uplinkApp->Setup(uplinkSocket, uplinkDest, packetSize, kPacketsPerSlot);
-            uplinkApp->SetStartStopTime(Seconds(uplinkStart), Seconds(uplinkStart + slotDuration - kGuardTime));
-            uplinkApp->SetStartTime(Seconds(uplinkStart));
-            uplinkApp->SetStopTime(Seconds(uplinkStart + slotDuration - kGuardTime));
-
-            ueNodes.Get(i)->AddApplication(uplinkApp);
-            uplinkApps[i].push_back(uplinkApp);
-            
-            // Create downlink application (BS -> UE)
-            Ptr<Socket> downlinkSocket = Socket::CreateSocket(bsNode.Get(0), tid);
-            InetSocketAddress downlinkDest = InetSocketAddress(ueInterfaces.GetAddress(i), downlinkPort);
-
-            
-            Ptr<TdmaClientApp> downlinkApp = CreateObject<TdmaClientApp>();
-            downlinkApp->Setup(downlinkSocket, downlinkDest, packetSize, kPacketsPerSlot);
-            downlinkApp->SetStartStopTime(Seconds(downlinkStart), Seconds(downlinkStart + slotDuration - kGuardTime));
-            downlinkApp->SetStartTime(Seconds(downlinkStart));
-            downlinkApp->SetStopTime(Seconds(downlinkStart + slotDuration - kGuardTime));
-
-            bsNode.Get(0)->AddApplication(downlinkApp);
-            downlinkApps[i].push_back(downlinkApp);
-        }
+    TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
+    for (uint32_t i = 0; i < numUes; ++i) {
+        // Create uplink application (UE -> BS)
+        Ptr<Socket> uplinkSocket = Socket::CreateSocket(ueNodes.Get(i), tid);
+        InetSocketAddress uplinkDest = InetSocketAddress(bsInterface.GetAddress(0), uplinkPort);
+
+        Ptr<TdmaClientApp> uplinkApp = CreateObject<TdmaClientApp>();
+        uplinkApp->Setup(uplinkSocket, uplinkDest, packetSize, kPacketsPerSlot);
+        uplinkApp->SetPacketPool(!enableAnimation);
+        uplinkApp->SetStartTime(Seconds(0.0));
+        uplinkApp->SetStopTime(Seconds(simDuration));
+        ueNodes.Get(i)->AddApplication(uplinkApp);
+        uplinkApps[i] = uplinkApp;
+
+        // Create downlink application (BS -> UE)
+        Ptr<Socket> downlinkSocket = Socket::CreateSocket(bsNode.Get(0), tid);
+        InetSocketAddress downlinkDest = InetSocketAddress(ueInterfaces.GetAddress(i), downlinkPort);
+
+        Ptr<TdmaClientApp> downlinkApp = CreateObject<TdmaClientApp>();
+        downlinkApp->Setup(downlinkSocket, downlinkDest, packetSize, kPacketsPerSlot);
+        downlinkApp->SetPacketPool(!enableAnimation);
+        downlinkApp->SetStartTime(Seconds(0.0));
+        downlinkApp->SetStopTime(Seconds(simDuration));
+        bsNode.Get(0)->AddApplication(downlinkApp);
+        downlinkApps[i] = downlinkApp;
     }
 
+    // Fixed frame: UE i sends in slot 2i of every cycle and the BS answers in
+    // slot 2i + 1. The slots are scheduled from a t = 0 event, so the slots at
+    // t = 0 run after the apps have started.
+    const Time txWindow = Seconds(slotDuration - kGuardTime);
+    Simulator::Schedule(Seconds(0.0), [=]() {
+        for (uint32_t cycle = 0; cycle < numCycles; ++cycle) {
+            double cycleStartTime = cycle * cycleDuration;
+
+            for (uint32_t i = 0; i < numUes; ++i) {
+                double uplinkStart = cycleStartTime + i * 2 * slotDuration;
+                double downlinkStart = uplinkStart + slotDuration;
+                Simulator::Schedule(Seconds(uplinkStart), &TdmaClientApp::StartSlot, uplinkApps[i], txWindow);
+                Simulator::Schedule(Seconds(downlinkStart), &TdmaClientApp::StartSlot, downlinkApps[i], txWindow);
+            }
+        }
+    });
 
     // Install Flow Monitor
     FlowMonitorHelper flowmon;
@@ -347,6 +256,7 @@ int main(int argc, char *argv[]) {
     
     NS_LOG_INFO("Starting simulation...");
     Simulator::Run();
+    std::cout << "Executed events: " << Simulator::GetEventCount() << std::endl;
     NS_LOG_INFO("Simulation completed.");
 
     // Analyze results
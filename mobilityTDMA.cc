@@ -8,6 +8,13 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/netanim-module.h"
 
+#include "bounded-animation.h"
+#include "flow-attribution-index.h"
+#include "ladder-scheduler.h"
+#include "profiling-simulator-impl.h"
+#include "tdma-client-app.h"
+#include "tdma-net-device.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("TdmaDuplexSimImproved");
@@ -20,89 +27,9 @@ const uint32_t kPacketSize = 1024;
 const uint32_t kPacketsPerSlot = 10; // Reduced from 100 packets/second
 const double kGuardTime = 0.001; // 1ms guard time between slots
 
-// Global variables for coordinated scheduling
-std::vector<std::vector<Ptr<Application>>> uplinkApps;
-std::vector<std::vector<Ptr<Application>>> downlinkApps;
-
-// Custom application for controlled packet transmission
-class TdmaClientApp : public Application {
-public:
-    TdmaClientApp();
-    virtual ~TdmaClientApp();
-    
-    void Setup(Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets);
-    void SetStartStopTime(Time startTime, Time stopTime);
-
-private:
-    virtual void StartApplication(void);
-    virtual void StopApplication(void);
-    
-    void SendPacket(void);
-    void ScheduleNextTx(void);
-    
-    Ptr<Socket> m_socket;
-    Address m_peer;
-    uint32_t m_packetSize;
-    uint32_t m_nPackets;
-    uint32_t m_count;
-    EventId m_sendEvent;
-    Time m_interval;
-    Time m_startTime;
-    Time m_stopTime;
-};
-
-TdmaClientApp::TdmaClientApp()
-    : m_socket(0),
-      m_packetSize(0),
-      m_nPackets(0),
-      m_count(0) {
-}
-
-TdmaClientApp::~TdmaClientApp() {
-    m_socket = 0;
-}
-
-void TdmaClientApp::Setup(Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets) {
-    m_socket = socket;
-    m_peer = address;
-    m_packetSize = packetSize;
-    m_nPackets = nPackets;
-    m_interval = Seconds((kSlotDuration - kGuardTime) / nPackets);
-}
-
-void TdmaClientApp::SetStartStopTime(Time startTime, Time stopTime) {
-    m_startTime = startTime;
-    m_stopTime = stopTime;
-}
-
-void TdmaClientApp::StartApplication(void) {
-    m_count = 0;
-    m_sendEvent = Simulator::Schedule(Seconds(0.0), &TdmaClientApp::SendPacket, this);
-}
-
-void TdmaClientApp::StopApplication(void) {
-    if (m_sendEvent.IsPending()) {
-        Simulator::Cancel(m_sendEvent);
-    }
-    if (m_socket) {
-        m_socket->Close();
-    }
-}
-
-void TdmaClientApp::SendPacket(void) {
-    Ptr<Packet> packet = Create<Packet>(m_packetSize);
-    m_socket->Send(packet);
-    m_count++;
-    
-    if (m_count < m_nPackets) {
-        ScheduleNextTx();
-    }
-}
-
-void TdmaClientApp::ScheduleNextTx(void) {
-    Time nextTime = m_interval;
-    m_sendEvent = Simulator::Schedule(nextTime, &TdmaClientApp::SendPacket, this);
-}
+// One persistent TDMA application per UE and direction
+std::vector<Ptr<TdmaClientApp>> uplinkApps;
+std::vector<Ptr<TdmaClientApp>> downlinkApps;
 
 int main(int argc, char *argv[]) {
     // Enhanced command line parsing
@@ -111,8 +38,19 @@ int main(int argc, char *argv[]) {
     double simDuration = kSimDuration;
     uint32_t packetSize = kPacketSize;
     bool enableRtsCts = false;
+    bool useTdmaMac = false;
+    std::string slotPolicy = "ns3::TdmaRoundRobinPolicy";
     bool enableAnimation = true;
+    bool profileEvents = false;
+    bool packetPool = true;
+    double offeredLoad = 0.0;
     std::string animationFile = "tdma-animation.xml";
+    bool animFullTrace = false;
+    double animPollInterval = 1.0;
+    double animStart = 0.0;
+    double animWindow = 2.0;
+    uint32_t animSampleEvery = 100;
+    std::string animTraceUes = "";
     
     CommandLine cmd;
     cmd.AddValue("numUes", "Number of UE nodes", numUes);
@@ -120,10 +58,25 @@ int main(int argc, char *argv[]) {
     cmd.AddValue("simDuration", "Total simulation duration (seconds)", simDuration);
     cmd.AddValue("packetSize", "Size of each packet (bytes)", packetSize);
     cmd.AddValue("enableRtsCts", "Enable RTS/CTS for WiFi", enableRtsCts);
+    cmd.AddValue("useTdmaMac", "Use the contention-free TDMA MAC instead of 802.11g", useTdmaMac);
+    cmd.AddValue("slotPolicy", "TypeId of the TdmaSlotPolicy building each frame", slotPolicy);
+    cmd.AddValue("offeredLoad", "Poisson packets per second per UE and direction, 0 for saturated sources", offeredLoad);
     cmd.AddValue("enableAnimation", "Enable NetAnim animation", enableAnimation);
+    cmd.AddValue("profileEvents", "Print wall time and event count per event target at the end of the run", profileEvents);
+    cmd.AddValue("packetPool", "Recycle the payload packets of the TDMA apps (off while animating, packet uids repeat)", packetPool);
     cmd.AddValue("animationFile", "NetAnim XML output file", animationFile);
+    cmd.AddValue("animFullTrace", "Trace every packet in NetAnim (large XML) instead of sampling", animFullTrace);
+    cmd.AddValue("animPollInterval", "NetAnim mobility poll interval (seconds)", animPollInterval);
+    cmd.AddValue("animStart", "Start of the NetAnim XML window (seconds)", animStart);
+    cmd.AddValue("animWindow", "Length of the NetAnim XML window, which traces every packet (seconds)", animWindow);
+    cmd.AddValue("animSampleEvery", "Log 1 in N packets of the traced UEs", animSampleEvery);
+    cmd.AddValue("animTraceUes", "Comma separated UE indices whose packets are logged, empty for all", animTraceUes);
     cmd.Parse(argc, argv);
 
+    if (profileEvents) {
+        GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::ProfilingSimulatorImpl"));
+    }
+
     // Enable logging for debugging
     LogComponentEnable("TdmaDuplexSimImproved", LOG_LEVEL_INFO);
 
@@ -132,44 +85,72 @@ int main(int argc, char *argv[]) {
     bsNode.Create(1);
     ueNodes.Create(numUes);
 
-    // Configure WiFi with optimized settings for TDMA
-    YansWifiChannelHelper channel = YansWifiChannelHelper::Default();
-    // Use a more controlled channel model
-    channel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
-    channel.AddPropagationLoss("ns3::FriisPropagationLossModel");
+    // Central TDMA frame shared by the applications and the TDMA MAC
+    Ptr<TdmaSlotScheduler> slotScheduler = CreateObject<TdmaSlotScheduler>();
+    slotScheduler->SetAttribute("SlotDuration", TimeValue(Seconds(slotDuration)));
+    slotScheduler->SetAttribute("GuardTime", TimeValue(Seconds(kGuardTime)));
+    slotScheduler->SetPolicy(ObjectFactory(slotPolicy).Create<TdmaSlotPolicy>());
+    if (Ptr<TdmaLoadPolicy> loadPolicy = DynamicCast<TdmaLoadPolicy>(slotScheduler->GetPolicy())) {
+        loadPolicy->SetAttribute("PacketsPerSlot", UintegerValue(kPacketsPerSlot));
+    }
+    Time packetTime = (Seconds(slotDuration) - Seconds(kGuardTime)) / kPacketsPerSlot;
+    for (uint32_t i = 0; i < numUes; ++i) {
+        slotScheduler->AddUe(0);
+    }
+
+    NetDeviceContainer ueDevices, bsDevice;
+    if (useTdmaMac) {
+        // Native TDMA MAC: UEs send in their uplink slots, the BS to each UE in its downlink slots
+        TdmaHelper tdma;
+        tdma.SetDeviceAttribute("DataRate", DataRateValue(DataRate("11Mbps")));
+        Ptr<TdmaChannel> tdmaChannel = tdma.CreateChannel();
+
+        ueDevices = tdma.Install(ueNodes, tdmaChannel);
+        bsDevice = tdma.Install(bsNode, tdmaChannel);
+        for (uint32_t i = 0; i < numUes; ++i) {
+            tdma.AssignSlot(ueDevices.Get(i), slotScheduler, i, TDMA_UPLINK);
+            tdma.AssignSlot(bsDevice.Get(0), slotScheduler, i, TDMA_DOWNLINK, ueDevices.Get(i));
+        }
+    } else {
+        // Configure WiFi with optimized settings for TDMA
+        YansWifiChannelHelper channel = YansWifiChannelHelper::Default();
+        // Use a more controlled channel model
+        channel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
+        channel.AddPropagationLoss("ns3::FriisPropagationLossModel");
     
-    YansWifiPhyHelper phy;
-    phy.SetChannel(channel.Create());
+        YansWifiPhyHelper phy;
+        phy.SetChannel(channel.Create());
     
-    // Configure for better TDMA performance
-    WifiHelper wifi;
-    wifi.SetStandard(WIFI_STANDARD_80211g);
-    wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
-                                 "DataMode", StringValue("DsssRate11Mbps"),
-                                 "ControlMode", StringValue("DsssRate1Mbps"));
-
-    WifiMacHelper mac;
-    Ssid ssid = Ssid("tdma-improved");
-
-    // Configure MAC with TDMA-friendly settings
-    mac.SetType("ns3::StaWifiMac",
-                "Ssid", SsidValue(ssid),
-                "ActiveProbing", BooleanValue(false),
-                "QosSupported", BooleanValue(false)); // Disable QoS for simpler scheduling
-
-    NetDeviceContainer ueDevices = wifi.Install(phy, mac, ueNodes);
-
-    mac.SetType("ns3::ApWifiMac",
-                "Ssid", SsidValue(ssid),
-                "QosSupported", BooleanValue(false),
-                "EnableBeaconJitter", BooleanValue(false)); // Disable beacon jitter
-
-    NetDeviceContainer bsDevice = wifi.Install(phy, mac, bsNode);
-
-    // Set RTS/CTS if enabled
-    if (enableRtsCts) {
-        Config::Set("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/RemoteStationManager/RtsCtsThreshold",
-                   UintegerValue(100));
+        // Configure for better TDMA performance
+        WifiHelper wifi;
+        wifi.SetStandard(WIFI_STANDARD_80211g);
+        wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
+                                     "DataMode", StringValue("DsssRate11Mbps"),
+                                     "ControlMode", StringValue("DsssRate1Mbps"));
+
+        WifiMacHelper mac;
+        Ssid ssid = Ssid("tdma-improved");
+
+        // Configure MAC with TDMA-friendly settings
+        mac.SetType("ns3::StaWifiMac",
+                    "Ssid", SsidValue(ssid),
+                    "ActiveProbing", BooleanValue(false),
+                    "QosSupported", BooleanValue(false)); // Disable QoS for simpler scheduling
+
+        ueDevices = wifi.Install(phy, mac, ueNodes);
+
+        mac.SetType("ns3::ApWifiMac",
+                    "Ssid", SsidValue(ssid),
+                    "QosSupported", BooleanValue(false),
+                    "EnableBeaconJitter", BooleanValue(false)); // Disable beacon jitter
+
+        bsDevice = wifi.Install(phy, mac, bsNode);
+
+        // Set RTS/CTS if enabled
+        if (enableRtsCts) {
+            Config::Set("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/RemoteStationManager/RtsCtsThreshold",
+                       UintegerValue(100));
+        }
     }
 
     // Configure mobility with realistic positioning
@@ -204,6 +185,10 @@ int main(int argc, char *argv[]) {
     Ipv4InterfaceContainer bsInterface = ipv4.Assign(bsDevice);
     Ipv4InterfaceContainer ueInterfaces = ipv4.Assign(ueDevices);
 
+    if (useTdmaMac) {
+        TdmaHelper::PopulateNeighbours();
+    }
+
     uint16_t uplinkPort = 5000;
     uint16_t downlinkPort = 5001;
 
@@ -222,52 +207,65 @@ int main(int argc, char *argv[]) {
         ueServers.Add(app);
     }
 
-    // Create TDMA applications with improved scheduling
+    // Create one persistent TDMA application per UE and direction
     uplinkApps.resize(numUes);
     downlinkApps.resize(numUes);
 
-    // Calculate number of TDMA cycles that fit in simulation duration
+    // With round-robin each UE owns an uplink slot followed by a downlink slot
     double cycleDuration = 2 * slotDuration * numUes;
     uint32_t numCycles = static_cast<uint32_t>(simDuration / cycleDuration);
 
     NS_LOG_INFO("TDMA Configuration:");
     NS_LOG_INFO("  Number of UEs: " << numUes);
     NS_LOG_INFO("  Slot Duration: " << slotDuration << "s");
+    NS_LOG_INFO("  Slot Policy: " << slotPolicy);
+    NS_LOG_INFO("  Offered Load: " << (offeredLoad > 0 ? std::to_string(offeredLoad) + " pkt/s" : "saturated"));
     NS_LOG_INFO("  Cycle Duration: " << cycleDuration << "s");
     NS_LOG_INFO("  Number of Cycles: " << numCycles);
 
-    for (uint32_t cycle = 0; cycle < numCycles; ++cycle) {
-        double cycleStartTime = cycle * cycleDuration;
+    // Fixed streams for the offered-load arrivals, so runs only vary with RngRun
+    int64_t stream = 100;
+    TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
+    for (uint32_t i = 0; i < numUes; ++i) {
+        // Create uplink application (UE -> BS)
+        Ptr<Socket> uplinkSocket = Socket::CreateSocket(ueNodes.Get(i), tid);
+        InetSocketAddress uplinkDest = InetSocketAddress(bsInterface.GetAddress(0), uplinkPort);
         
-        for (uint32_t i = 0; i < numUes; ++i) {
-            double uplinkStart = cycleStartTime + i * 2 * slotDuration;
-            double downlinkStart = uplinkStart + slotDuration;
-            
-            // Create uplink application (UE -> BS)
-            TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
-            Ptr<Socket> uplinkSocket = Socket::CreateSocket(ueNodes.Get(i), tid);
-            InetSocketAddress uplinkDest = InetSocketAddress(bsInterface.GetAddress(0), uplinkPort);
-            uplinkSocket->Connect(uplinkDest);
-            
-            Ptr<TdmaClientApp> uplinkApp = CreateObject<TdmaClientApp>();
-            uplinkApp->Setup(uplinkSocket, uplinkDest, packetSize, kPacketsPerSlot);
-            uplinkApp->SetStartStopTime(Seconds(uplinkStart), Seconds(uplinkStart + slotDuration - kGuardTime));
-            ueNodes.Get(i)->AddApplication(uplinkApp);
-            uplinkApps[i].push_back(uplinkApp);
-            
-            // Create downlink application (BS -> UE)
-            Ptr<Socket> downlinkSocket = Socket::CreateSocket(bsNode.Get(0), tid);
-            InetSocketAddress downlinkDest = InetSocketAddress(ueInterfaces.GetAddress(i), downlinkPort);
-            downlinkSocket->Connect(downlinkDest);
-            
-            Ptr<TdmaClientApp> downlinkApp = CreateObject<TdmaClientApp>();
-            downlinkApp->Setup(downlinkSocket, downlinkDest, packetSize, kPacketsPerSlot);
-            downlinkApp->SetStartStopTime(Seconds(downlinkStart), Seconds(downlinkStart + slotDuration - kGuardTime));
-            bsNode.Get(0)->AddApplication(downlinkApp);
-            downlinkApps[i].push_back(downlinkApp);
-        }
+        Ptr<TdmaClientApp> uplinkApp = CreateObject<TdmaClientApp>();
+        uplinkApp->Setup(uplinkSocket, uplinkDest, packetSize, kPacketsPerSlot);
+        uplinkApp->SetPacketPool(packetPool && !enableAnimation);
+        stream += uplinkApp->AssignStreams(stream);
+        uplinkApp->SetOfferedLoad(offeredLoad, packetTime);
+        uplinkApp->SetStartTime(Seconds(0.0));
+        uplinkApp->SetStopTime(Seconds(simDuration));
+        ueNodes.Get(i)->AddApplication(uplinkApp);
+        slotScheduler->AddSlotListener(i, TDMA_UPLINK, MakeCallback(&TdmaClientApp::StartSlot, uplinkApp));
+        uplinkApps[i] = uplinkApp;
+        
+        // Create downlink application (BS -> UE)
+        Ptr<Socket> downlinkSocket = Socket::CreateSocket(bsNode.Get(0), tid);
+        InetSocketAddress downlinkDest = InetSocketAddress(ueInterfaces.GetAddress(i), downlinkPort);
+        
+        Ptr<TdmaClientApp> downlinkApp = CreateObject<TdmaClientApp>();
+        downlinkApp->Setup(downlinkSocket, downlinkDest, packetSize, kPacketsPerSlot);
+        downlinkApp->SetPacketPool(packetPool && !enableAnimation);
+        stream += downlinkApp->AssignStreams(stream);
+        downlinkApp->SetOfferedLoad(offeredLoad, packetTime);
+        downlinkApp->SetStartTime(Seconds(0.0));
+        downlinkApp->SetStopTime(Seconds(simDuration));
+        bsNode.Get(0)->AddApplication(downlinkApp);
+        slotScheduler->AddSlotListener(i, TDMA_DOWNLINK, MakeCallback(&TdmaClientApp::StartSlot, downlinkApp));
+        downlinkApps[i] = downlinkApp;
     }
 
+    Ptr<TdmaDemandPolicy> demandPolicy = DynamicCast<TdmaDemandPolicy>(slotScheduler->GetPolicy());
+    if (demandPolicy) {
+        demandPolicy->SetDemandCallback([](uint32_t ue, TdmaDirection dir) {
+            return dir == TDMA_UPLINK ? uplinkApps[ue]->GetBacklog() : downlinkApps[ue]->GetBacklog();
+        });
+    }
+    slotScheduler->Start(Seconds(0.0));
+
 
     // Install Flow Monitor
     FlowMonitorHelper flowmon;
@@ -275,6 +273,7 @@ int main(int argc, char *argv[]) {
 
     // Configure NetAnim animation
     AnimationInterface* anim = nullptr;
+    SampledPacketLog* packetLog = nullptr;
     if (enableAnimation) {
         anim = new AnimationInterface(animationFile);
 
@@ -290,8 +289,21 @@ int main(int argc, char *argv[]) {
             anim->UpdateNodeSize(ue, 3.0, 3.0);
         }
 
-        anim->EnablePacketMetadata(true);
-        anim->EnableIpv4RouteTracking("tdma-packets", Seconds(0), Seconds(simDuration));
+        if (animFullTrace) {
+            anim->EnablePacketMetadata(true);
+            anim->EnableIpv4RouteTracking("tdma-packets", Seconds(0), Seconds(simDuration));
+        } else {
+            // Every packet in a short window, positions at a coarse period and
+            // 1-in-N packets of the selected UEs over the whole run
+            ConfigureBoundedAnimation(*anim, Seconds(animPollInterval), Seconds(animStart),
+                                      Seconds(animStart + animWindow));
+            packetLog = new SampledPacketLog("tdma-packets", animSampleEvery, 1000000, true);
+            packetLog->SetAnimation(anim);
+            for (uint32_t ue : ParseUeList(animTraceUes, numUes)) {
+                packetLog->TraceUe(ueNodes.Get(ue));
+            }
+            packetLog->TraceServingNodes(bsNode);
+        }
 
         NS_LOG_INFO("NetAnim animation enabled. Output file: " << animationFile);
     }
@@ -305,11 +317,20 @@ int main(int argc, char *argv[]) {
     
     NS_LOG_INFO("Starting simulation...");
     Simulator::Run();
+    std::cout << "Executed events: " << Simulator::GetEventCount() << std::endl;
     NS_LOG_INFO("Simulation completed.");
 
     // Analyze results
     Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
-    FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats();
+    const FlowMonitor::FlowStatsContainer& stats = monitor->GetFlowStats();
+
+    // Flow -> (UE, direction) index, built once
+    FlowAttributionIndex attribution(classifier);
+    attribution.AddUes(ueInterfaces, 0, 0);
+    attribution.AddBss(bsInterface);
+    attribution.SetPortDirection(uplinkPort, FLOW_UPLINK);
+    attribution.SetPortDirection(downlinkPort, FLOW_DOWNLINK);
+    const char* directionNames[] = {"Uplink", "Downlink", "Unknown"};
 
     // Create output file with timestamp
     std::string filename = "tdma_improved_results_" + std::to_string(numUes) + "ues.csv";
@@ -324,24 +345,11 @@ int main(int argc, char *argv[]) {
     uint32_t validFlows = 0;
 
     for (const auto& flow : stats) {
-        Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(flow.first);
-        
         // Determine UE ID and direction
-        uint32_t ueId = 0;
-        std::string direction = "Unknown";
-        
-        // Find which UE this flow belongs to
-        for (uint32_t i = 0; i < numUes; ++i) {
-            if (t.sourceAddress == ueInterfaces.GetAddress(i)) {
-                ueId = i;
-                direction = "Uplink";
-                break;
-            } else if (t.destinationAddress == ueInterfaces.GetAddress(i)) {
-                ueId = i;
-                direction = "Downlink";
-                break;
-            }
-        }
+        const FlowAttribution& a = attribution.Classify(flow.first);
+        const Ipv4FlowClassifier::FiveTuple& t = a.tuple;
+        uint32_t ueId = a.ue != FlowAttribution::NONE ? a.ue : 0;
+        std::string direction = directionNames[a.direction];
 
         // Calculate metrics
         double delay = flow.second.rxPackets > 0 ?
@@ -390,6 +398,7 @@ int main(int argc, char *argv[]) {
     if (anim) {
         delete anim;
     }
+    delete packetLog;
     
     return 0;
 }
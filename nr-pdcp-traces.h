@@ -0,0 +1,49 @@
+#ifndef NR_PDCP_TRACES_H
+#define NR_PDCP_TRACES_H
+
+#include "ns3/core-module.h"
+
+#include "config-context.h"
+
+#include <string>
+
+namespace ns3 {
+
+// Which data radio bearers ConnectNrPdcpTrace and ConnectNrRlcTrace hook
+enum NrPdcpSide {
+    NR_PDCP_UE = 1,
+    NR_PDCP_GNB = 2,
+    NR_PDCP_BOTH = 3
+};
+
+// Connects cb, with context, to a PDCP trace source (e.g. "TxPDU", "RxPDU")
+// of every data radio bearer of the UEs and/or the gNBs. The DRBs, and their
+// PDCP entities, only exist once the bearers are set up, so this has to run
+// when the traffic starts; bearers set up later are not connected.
+inline void ConnectNrDrbTrace(const std::string& layer, const std::string& trace, const CallbackBase& cb,
+                              NrPdcpSide side) {
+    if (side & NR_PDCP_UE) {
+        Config::ConnectFailSafe(
+            "/NodeList/*/DeviceList/*/$ns3::NrUeNetDevice/NrUeRrc/DataRadioBearerMap/*/" + layer + "/" + trace, cb);
+    }
+    if (side & NR_PDCP_GNB) {
+        Config::ConnectFailSafe("/NodeList/*/DeviceList/*/$ns3::NrGnbNetDevice/NrGnbRrc/UeMap/*/DataRadioBearerMap/*/" +
+                                    layer + "/" + trace,
+                                cb);
+    }
+}
+
+inline void ConnectNrPdcpTrace(const std::string& trace, const CallbackBase& cb,
+                               NrPdcpSide side = NR_PDCP_BOTH) {
+    ConnectNrDrbTrace("NrPdcp", trace, cb, side);
+}
+
+// Same for an RLC trace source (e.g. "TxDrop") of the data radio bearers
+inline void ConnectNrRlcTrace(const std::string& trace, const CallbackBase& cb,
+                              NrPdcpSide side = NR_PDCP_BOTH) {
+    ConnectNrDrbTrace("NrRlc", trace, cb, side);
+}
+
+} // namespace ns3
+
+#endif // NR_PDCP_TRACES_H
@@ -0,0 +1,204 @@
+#ifndef NR_TTI_TIMELINE_H
+#define NR_TTI_TIMELINE_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/nr-module.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <tuple>
+#include <vector>
+
+namespace ns3 {
+
+// Per-TTI record of what the NR MAC schedulers allocated and what the PHYs
+// decoded. It hooks the DlScheduling/UlScheduling traces of every gNB MAC and
+// the RxPacketTrace of every spectrum PHY, one 16 byte record per transport
+// block, into a fixed-size ring buffer; once the buffer is full the oldest
+// records are overwritten. Nothing is aggregated during the run: Write folds
+// the retained records into windows of a given width, per UE and BWP, so the
+// share each UE got from the scheduler can be followed over time without a
+// per-packet log.
+class NrTtiTimeline : public Object {
+public:
+    enum Kind : uint8_t {
+        DL_SCHEDULED = 0,
+        UL_SCHEDULED = 1,
+        DL_DELIVERED = 2,
+        UL_DELIVERED = 3
+    };
+
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::NrTtiTimeline")
+            .SetParent<Object>()
+            .SetGroupName("Nr")
+            .AddConstructor<NrTtiTimeline>()
+            .AddAttribute("Capacity",
+                          "Records kept in the ring buffer",
+                          UintegerValue(1 << 20),
+                          MakeUintegerAccessor(&NrTtiTimeline::m_capacity),
+                          MakeUintegerChecker<uint32_t>(1));
+        return tid;
+    }
+
+    NrTtiTimeline() : m_capacity(1 << 20), m_head(0), m_overwritten(0) {}
+
+    // Connects the traces of the gNBs and UEs. The UEs are numbered in the
+    // order of ueDevs; their RNTIs are resolved when the timeline is written.
+    void Install(const NetDeviceContainer& gnbDevs, const NetDeviceContainer& ueDevs) {
+        m_ring.reserve(m_capacity);
+        m_ueDevs = ueDevs;
+        for (uint32_t i = 0; i < gnbDevs.GetN(); ++i) {
+            Ptr<NrGnbNetDevice> gnb = DynamicCast<NrGnbNetDevice>(gnbDevs.Get(i));
+            NS_ASSERT_MSG(gnb, "Not an NR gNB device");
+            uint16_t cellId = gnb->GetCellId();
+            for (uint32_t bwp = 0; bwp < gnb->GetCcMapSize(); ++bwp) {
+                gnb->GetMac(bwp)->TraceConnectWithoutContext(
+                    "DlScheduling", MakeBoundCallback(&NrTtiTimeline::Scheduled, this, cellId, DL_SCHEDULED));
+                gnb->GetMac(bwp)->TraceConnectWithoutContext(
+                    "UlScheduling", MakeBoundCallback(&NrTtiTimeline::Scheduled, this, cellId, UL_SCHEDULED));
+                gnb->GetPhy(bwp)->GetSpectrumPhy()->TraceConnectWithoutContext(
+                    "RxPacketTraceGnb", MakeBoundCallback(&NrTtiTimeline::Received, this, UL_DELIVERED));
+            }
+        }
+        for (uint32_t i = 0; i < ueDevs.GetN(); ++i) {
+            Ptr<NrUeNetDevice> ue = DynamicCast<NrUeNetDevice>(ueDevs.Get(i));
+            NS_ASSERT_MSG(ue, "Not an NR UE device");
+            for (uint32_t bwp = 0; bwp < ue->GetCcMapSize(); ++bwp) {
+                ue->GetPhy(bwp)->GetSpectrumPhy()->TraceConnectWithoutContext(
+                    "RxPacketTraceUe", MakeBoundCallback(&NrTtiTimeline::Received, this, DL_DELIVERED));
+            }
+        }
+    }
+
+    uint64_t GetNRecords(void) const { return m_ring.size(); }
+    uint64_t GetOverwritten(void) const { return m_overwritten; }
+
+    // Writes one CSV row per (window, UE, BWP) with traffic, and a short
+    // per-window summary: delivered throughput, UEs that got an allocation
+    // and Jain's fairness index of the DL bytes delivered to them.
+    void Write(Time window, std::ostream& csv, std::ostream& summary) const {
+        NS_ASSERT_MSG(window.IsStrictlyPositive(), "Window must be positive");
+        uint64_t windowUs = std::max<int64_t>(window.GetMicroSeconds(), 1);
+
+        std::map<std::pair<uint16_t, uint16_t>, uint32_t> ueOf;
+        for (uint32_t i = 0; i < m_ueDevs.GetN(); ++i) {
+            Ptr<NrUeRrc> rrc = DynamicCast<NrUeNetDevice>(m_ueDevs.Get(i))->GetRrc();
+            ueOf[{rrc->GetCellId(), rrc->GetRnti()}] = i;
+        }
+
+        std::map<std::tuple<uint32_t, uint32_t, uint8_t>, WindowStats> windows;
+        uint64_t unknown = 0;
+        uint64_t n = m_ring.size();
+        uint64_t first = n < m_capacity ? 0 : m_head;
+        for (uint64_t k = 0; k < n; ++k) {
+            const Record& r = m_ring[(first + k) % n];
+            auto ue = ueOf.find({r.cellId, r.rnti});
+            if (ue == ueOf.end()) {
+                unknown++;
+                continue;
+            }
+            WindowStats& s = windows[std::make_tuple(r.timeUs / windowUs, ue->second, r.bwp)];
+            s.bytes[r.kind] += r.bytes;
+            s.tbs[r.kind]++;
+        }
+
+        csv << "window_start_s,ue,bwp,dl_sched_bytes,dl_sched_tbs,dl_rx_bytes,ul_sched_bytes,ul_sched_tbs,ul_rx_bytes\n";
+        for (const auto& entry : windows) {
+            const WindowStats& s = entry.second;
+            csv << std::get<0>(entry.first) * windowUs / 1e6 << "," << std::get<1>(entry.first) << ","
+                << +std::get<2>(entry.first) << "," << s.bytes[DL_SCHEDULED] << "," << s.tbs[DL_SCHEDULED] << ","
+                << s.bytes[DL_DELIVERED] << "," << s.bytes[UL_SCHEDULED] << "," << s.tbs[UL_SCHEDULED] << ","
+                << s.bytes[UL_DELIVERED] << "\n";
+        }
+
+        summary << "TTI timeline: " << n << " records, " << m_overwritten << " overwritten, "
+                << unknown << " without a UE\n";
+        summary << std::setw(10) << "window(s)" << std::setw(12) << "DL(Mbps)" << std::setw(12) << "UL(Mbps)"
+                << std::setw(8) << "UEs" << std::setw(10) << "DL Jain" << "\n";
+        auto it = windows.begin();
+        while (it != windows.end()) {
+            uint32_t w = std::get<0>(it->first);
+            std::map<uint32_t, double> dlPerUe;
+            uint64_t dl = 0;
+            uint64_t ul = 0;
+            for (; it != windows.end() && std::get<0>(it->first) == w; ++it) {
+                const WindowStats& s = it->second;
+                dl += s.bytes[DL_DELIVERED];
+                ul += s.bytes[UL_DELIVERED];
+                if (s.tbs[DL_SCHEDULED] + s.tbs[UL_SCHEDULED] > 0) {
+                    dlPerUe[std::get<1>(it->first)] += s.bytes[DL_DELIVERED];
+                }
+            }
+            double sum = 0.0;
+            double sumSq = 0.0;
+            for (const auto& ue : dlPerUe) {
+                sum += ue.second;
+                sumSq += ue.second * ue.second;
+            }
+            double jain = sumSq > 0 ? sum * sum / (dlPerUe.size() * sumSq) : 0.0;
+            double seconds = windowUs / 1e6;
+            summary << std::fixed << std::setprecision(3) << std::setw(10) << w * seconds
+                    << std::setw(12) << dl * 8.0 / seconds / 1e6 << std::setw(12) << ul * 8.0 / seconds / 1e6
+                    << std::setw(8) << dlPerUe.size() << std::setw(10) << jain << "\n";
+        }
+    }
+
+protected:
+    void DoDispose(void) override {
+        m_ring.clear();
+        m_ueDevs = NetDeviceContainer();
+        Object::DoDispose();
+    }
+
+private:
+    struct Record {
+        uint32_t timeUs;
+        uint32_t bytes;
+        uint16_t cellId;
+        uint16_t rnti;
+        uint8_t bwp;
+        uint8_t kind;
+    };
+
+    struct WindowStats {
+        uint64_t bytes[4] = {0, 0, 0, 0};
+        uint32_t tbs[4] = {0, 0, 0, 0};
+    };
+
+    static void Scheduled(NrTtiTimeline* timeline, uint16_t cellId, uint8_t kind, NrSchedulingCallbackInfo info) {
+        timeline->Push(cellId, info.m_rnti, info.m_bwpId, kind, info.m_tbSize);
+    }
+
+    static void Received(NrTtiTimeline* timeline, uint8_t kind, RxPacketTraceParams params) {
+        if (!params.m_corrupt) {
+            timeline->Push(params.m_cellId, params.m_rnti, params.m_bwpId, kind, params.m_tbSize);
+        }
+    }
+
+    void Push(uint16_t cellId, uint16_t rnti, uint8_t bwp, uint8_t kind, uint32_t bytes) {
+        Record r = {static_cast<uint32_t>(Simulator::Now().GetMicroSeconds()), bytes, cellId, rnti, bwp, kind};
+        if (m_ring.size() < m_capacity) {
+            m_ring.push_back(r);
+            return;
+        }
+        m_ring[m_head] = r;
+        m_head = (m_head + 1) % m_capacity;
+        m_overwritten++;
+    }
+
+    uint32_t m_capacity;
+    std::vector<Record> m_ring;
+    uint32_t m_head;    // oldest record once the ring is full
+    uint64_t m_overwritten;
+    NetDeviceContainer m_ueDevs;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(NrTtiTimeline);
+
+} // namespace ns3
+
+#endif // NR_TTI_TIMELINE_H
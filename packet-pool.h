@@ -0,0 +1,89 @@
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include <vector>
+
+namespace ns3 {
+
+// Recycles the payload packets of a constant-size synthetic source. The UDP
+// socket sends a copy of the packet it is given, so once Send() has returned
+// the source's packet is usually referenced by the pool alone and can be
+// handed out again, instead of a new Packet with its own buffer, metadata and
+// tag lists. A packet still referenced elsewhere (queued, held by a trace
+// sink) is skipped, and one that no longer has the payload size is replaced.
+//
+// A recycled packet keeps its uid, so packets of one source share a few uids.
+// Keep the pool off when packets are followed by uid (NetAnim packet tracing,
+// SampledPacketLog).
+class PacketPool {
+public:
+    PacketPool()
+        : m_size(0),
+          m_capacity(8),
+          m_enabled(true),
+          m_next(0),
+          m_allocated(0),
+          m_reused(0) {}
+
+    void SetPacketSize(uint32_t size) {
+        m_size = size;
+        m_packets.clear();
+        m_next = 0;
+    }
+
+    void SetEnabled(bool enabled) {
+        m_enabled = enabled;
+        if (!enabled) {
+            m_packets.clear();
+            m_next = 0;
+        }
+    }
+
+    Ptr<Packet> Get(void) {
+        if (m_enabled) {
+            // Round robin: the oldest packet is the most likely to be free
+            for (uint32_t n = 0; n < m_packets.size(); ++n) {
+                Ptr<Packet>& p = m_packets[m_next];
+                m_next = (m_next + 1) % m_packets.size();
+                if (p->GetReferenceCount() != 1) {
+                    continue;
+                }
+                if (p->GetSize() != m_size) {
+                    p = Create<Packet>(m_size);
+                    m_allocated++;
+                    return p;
+                }
+                p->RemoveAllPacketTags();
+                p->RemoveAllByteTags();
+                m_reused++;
+                return p;
+            }
+        }
+
+        Ptr<Packet> p = Create<Packet>(m_size);
+        m_allocated++;
+        if (m_enabled && m_packets.size() < m_capacity) {
+            m_packets.push_back(p);
+        }
+        return p;
+    }
+
+    uint64_t GetAllocated(void) const { return m_allocated; }
+    uint64_t GetReused(void) const { return m_reused; }
+
+private:
+    uint32_t m_size;
+    uint32_t m_capacity;
+    bool m_enabled;
+    uint32_t m_next;
+    std::vector<Ptr<Packet>> m_packets;
+    uint64_t m_allocated;
+    uint64_t m_reused;
+};
+
+} // namespace ns3
+
+#endif // PACKET_POOL_H
@@ -0,0 +1,435 @@
+#ifndef PARALLEL_BEAMFORMING_H
+#define PARALLEL_BEAMFORMING_H
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/spectrum-module.h"
+#include "ns3/antenna-module.h"
+#include "ns3/beamforming-vector.h"
+#include "ns3/ideal-beamforming-algorithm.h"
+#include "ns3/nr-gnb-net-device.h"
+#include "ns3/nr-ue-net-device.h"
+#include "ns3/nr-gnb-phy.h"
+#include "ns3/nr-ue-phy.h"
+#include "ns3/nr-spectrum-phy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+
+// Beam search for all gNB-UE links of a scenario in one batch, spread over a
+// pool of threads. A batch runs in two phases:
+//  - serially, in link order: the 3GPP channel matrix of every link is
+//    generated or updated and the beam codebook of every antenna is built.
+//    This is the only part that touches the channel model and its random
+//    variables, so it draws them in the same order whatever the thread count.
+//  - in parallel: every link sweeps all (gNB beam, UE beam) pairs of the
+//    codebooks against its now immutable channel matrix. Results are stored
+//    by link index, so they do not depend on which thread did the work.
+// The beams are then applied serially by IdealBeamformingHelper, which asks
+// ParallelCellScanBeamforming for them. A batch is run on the first request
+// at a new simulation time, i.e. once at attach time and once per
+// BeamformingPeriodicity. The worker threads are started by the first batch
+// and wait, idle, for the next one until the sweep is disposed, so a batch
+// costs no thread creation.
+//
+// The codebook and the score are the ones of CellScanBeamforming: elevations
+// 60..120 degrees, one sector per antenna row, gNB beams in the outer loop,
+// and the band-averaged received power that ThreeGppSpectrumPropagationLoss-
+// Model computes for the pair. For a link that power is, per band f,
+//   |sum_c L_c(w_s, w_u) D_c exp(-j 2 pi f tau_c)|^2,
+// with the long-term term L_c = w_u^T H_c w_s of cluster c, its Doppler
+// phase D_c and its delay tau_c. Only L_c depends on the beams, so Prepare
+// computes the D_c exp(-j 2 pi f tau_c) factors of every link once, serially,
+// and the threads only evaluate the sum. With Verify set, every batch is
+// checked against CellScanBeamforming on the same links and the run aborts
+// on the first link where the two pick a different beam pair.
+class ParallelBeamSweep : public Object {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::ParallelBeamSweep")
+            .SetParent<Object>()
+            .SetGroupName("Nr")
+            .AddConstructor<ParallelBeamSweep>()
+            .AddAttribute("Threads",
+                          "Number of worker threads, 0 for one per hardware thread",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&ParallelBeamSweep::m_threads),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("BeamSearchAngleStep",
+                          "Elevation step (degrees) of the beam codebook",
+                          DoubleValue(10.0),
+                          MakeDoubleAccessor(&ParallelBeamSweep::m_angleStep),
+                          MakeDoubleChecker<double>(0.1))
+            .AddAttribute("Verify",
+                          "Check every batch against a serial CellScanBeamforming search (slow)",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&ParallelBeamSweep::m_verify),
+                          MakeBooleanChecker());
+        return tid;
+    }
+
+    ParallelBeamSweep()
+        : m_threads(0),
+          m_angleStep(10.0),
+          m_verify(false),
+          m_valid(false),
+          m_batch(0),
+          m_batchSize(0),
+          m_next(0),
+          m_busy(0),
+          m_stop(false) {}
+
+    ~ParallelBeamSweep() override {
+        StopWorkers();
+    }
+
+    // Registers the link on every component carrier of the two devices
+    void AddLink(Ptr<NetDevice> gnb, Ptr<NetDevice> ue) {
+        Ptr<NrGnbNetDevice> gnbDev = DynamicCast<NrGnbNetDevice>(gnb);
+        Ptr<NrUeNetDevice> ueDev = DynamicCast<NrUeNetDevice>(ue);
+        NS_ABORT_MSG_IF(!gnbDev || !ueDev, "ParallelBeamSweep needs NR gNB and UE devices");
+        for (uint32_t cc = 0; cc < gnbDev->GetCcMapSize(); ++cc) {
+            Link link;
+            link.gnb = gnbDev->GetPhy(cc)->GetSpectrumPhy();
+            link.ue = ueDev->GetPhy(cc)->GetSpectrumPhy();
+            m_index[LinkKey(PeekPointer(link.gnb), PeekPointer(link.ue))] = m_links.size();
+            m_links.push_back(link);
+        }
+        m_valid = false;
+    }
+
+    uint32_t GetNLinks(void) const { return m_links.size(); }
+
+    // Runs a batch for all registered links now
+    void Compute(void) {
+        size_t n = m_links.size();
+        for (size_t i = 0; i < n; ++i) {
+            Prepare(m_links[i]);
+        }
+
+        m_results.assign(n, BeamformingVectorPair());
+        uint32_t threads = m_threads > 0 ? m_threads : std::max(1u, std::thread::hardware_concurrency());
+        threads = std::min<uint32_t>(threads, std::max<size_t>(n, 1));
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            while (m_workers.size() + 1 < threads) {
+                m_workers.emplace_back(&ParallelBeamSweep::WorkerLoop, this, m_batch);
+            }
+            m_batchSize = n;
+            m_next = 0;
+            m_busy = m_workers.size();
+            m_batch++;
+        }
+        m_start.notify_all();
+
+        // The calling thread takes its share, then waits for the workers
+        RunBatch();
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [this]() { return m_busy == 0; });
+        }
+
+        m_computedAt = Simulator::Now();
+        m_valid = true;
+        if (m_verify) {
+            Verify();
+        }
+    }
+
+    BeamformingVectorPair GetBeamformingVectors(const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                                                const Ptr<NrSpectrumPhy>& ueSpectrumPhy) {
+        auto it = m_index.find(LinkKey(PeekPointer(gnbSpectrumPhy), PeekPointer(ueSpectrumPhy)));
+        if (it == m_index.end()) {
+            // Link not known in advance (e.g. after a handover): search it alone
+            Link link;
+            link.gnb = gnbSpectrumPhy;
+            link.ue = ueSpectrumPhy;
+            Prepare(link);
+            return Search(link);
+        }
+        if (!m_valid || Simulator::Now() != m_computedAt) {
+            Compute();
+        }
+        return m_results[it->second];
+    }
+
+protected:
+    void DoDispose(void) override {
+        StopWorkers();
+        m_links.clear();
+        m_index.clear();
+        m_results.clear();
+        m_codebooks.clear();
+        Object::DoDispose();
+    }
+
+private:
+    typedef std::pair<const NrSpectrumPhy*, const NrSpectrumPhy*> LinkKey;
+    typedef std::vector<BeamformingVector> Codebook;
+
+    struct Link {
+        Ptr<NrSpectrumPhy> gnb;
+        Ptr<NrSpectrumPhy> ue;
+        // Filled by Prepare, read-only while the threads run
+        Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel;
+        bool reverse = false;       // matrix generated with the UE as transmitter
+        const Codebook* gnbBeams = nullptr;
+        const Codebook* ueBeams = nullptr;
+        // D_c exp(-j 2 pi f tau_c), by band then cluster
+        std::vector<std::complex<double>> bandFactors;
+        size_t bands = 0;
+    };
+
+    // Searches links of the current batch until none is left
+    void RunBatch(void) {
+        for (size_t i = m_next++; i < m_batchSize; i = m_next++) {
+            m_results[i] = Search(m_links[i]);
+        }
+    }
+
+    void WorkerLoop(uint64_t seen) {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_start.wait(lock, [this, seen]() { return m_stop || m_batch != seen; });
+                if (m_stop) {
+                    return;
+                }
+                seen = m_batch;
+            }
+            RunBatch();
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_busy == 0) {
+                m_done.notify_one();
+            }
+        }
+    }
+
+    void StopWorkers(void) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_start.notify_all();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+        m_workers.clear();
+        m_stop = false;
+    }
+
+    void Prepare(Link& link) {
+        Ptr<UniformPlanarArray> gnbAntenna = link.gnb->GetAntenna()->GetObject<UniformPlanarArray>();
+        Ptr<UniformPlanarArray> ueAntenna = link.ue->GetAntenna()->GetObject<UniformPlanarArray>();
+        Ptr<ThreeGppSpectrumPropagationLossModel> model = DynamicCast<ThreeGppSpectrumPropagationLossModel>(
+            link.gnb->GetSpectrumChannel()->GetPhasedArraySpectrumPropagationLossModel());
+        NS_ABORT_MSG_IF(!model, "ParallelBeamSweep needs a ThreeGppSpectrumPropagationLossModel");
+
+        link.channel = model->GetChannelModel()->GetChannel(link.gnb->GetMobility(), link.ue->GetMobility(),
+                                                            gnbAntenna, ueAntenna);
+        link.reverse = link.channel->IsReverse(gnbAntenna->GetId(), ueAntenna->GetId());
+        link.gnbBeams = &GetCodebook(gnbAntenna);
+        link.ueBeams = &GetCodebook(ueAntenna);
+
+        // Beam independent part of ThreeGppSpectrumPropagationLossModel::
+        // CalcBeamformingGain, with the gNB as node a and the UE as node b
+        // as in CellScanBeamforming. The cluster angles are flipped when the
+        // parameters were drawn in the other direction than the matrix.
+        Ptr<const MatrixBasedChannelModel::ChannelParams> params =
+            model->GetChannelModel()->GetParams(link.gnb->GetMobility(), link.ue->GetMobility());
+        bool sameDirection = params->m_nodeIds == link.channel->m_nodeIds;
+        const auto& angle = params->m_angle;
+        const auto& zoa = angle[sameDirection ? MatrixBasedChannelModel::ZOA_INDEX : MatrixBasedChannelModel::ZOD_INDEX];
+        const auto& zod = angle[sameDirection ? MatrixBasedChannelModel::ZOD_INDEX : MatrixBasedChannelModel::ZOA_INDEX];
+        const auto& aoa = angle[sameDirection ? MatrixBasedChannelModel::AOA_INDEX : MatrixBasedChannelModel::AOD_INDEX];
+        const auto& aod = angle[sameDirection ? MatrixBasedChannelModel::AOD_INDEX : MatrixBasedChannelModel::AOA_INDEX];
+        Vector sSpeed = link.gnb->GetMobility()->GetVelocity();
+        Vector uSpeed = link.ue->GetMobility()->GetVelocity();
+        double factor = 2 * M_PI * Simulator::Now().GetSeconds() * model->GetFrequency() / 3e8;
+
+        size_t clusters = link.channel->m_channel.GetNumPages();
+        std::vector<std::complex<double>> doppler(clusters);
+        for (size_t c = 0; c < clusters; ++c) {
+            double za = DegreesToRadians(zoa[c]);
+            double aa = DegreesToRadians(aoa[c]);
+            double zd = DegreesToRadians(zod[c]);
+            double ad = DegreesToRadians(aod[c]);
+            double phase = factor * ((sin(za) * cos(aa) * uSpeed.x + sin(za) * sin(aa) * uSpeed.y + cos(za) * uSpeed.z) +
+                                     (sin(zd) * cos(ad) * sSpeed.x + sin(zd) * sin(ad) * sSpeed.y + cos(zd) * sSpeed.z));
+            doppler[c] = std::complex<double>(cos(phase), sin(phase));
+        }
+
+        Ptr<const SpectrumModel> spectrum = link.gnb->GetRxSpectrumModel();
+        link.bands = spectrum->GetNumBands();
+        link.bandFactors.resize(link.bands * clusters);
+        size_t b = 0;
+        for (auto band = spectrum->Begin(); band != spectrum->End(); ++band, ++b) {
+            for (size_t c = 0; c < clusters; ++c) {
+                double delay = -2 * M_PI * band->fc * params->m_delay[c];
+                link.bandFactors[b * clusters + c] = doppler[c] * std::complex<double>(cos(delay), sin(delay));
+            }
+        }
+    }
+
+    // Runs CellScanBeamforming on every link and aborts on a differing pair
+    void Verify(void) {
+        Ptr<CellScanBeamforming> serial = CreateObject<CellScanBeamforming>();
+        serial->SetAttribute("BeamSearchAngleStep", DoubleValue(m_angleStep));
+        for (size_t i = 0; i < m_links.size(); ++i) {
+            BeamformingVectorPair expected = serial->GetBeamformingVectors(m_links[i].gnb, m_links[i].ue);
+            NS_ABORT_MSG_IF(expected.first.second != m_results[i].first.second ||
+                                expected.second.second != m_results[i].second.second,
+                            "Parallel beam sweep differs from CellScanBeamforming on link " << i << ": gNB "
+                                << m_results[i].first.second << " vs " << expected.first.second << ", UE "
+                                << m_results[i].second.second << " vs " << expected.second.second);
+        }
+    }
+
+    const Codebook& GetCodebook(const Ptr<UniformPlanarArray>& antenna) {
+        Codebook& beams = m_codebooks[PeekPointer(antenna)];
+        if (beams.empty()) {
+            for (double theta = 60; theta < 121; theta += m_angleStep) {
+                for (uint16_t sector = 0; sector <= antenna->GetNumRows(); ++sector) {
+                    beams.emplace_back(CreateDirectionalBfv(antenna, sector, theta), BeamId(sector, theta));
+                }
+            }
+        }
+        return beams;
+    }
+
+    // Pure function of the prepared link, safe to run concurrently. Scores
+    // every (gNB beam, UE beam) pair as CellScanBeamforming does, in the same
+    // order and keeping the first best pair.
+    static BeamformingVectorPair Search(const Link& link) {
+        const auto& h = link.channel->m_channel;
+        size_t rows = h.GetNumRows();
+        size_t cols = h.GetNumCols();
+        size_t clusters = h.GetNumPages();
+        // Columns of the matrix belong to the transmitter s, rows to the
+        // receiver u. The gNB is s unless the matrix is reverse.
+        const Codebook& gnbBeams = *link.gnbBeams;
+        const Codebook& ueBeams = *link.ueBeams;
+
+        // Matrix with the gNB beam applied, per cluster: H_c w_s (length
+        // rows) or w_u^T H_c (length cols) for a reverse matrix
+        size_t partLength = link.reverse ? cols : rows;
+        std::vector<std::complex<double>> part(partLength * clusters);
+        std::vector<std::complex<double>> longTerm(clusters);
+        double best = 0.0;
+        size_t bestGnb = 0;
+        size_t bestUe = 0;
+        for (size_t g = 0; g < gnbBeams.size(); ++g) {
+            const auto& w = gnbBeams[g].first;
+            for (size_t c = 0; c < clusters; ++c) {
+                for (size_t k = 0; k < partLength; ++k) {
+                    std::complex<double> acc = 0;
+                    if (link.reverse) {
+                        for (size_t r = 0; r < rows; ++r) {
+                            acc += w[r] * h(r, k, c);
+                        }
+                    } else {
+                        for (size_t s = 0; s < cols; ++s) {
+                            acc += h(k, s, c) * w[s];
+                        }
+                    }
+                    part[c * partLength + k] = acc;
+                }
+            }
+            for (size_t u = 0; u < ueBeams.size(); ++u) {
+                const auto& v = ueBeams[u].first;
+                for (size_t c = 0; c < clusters; ++c) {
+                    std::complex<double> a = 0;
+                    for (size_t k = 0; k < partLength; ++k) {
+                        a += v[k] * part[c * partLength + k];
+                    }
+                    longTerm[c] = a;
+                }
+                double power = 0;
+                for (size_t b = 0; b < link.bands; ++b) {
+                    std::complex<double> gain = 0;
+                    for (size_t c = 0; c < clusters; ++c) {
+                        gain += longTerm[c] * link.bandFactors[b * clusters + c];
+                    }
+                    power += std::norm(gain);
+                }
+                power /= link.bands;
+                if (best < power) {
+                    best = power;
+                    bestGnb = g;
+                    bestUe = u;
+                }
+            }
+        }
+        return BeamformingVectorPair(gnbBeams[bestGnb], ueBeams[bestUe]);
+    }
+
+    uint32_t m_threads;
+    double m_angleStep;
+    bool m_verify;
+    std::vector<Link> m_links;
+    std::map<LinkKey, size_t> m_index;
+    std::map<const UniformPlanarArray*, Codebook> m_codebooks;
+    std::vector<BeamformingVectorPair> m_results;   // indexed like m_links
+    Time m_computedAt;
+    bool m_valid;
+
+    // Worker pool; batches are handed over and collected under m_mutex
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    uint64_t m_batch;               // generation of the current batch
+    size_t m_batchSize;
+    std::atomic<size_t> m_next;     // next link of the batch to search
+    size_t m_busy;                  // workers still in the current batch
+    bool m_stop;
+};
+
+// Beamforming method for IdealBeamformingHelper that serves the beams of a
+// shared ParallelBeamSweep
+class ParallelCellScanBeamforming : public IdealBeamformingAlgorithm {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::ParallelCellScanBeamforming")
+            .SetParent<IdealBeamformingAlgorithm>()
+            .SetGroupName("Nr")
+            .AddConstructor<ParallelCellScanBeamforming>()
+            .AddAttribute("Sweep",
+                          "The ParallelBeamSweep holding the links of the scenario",
+                          PointerValue(),
+                          MakePointerAccessor(&ParallelCellScanBeamforming::m_sweep),
+                          MakePointerChecker<ParallelBeamSweep>());
+        return tid;
+    }
+
+    BeamformingVectorPair GetBeamformingVectors(const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                                                const Ptr<NrSpectrumPhy>& ueSpectrumPhy) const override {
+        NS_ABORT_MSG_IF(!m_sweep, "ParallelCellScanBeamforming needs a Sweep");
+        return m_sweep->GetBeamformingVectors(gnbSpectrumPhy, ueSpectrumPhy);
+    }
+
+protected:
+    void DoDispose(void) override {
+        m_sweep = nullptr;
+        IdealBeamformingAlgorithm::DoDispose();
+    }
+
+private:
+    Ptr<ParallelBeamSweep> m_sweep;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(ParallelBeamSweep);
+NS_OBJECT_ENSURE_REGISTERED(ParallelCellScanBeamforming);
+
+} // namespace ns3
+
+#endif // PARALLEL_BEAMFORMING_H
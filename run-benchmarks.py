@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+"""Benchmark the scenario programs and compare them with a recorded baseline.
+
+Every scenario is run in a reduced and a full configuration, one run at a
+time so the timings do not disturb each other. For each run the suite records
+
+    events          events executed by Simulator::Run (printed by the scenario)
+    wall_s          wall-clock time of the whole program
+    events_per_s    events per wall-clock second
+    simsec_per_s    simulated seconds per wall-clock second
+    peak_rss_mb     peak resident set size of the program
+
+The results are written to <out>/benchmark.json and compared with the
+baseline (benchmark-baseline.json next to this script by default). A run is
+flagged when its throughput (events_per_s, simsec_per_s) dropped or its cost
+(wall_s, peak_rss_mb) grew by more than --threshold percent. A changed event
+count is reported too, since it means the scenario itself behaves differently
+and its timings are not comparable. The exit status is 1 if anything
+regressed or failed, and 2 if there is no baseline for a run.
+
+Timings only compare on the machine and build they were taken with, so no
+baseline ships with the scenarios: record one with --update-baseline on the
+benchmark machine, from the revision to compare against, before using the
+suite to look for regressions.
+
+Examples:
+    ./run-benchmarks.py --config reduced --update-baseline
+    ./run-benchmarks.py --config reduced
+    ./run-benchmarks.py --exe "build/scratch/ns3.44-{name}-optimized" --update-baseline
+    ./run-benchmarks.py tdma1 TDMA_RR_Static --threshold 5
+
+Programs are either started through "./ns3 run --no-build scratch/<name>" or,
+with --exe, directly from a path pattern. Benchmark an optimized build and
+build it once before starting; runs never trigger a build themselves.
+"""
+
+import argparse
+import json
+import os
+import re
+import shlex
+import subprocess
+import sys
+import time
+
+# name -> configuration -> (arguments, simulated seconds)
+SCENARIOS = {
+    "tdma": {
+        "reduced": (["--simTime=0.5", "--ueNumPergNb=2"], 0.5),
+        "full": ([], 5.0),
+    },
+    "tdma1": {
+        "reduced": (["--simDuration=2"], 2.0),
+        "full": ([], 10.0),
+    },
+    "tdma2": {
+        "reduced": (["--numUes=4", "--simTime=2"], 2.0),
+        "full": ([], 10.0),
+    },
+    "TDMA_RR_Static": {
+        "reduced": (["--numUes=50", "--simDuration=5"], 5.0),
+        "full": ([], 60.0),
+    },
+    "TDMA_RR_Mobility": {
+        "reduced": (["--numUes=40", "--simDuration=5", "--enableAnimation=false"], 5.0),
+        "full": ([], 60.0),
+    },
+    "mobility1": {
+        "reduced": (["--numUes=10", "--simDuration=5", "--enableAnimation=false"], 5.0),
+        "full": ([], 50.0),
+    },
+    "mobilityTDMA": {
+        "reduced": (["--numUes=10", "--simDuration=5", "--enableAnimation=false"], 5.0),
+        "full": ([], 50.0),
+    },
+    "tdmaMobilitynew": {
+        "reduced": (["--numUes=5", "--simDuration=5", "--enableAnimation=false"], 5.0),
+        "full": ([], 20.0),
+    },
+}
+
+EVENTS_RE = re.compile(r"Executed events: (\d+)")
+
+# metric -> True if larger is better
+METRICS = {"events_per_s": True, "simsec_per_s": True, "wall_s": False, "peak_rss_mb": False}
+
+
+def build_command(args, name, extra):
+    if args.exe:
+        return [os.path.abspath(args.exe.format(name=name))] + extra, None
+    program = " ".join(["scratch/" + name] + [shlex.quote(a) for a in extra])
+    return [os.path.abspath(args.ns3), "run", "--no-build", program], os.path.dirname(os.path.abspath(args.ns3))
+
+
+def run_one(args, name, config):
+    extra, sim_time = SCENARIOS[name][config]
+    run_dir = os.path.join(args.out, "%s-%s" % (name, config))
+    os.makedirs(run_dir, exist_ok=True)
+    cmd, cwd = build_command(args, name, extra)
+    if cwd is None:
+        cwd = run_dir
+    else:
+        cmd[2:2] = ["--cwd", os.path.abspath(run_dir)]
+
+    start = time.monotonic()
+    with open(os.path.join(run_dir, "stdout.log"), "w") as out, \
+            open(os.path.join(run_dir, "stderr.log"), "w") as err:
+        proc = subprocess.Popen(cmd, cwd=cwd, stdout=out, stderr=err)
+        # wait4 reports the peak RSS of the child and of the children it
+        # waited for, so the program is covered when ./ns3 starts it
+        _, status, usage = os.wait4(proc.pid, 0)
+        proc.returncode = os.waitstatus_to_exitcode(status)
+    wall = time.monotonic() - start
+
+    result = {"rc": proc.returncode, "wall_s": wall, "peak_rss_mb": usage.ru_maxrss / 1024.0,
+              "sim_s": sim_time}
+    with open(os.path.join(run_dir, "stdout.log")) as f:
+        match = EVENTS_RE.search(f.read())
+    if match:
+        events = int(match.group(1))
+        result["events"] = events
+        result["events_per_s"] = events / wall if wall > 0 else float("nan")
+    result["simsec_per_s"] = sim_time / wall if wall > 0 else float("nan")
+    return result
+
+
+def compare(results, baseline, threshold):
+    regressions = []
+    for key, cur in sorted(results.items()):
+        base = baseline.get(key)
+        if not base or cur.get("rc") != 0:
+            continue
+        if "events" in cur and "events" in base and cur["events"] != base["events"]:
+            print("  %-32s event count changed: %d -> %d (timings not comparable)"
+                  % (key, base["events"], cur["events"]))
+        for metric, higher_is_better in METRICS.items():
+            if metric not in cur or metric not in base or not base[metric]:
+                continue
+            change = 100.0 * (cur[metric] - base[metric]) / base[metric]
+            worse = -change if higher_is_better else change
+            if worse > threshold:
+                regressions.append((key, metric, base[metric], cur[metric], change))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("scenarios", nargs="*", help="scenarios to run (default: all)")
+    parser.add_argument("--config", choices=["reduced", "full", "all"], default="all",
+                        help="configurations to run")
+    parser.add_argument("--exe", help="executable path pattern, {name} is the scenario name")
+    parser.add_argument("--ns3", default="./ns3", help="path to the ns3 driver script")
+    parser.add_argument("--out", default="benchmarks", help="output directory")
+    parser.add_argument("--baseline", default=os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                                           "benchmark-baseline.json"),
+                        help="baseline JSON file")
+    parser.add_argument("--threshold", type=float, default=10.0, help="regression threshold in percent")
+    parser.add_argument("--update-baseline", action="store_true",
+                        help="store the results of this run as the new baseline")
+    args = parser.parse_args()
+
+    names = args.scenarios or list(SCENARIOS)
+    for name in names:
+        if name not in SCENARIOS:
+            parser.error("unknown scenario %s (known: %s)" % (name, ", ".join(SCENARIOS)))
+    configs = ["reduced", "full"] if args.config == "all" else [args.config]
+
+    os.makedirs(args.out, exist_ok=True)
+    results = {}
+    failed = False
+    for name in names:
+        for config in configs:
+            key = "%s/%s" % (name, config)
+            result = run_one(args, name, config)
+            results[key] = result
+            if result["rc"] != 0:
+                failed = True
+                print("%-32s FAILED (exit %d)" % (key, result["rc"]))
+                continue
+            print("%-32s %10s events %9.2f s wall %12s ev/s %8.2f sim-s/s %8.1f MB"
+                  % (key, result.get("events", "?"), result["wall_s"],
+                     "%.0f" % result["events_per_s"] if "events_per_s" in result else "?",
+                     result["simsec_per_s"], result["peak_rss_mb"]))
+
+    with open(os.path.join(args.out, "benchmark.json"), "w") as f:
+        json.dump(results, f, indent=2, sort_keys=True)
+
+    if args.update_baseline:
+        baseline = {}
+        if os.path.exists(args.baseline):
+            with open(args.baseline) as f:
+                baseline = json.load(f)
+        baseline.update({k: v for k, v in results.items() if v["rc"] == 0})
+        with open(args.baseline, "w") as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+        print("baseline updated: %s" % args.baseline)
+        return 1 if failed else 0
+
+    if not os.path.exists(args.baseline):
+        print("no baseline at %s, run with --update-baseline to create it" % args.baseline)
+        return 2
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    missing = sorted(k for k, v in results.items() if v["rc"] == 0 and k not in baseline)
+    for key in missing:
+        print("no baseline for %s in %s" % (key, args.baseline))
+    if missing:
+        return 2
+    regressions = compare(results, baseline, args.threshold)
+    for key, metric, old, new, change in regressions:
+        print("REGRESSION %-32s %-13s %12.4g -> %12.4g (%+.1f%%)" % (key, metric, old, new, change))
+    if not regressions:
+        print("no regressions above %.1f%%" % args.threshold)
+    return 1 if failed or regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+"""Run independent replications of a TDMA scenario and summarise the CSVs.
+
+Every replication runs the same scenario with a different --RngRun value in
+its own output directory, so the CSV files a scenario writes to its working
+directory never collide. Replications are spread over all local cores. Once
+they are done, every CSV name found in the run directories is merged into
+<out>/summary-<name>.csv with the mean and the 95% confidence half-width of
+each numeric column, per row key (the non-numeric columns plus the first
+column, e.g. the FlowId).
+
+Examples:
+    ./run-replications.py scratch/mobilityTDMA --runs 32 -- --numUes=50
+    ./run-replications.py build/scratch/ns3.44-tdma2-default --runs 16 --jobs 8
+
+The scenario is either an executable, run directly, or a program name handed
+to "./ns3 run --no-build". Build the scenario once before starting a sweep;
+parallel runs never trigger a build themselves.
+"""
+
+import argparse
+import concurrent.futures
+import csv
+import math
+import os
+import shlex
+import subprocess
+import sys
+import time
+from collections import OrderedDict
+
+# Two-sided 95% Student t quantiles by degrees of freedom. Between tabulated
+# values the next smaller dof is used, whose quantile is larger, so the
+# interval is never narrower than the exact one.
+T95 = {1: 12.706, 2: 4.303, 3: 3.182, 4: 2.776, 5: 2.571, 6: 2.447, 7: 2.365,
+       8: 2.306, 9: 2.262, 10: 2.228, 11: 2.201, 12: 2.179, 13: 2.160,
+       14: 2.145, 15: 2.131, 16: 2.120, 17: 2.110, 18: 2.101, 19: 2.093,
+       20: 2.086, 25: 2.060, 30: 2.042, 40: 2.021, 60: 2.000, 120: 1.980}
+
+
+def t95(dof):
+    if dof <= 0:
+        return float("nan")
+    return T95[max(d for d in T95 if d <= dof)]
+
+
+def build_command(args, run):
+    extra = list(args.scenario_args)
+    if os.path.isfile(args.scenario) and os.access(args.scenario, os.X_OK):
+        return [os.path.abspath(args.scenario), "--RngRun=%d" % run] + extra
+    program = " ".join([args.scenario, "--RngRun=%d" % run] + [shlex.quote(a) for a in extra])
+    return [os.path.abspath(args.ns3), "run", "--no-build", program]
+
+
+def run_one(args, run):
+    run_dir = os.path.join(args.out, "run-%04d" % run)
+    os.makedirs(run_dir, exist_ok=True)
+    cmd = build_command(args, run)
+    if cmd[1] == "run":
+        # ./ns3 has to be started from the ns-3 tree; --cwd moves the program
+        cmd[2:2] = ["--cwd", os.path.abspath(run_dir)]
+        cwd = os.path.dirname(os.path.abspath(args.ns3))
+    else:
+        cwd = run_dir
+
+    start = time.monotonic()
+    with open(os.path.join(run_dir, "stdout.log"), "w") as out, \
+            open(os.path.join(run_dir, "stderr.log"), "w") as err:
+        rc = subprocess.call(cmd, cwd=cwd, stdout=out, stderr=err)
+    return run, rc, time.monotonic() - start
+
+
+def is_number(value):
+    try:
+        float(value)
+        return True
+    except ValueError:
+        return False
+
+
+def merge(args, runs):
+    names = set()
+    for run in runs:
+        run_dir = os.path.join(args.out, "run-%04d" % run)
+        names.update(f for f in os.listdir(run_dir) if f.endswith(".csv"))
+
+    for name in sorted(names):
+        header = None
+        numeric = None
+        groups = OrderedDict()
+        for run in runs:
+            path = os.path.join(args.out, "run-%04d" % run, name)
+            if not os.path.exists(path):
+                continue
+            with open(path, newline="") as f:
+                reader = csv.reader(f)
+                rows = [r for r in reader if r]
+            if len(rows) < 2:
+                continue
+            if header is None:
+                header = rows[0]
+                numeric = [all(is_number(r[i]) for r in rows[1:] if i < len(r))
+                           for i in range(len(header))]
+                numeric[0] = False
+            for row in rows[1:]:
+                key = tuple(row[i] for i in range(len(header)) if not numeric[i])
+                groups.setdefault(key, []).append(row)
+
+        if header is None:
+            continue
+        key_cols = [h for h, n in zip(header, numeric) if not n]
+        value_cols = [i for i, n in enumerate(numeric) if n]
+        out_path = os.path.join(args.out, "summary-" + name)
+        with open(out_path, "w", newline="") as f:
+            writer = csv.writer(f)
+            writer.writerow(key_cols + ["runs"] +
+                            [c for i in value_cols for c in (header[i] + "_mean", header[i] + "_ci95")])
+            for key, rows in groups.items():
+                line = list(key) + [len(rows)]
+                for i in value_cols:
+                    values = [float(r[i]) for r in rows]
+                    n = len(values)
+                    mean = sum(values) / n
+                    if n > 1:
+                        var = sum((v - mean) ** 2 for v in values) / (n - 1)
+                        half = t95(n - 1) * math.sqrt(var / n)
+                    else:
+                        half = float("nan")
+                    line += ["%.9g" % mean, "%.9g" % half]
+                writer.writerow(line)
+        print("merged %s from %d runs -> %s" % (name, len(runs), out_path))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("scenario", help="scenario executable or ns3 program name (e.g. scratch/tdma2)")
+    parser.add_argument("--runs", type=int, default=10, help="number of replications")
+    parser.add_argument("--first-run", type=int, default=1, help="RngRun value of the first replication")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count() or 1, help="parallel replications")
+    parser.add_argument("--out", default="replications", help="output directory")
+    parser.add_argument("--ns3", default="./ns3", help="path to the ns3 driver script")
+    # Everything after "--" is passed to every run
+    argv = sys.argv[1:]
+    split = argv.index("--") if "--" in argv else len(argv)
+    args = parser.parse_args(argv[:split])
+    args.scenario_args = argv[split + 1:]
+
+    os.makedirs(args.out, exist_ok=True)
+    runs = list(range(args.first_run, args.first_run + args.runs))
+    start = time.monotonic()
+    ok = []
+    with concurrent.futures.ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        futures = [pool.submit(run_one, args, run) for run in runs]
+        for future in concurrent.futures.as_completed(futures):
+            run, rc, elapsed = future.result()
+            status = "ok" if rc == 0 else "FAILED (exit %d)" % rc
+            print("run %d: %s in %.1f s" % (run, status, elapsed))
+            if rc == 0:
+                ok.append(run)
+
+    print("%d/%d runs succeeded in %.1f s wall time" % (len(ok), len(runs), time.monotonic() - start))
+    merge(args, sorted(ok))
+    return 0 if len(ok) == len(runs) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,114 @@
+#ifndef SCHEDULER_REPORT_H
+#define SCHEDULER_REPORT_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/flow-monitor-module.h"
+#include "ns3/nr-module.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+// Radio-side summary of one run for compare-schedulers.py, written as JSON:
+// cell throughput, per-UE throughput and its 5th percentile, the delay CDF
+// of all received packets (from the FlowMonitor delay histograms) and the
+// number of slots of all gNB BWPs from t=0 to the end of the run, so that
+// the profiled gNB CPU time can be expressed per slot. The slot count spans
+// the whole run like the profile does, not just the traffic duration used
+// for the throughputs, and must be written once Simulator::Run returned.
+// A UE's throughput is the sum of its DL and UL flows.
+inline bool WriteSchedulerReport(const std::string& filename, const std::string& scheduler,
+                                 Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier,
+                                 const Ipv4InterfaceContainer& ueIfaces, const NetDeviceContainer& gnbDevs,
+                                 Time duration) {
+    std::ofstream out(filename.c_str());
+    if (!out.is_open()) {
+        return false;
+    }
+
+    std::map<Ipv4Address, uint32_t> ueOf;
+    for (uint32_t u = 0; u < ueIfaces.GetN(); ++u) {
+        ueOf[ueIfaces.GetAddress(u)] = u;
+    }
+
+    std::vector<double> ueBytes(ueIfaces.GetN(), 0.0);
+    double cellBytes = 0.0;
+    std::map<double, uint64_t> delayBins;    // bin start (s) -> packets
+    double binWidth = 0.0;                   // DelayBinWidth, the same for every flow
+    uint64_t rxPackets = 0;
+    for (const auto& entry : monitor->GetFlowStats()) {
+        const FlowMonitor::FlowStats& stats = entry.second;
+        Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(entry.first);
+        auto ue = ueOf.find(t.destinationAddress);
+        if (ue == ueOf.end()) {
+            ue = ueOf.find(t.sourceAddress);
+        }
+        if (ue != ueOf.end()) {
+            ueBytes[ue->second] += stats.rxBytes;
+        }
+        cellBytes += stats.rxBytes;
+        rxPackets += stats.rxPackets;
+        const Histogram& h = stats.delayHistogram;
+        for (uint32_t b = 0; b < h.GetNBins(); ++b) {
+            if (h.GetBinCount(b) > 0) {
+                delayBins[h.GetBinStart(b)] += h.GetBinCount(b);
+                binWidth = h.GetBinWidth(b);
+            }
+        }
+    }
+
+    double seconds = duration.GetSeconds();
+    std::vector<double> ueMbps;
+    for (double bytes : ueBytes) {
+        ueMbps.push_back(bytes * 8.0 / seconds / 1e6);
+    }
+    std::sort(ueMbps.begin(), ueMbps.end());
+    double p5 = ueMbps.empty() ? 0.0 : ueMbps[static_cast<std::size_t>(0.05 * (ueMbps.size() - 1))];
+
+    // The gNB PHYs run one slot after another from t=0, the span the profile covers
+    Time runTime = Simulator::Now();
+    uint64_t ttis = 0;
+    for (uint32_t i = 0; i < gnbDevs.GetN(); ++i) {
+        Ptr<NrGnbNetDevice> gnb = DynamicCast<NrGnbNetDevice>(gnbDevs.Get(i));
+        for (uint32_t bwp = 0; bwp < gnb->GetCcMapSize(); ++bwp) {
+            ttis += runTime.GetNanoSeconds() / gnb->GetPhy(bwp)->GetSlotPeriod().GetNanoSeconds();
+        }
+    }
+
+    out << "{\n";
+    out << "  \"scheduler\": \"" << scheduler << "\",\n";
+    out << "  \"duration_s\": " << seconds << ",\n";
+    out << "  \"run_time_s\": " << runTime.GetSeconds() << ",\n";
+    out << "  \"ttis\": " << ttis << ",\n";
+    out << "  \"cell_throughput_mbps\": " << cellBytes * 8.0 / seconds / 1e6 << ",\n";
+    out << "  \"ue_throughput_p5_mbps\": " << p5 << ",\n";
+    out << "  \"ue_throughput_mbps\": [";
+    for (std::size_t u = 0; u < ueMbps.size(); ++u) {
+        out << (u ? ", " : "") << ueMbps[u];
+    }
+    out << "],\n";
+    out << "  \"rx_packets\": " << rxPackets << ",\n";
+    // [upper edge of the bin (s), fraction of packets with a smaller delay]
+    out << "  \"delay_cdf\": [";
+    uint64_t cumulative = 0;
+    bool first = true;
+    for (const auto& bin : delayBins) {
+        cumulative += bin.second;
+        out << (first ? "" : ", ") << "[" << bin.first + binWidth << ", "
+            << static_cast<double>(cumulative) / rxPackets << "]";
+        first = false;
+    }
+    out << "]\n";
+    out << "}\n";
+    return true;
+}
+
+} // namespace ns3
+
+#endif // SCHEDULER_REPORT_H
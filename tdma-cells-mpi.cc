@@ -0,0 +1,317 @@
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/flow-monitor-module.h"
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#endif
+
+#include "duty-cycled-udp-client.h"
+#include "flow-attribution-index.h"
+
+#include <chrono>
+#include <fstream>
+#include <map>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("TdmaCellsMpi");
+
+// Multi-cell version of the two-BS TDMA scenario (TDMA_RR_Static) for ns-3's
+// distributed simulator. Every cell (one BS and its UEs on their own Wi-Fi
+// channel) is a logical process placed on rank cell % size. Cells only
+// interact through point-to-point backhaul links between neighbouring BSs;
+// their propagation delay is the lookahead that lets ranks advance
+// independently. Run with e.g.
+//   mpirun -np 4 ./ns3 run "tdma-cells-mpi --numCells=16 --uesPerCell=125"
+//
+// A rank only installs the Wi-Fi devices, mobility, internet stacks and
+// applications of its own cells, so beacons, association and traffic of a
+// cell run on one rank only and the per-rank event load drops with the rank
+// count. Every rank still creates all nodes (the node ids have to agree) and
+// the stacks of all BSs, which terminate the backhaul links. Random streams
+// are fixed per cell, so a cell behaves the same whatever rank it lands on.
+//
+// Timing: every rank logs its executed events and simulated seconds per wall
+// second. The speed-up for a given -np is the wall time of the slowest rank
+// against the wall time of the -np 1 run (or the build without MPI) for the
+// same --numCells; with one cell per rank it is bounded by the busiest cell
+// and by how often the backhaul lookahead forces the ranks to synchronise.
+
+const double kSlotDuration = 0.1;     // seconds
+const uint32_t kPacketSize = 1024;
+const int64_t kStreamsPerCell = 10000;  // random streams reserved for every cell
+
+int main(int argc, char *argv[]) {
+    uint32_t numCells = 2;
+    uint32_t uesPerCell = 125;
+    double simDuration = 60.0;
+    double cellSpacing = 500.0;            // m between neighbouring BSs
+    std::string backhaulDelay = "2ms";     // lookahead between cells
+    std::string backhaulRate = "1Gbps";
+    double interCellInterval = 0.0;        // s between BS -> next BS packets, 0 to disable
+    bool nullMessage = false;
+
+    CommandLine cmd;
+    cmd.AddValue("numCells", "Number of cells (BS + UE group)", numCells);
+    cmd.AddValue("uesPerCell", "Number of UEs per cell", uesPerCell);
+    cmd.AddValue("simDuration", "Total simulation duration (seconds)", simDuration);
+    cmd.AddValue("cellSpacing", "Distance between neighbouring BSs (m)", cellSpacing);
+    cmd.AddValue("backhaulDelay", "Delay of the inter-BS links, i.e. the lookahead", backhaulDelay);
+    cmd.AddValue("backhaulRate", "Data rate of the inter-BS links", backhaulRate);
+    cmd.AddValue("interCellInterval", "Interval of the inter-cell BS -> BS flow (s), 0 to disable", interCellInterval);
+    cmd.AddValue("nullMessage", "Use the null-message instead of the granted-time-window synchronisation", nullMessage);
+    cmd.Parse(argc, argv);
+
+    uint32_t systemId = 0;
+    uint32_t systemCount = 1;
+#ifdef NS3_MPI
+    GlobalValue::Bind("SimulatorImplementationType",
+                      StringValue(nullMessage ? "ns3::NullMessageSimulatorImpl"
+                                              : "ns3::DistributedSimulatorImpl"));
+    MpiInterface::Enable(&argc, &argv);
+    systemId = MpiInterface::GetSystemId();
+    systemCount = MpiInterface::GetSize();
+#else
+    NS_LOG_UNCOND("ns-3 was built without MPI, running all cells in one process");
+#endif
+    LogComponentEnable("TdmaCellsMpi", LOG_LEVEL_INFO);
+
+    // Every rank builds the whole topology; a node only lives on its rank
+    std::vector<NodeContainer> bsNodes(numCells), ueNodes(numCells);
+    for (uint32_t c = 0; c < numCells; ++c) {
+        uint32_t rank = c % systemCount;
+        bsNodes[c].Create(1, rank);
+        ueNodes[c].Create(uesPerCell, rank);
+    }
+    auto isLocal = [&](Ptr<Node> node) { return node->GetSystemId() == systemId; };
+
+    auto isLocalCell = [&](uint32_t c) { return isLocal(bsNodes[c].Get(0)); };
+
+    // Radio part of each local cell: independent Wi-Fi channel, so no object
+    // is shared between two ranks
+    WifiHelper wifi;
+    wifi.SetStandard(WIFI_STANDARD_80211g);
+    WifiMacHelper mac;
+    std::vector<NetDeviceContainer> bsDevs(numCells), ueDevs(numCells);
+    for (uint32_t c = 0; c < numCells; ++c) {
+        if (!isLocalCell(c)) {
+            continue;
+        }
+        YansWifiChannelHelper channel = YansWifiChannelHelper::Default();
+        YansWifiPhyHelper phy;
+        phy.SetChannel(channel.Create());
+
+        Ssid ssid = Ssid("tdma-cell-" + std::to_string(c));
+        mac.SetType("ns3::ApWifiMac", "Ssid", SsidValue(ssid));
+        bsDevs[c] = wifi.Install(phy, mac, bsNodes[c]);
+        mac.SetType("ns3::StaWifiMac",
+                    "Ssid", SsidValue(ssid),
+                    "ActiveProbing", BooleanValue(false));
+        ueDevs[c] = wifi.Install(phy, mac, ueNodes[c]);
+
+        int64_t stream = c * kStreamsPerCell;
+        stream += wifi.AssignStreams(bsDevs[c], stream);
+        wifi.AssignStreams(ueDevs[c], stream);
+    }
+
+    // Cells on a line, UEs around their BS
+    MobilityHelper mobility;
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    for (uint32_t c = 0; c < numCells; ++c) {
+        if (!isLocalCell(c)) {
+            continue;
+        }
+        double x = c * cellSpacing;
+        Ptr<ListPositionAllocator> bsPos = CreateObject<ListPositionAllocator>();
+        bsPos->Add(Vector(x, 0.0, 0.0));
+        mobility.SetPositionAllocator(bsPos);
+        mobility.Install(bsNodes[c]);
+
+        Ptr<RandomDiscPositionAllocator> uePos = CreateObject<RandomDiscPositionAllocator>();
+        uePos->SetX(x);
+        uePos->SetY(0.0);
+        uePos->SetRho(CreateObjectWithAttributes<UniformRandomVariable>("Min", DoubleValue(1.0),
+                                                                        "Max", DoubleValue(50.0)));
+        uePos->AssignStreams(c * kStreamsPerCell + kStreamsPerCell / 2);
+        mobility.SetPositionAllocator(uePos);
+        mobility.Install(ueNodes[c]);
+    }
+
+    // All BSs get a stack for the backhaul, UEs only on their own rank
+    InternetStackHelper internet;
+    for (uint32_t c = 0; c < numCells; ++c) {
+        internet.Install(bsNodes[c]);
+        if (isLocalCell(c)) {
+            internet.Install(ueNodes[c]);
+        }
+    }
+
+    Ipv4AddressHelper ipv4;
+    std::vector<Ipv4InterfaceContainer> bsIfs(numCells), ueIfs(numCells);
+    for (uint32_t c = 0; c < numCells; ++c) {
+        std::string base = "10." + std::to_string(1 + c / 256) + "." + std::to_string(c % 256) + ".0";
+        if (!isLocalCell(c)) {
+            continue;
+        }
+        ipv4.SetBase(base.c_str(), "255.255.255.0");
+        bsIfs[c] = ipv4.Assign(bsDevs[c]);
+        ueIfs[c] = ipv4.Assign(ueDevs[c]);
+    }
+
+    // Backhaul between neighbouring BSs: the only links that may cross ranks
+    PointToPointHelper backhaul;
+    backhaul.SetDeviceAttribute("DataRate", StringValue(backhaulRate));
+    backhaul.SetChannelAttribute("Delay", StringValue(backhaulDelay));
+    ipv4.SetBase("172.16.0.0", "255.255.255.252");
+    std::vector<Ipv4InterfaceContainer> backhaulIfs(numCells);
+    for (uint32_t c = 0; c + 1 < numCells; ++c) {
+        NetDeviceContainer link = backhaul.Install(bsNodes[c].Get(0), bsNodes[c + 1].Get(0));
+        backhaulIfs[c] = ipv4.Assign(link);
+        ipv4.NewNetwork();
+    }
+    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+
+    uint16_t uplinkPort = 5000;
+    uint16_t downlinkPort = 5001;
+    uint16_t backhaulPort = 6000;
+
+    // Same per-cell TDMA round-robin as TDMA_RR_Static, on local nodes only
+    const Time cycle = Seconds(2 * kSlotDuration * uesPerCell);
+    ApplicationContainer apps;
+    for (uint32_t c = 0; c < numCells; ++c) {
+        Ptr<Node> bs = bsNodes[c].Get(0);
+        if (!isLocal(bs)) {
+            continue;
+        }
+
+        UdpServerHelper bsServer(uplinkPort);
+        apps.Add(bsServer.Install(bs));
+        UdpServerHelper ueServer(downlinkPort);
+        apps.Add(ueServer.Install(ueNodes[c]));
+
+        for (uint32_t i = 0; i < uesPerCell; ++i) {
+            Time uplinkOffset = Seconds(i * 2 * kSlotDuration);
+
+            DutyCycledUdpClientHelper uplink(bsIfs[c].GetAddress(0), uplinkPort);
+            uplink.SetAttribute("PacketSize", UintegerValue(kPacketSize));
+            uplink.SetAttribute("Interval", TimeValue(Seconds(0.01)));
+            uplink.SetPeriodicWindows(uplinkOffset, Seconds(kSlotDuration), cycle);
+            apps.Add(uplink.Install(ueNodes[c].Get(i)));
+
+            DutyCycledUdpClientHelper downlink(ueIfs[c].GetAddress(i), downlinkPort);
+            downlink.SetAttribute("PacketSize", UintegerValue(kPacketSize));
+            downlink.SetAttribute("Interval", TimeValue(Seconds(0.01)));
+            downlink.SetPeriodicWindows(uplinkOffset + Seconds(kSlotDuration), Seconds(kSlotDuration), cycle);
+            apps.Add(downlink.Install(bs));
+        }
+
+        // Optional inter-cell traffic over the backhaul, to the backhaul
+        // address of the next BS, whose cell may live on another rank
+        if (interCellInterval > 0.0 && c + 1 < numCells) {
+            UdpClientHelper x2(backhaulIfs[c].GetAddress(1), backhaulPort);
+            x2.SetAttribute("PacketSize", UintegerValue(kPacketSize));
+            x2.SetAttribute("Interval", TimeValue(Seconds(interCellInterval)));
+            x2.SetAttribute("MaxPackets", UintegerValue(0));
+            apps.Add(x2.Install(bs));
+        }
+        if (interCellInterval > 0.0 && c > 0) {
+            UdpServerHelper x2Server(backhaulPort);
+            apps.Add(x2Server.Install(bs));
+        }
+    }
+    apps.Start(Seconds(0.0));
+    apps.Stop(Seconds(simDuration));
+
+    // Flow monitor on the nodes of this rank only
+    FlowMonitorHelper flowmon;
+    NodeContainer localNodes;
+    for (uint32_t c = 0; c < numCells; ++c) {
+        if (isLocalCell(c)) {
+            localNodes.Add(bsNodes[c]);
+            localNodes.Add(ueNodes[c]);
+        }
+    }
+    Ptr<FlowMonitor> monitor = flowmon.Install(localNodes);
+
+    NS_LOG_INFO("Rank " << systemId << "/" << systemCount << ": " << localNodes.GetN() << " local nodes");
+
+    auto wallStart = std::chrono::steady_clock::now();
+    Simulator::Stop(Seconds(simDuration));
+    Simulator::Run();
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    NS_LOG_INFO("Rank " << systemId << ": " << Simulator::GetEventCount() << " events in " << wall
+                        << " s wall, " << simDuration / wall << " simulated s per wall s");
+
+    // Rank of every address. A flow to a node of another rank has its
+    // packets received there, where this rank's monitor does not see them,
+    // so such flows would show up here as 100% lost; they are left out.
+    std::map<Ipv4Address, uint32_t> rankOf;
+    for (uint32_t c = 0; c < numCells; ++c) {
+        for (NodeContainer* nodes : {&bsNodes[c], &ueNodes[c]}) {
+            for (uint32_t n = 0; n < nodes->GetN(); ++n) {
+                Ptr<Ipv4> ip = nodes->Get(n)->GetObject<Ipv4>();
+                if (!ip) {
+                    continue;   // UE of a remote cell
+                }
+                for (uint32_t i = 0; i < ip->GetNInterfaces(); ++i) {
+                    for (uint32_t j = 0; j < ip->GetNAddresses(i); ++j) {
+                        rankOf[ip->GetAddress(i, j).GetLocal()] = nodes->Get(n)->GetSystemId();
+                    }
+                }
+            }
+        }
+    }
+
+    // One result file per rank
+    Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
+    FlowAttributionIndex attribution(classifier);
+    for (uint32_t c = 0; c < numCells; ++c) {
+        attribution.AddUes(ueIfs[c], c * uesPerCell, c);
+        attribution.AddBss(bsIfs[c], c);
+    }
+    attribution.SetPortDirection(uplinkPort, FLOW_UPLINK);
+    attribution.SetPortDirection(downlinkPort, FLOW_DOWNLINK);
+
+    std::ofstream outFile("tdma_cells_results_rank" + std::to_string(systemId) + ".csv");
+    outFile << "FlowId,Cell,UeId,Src,Dest,Delay(s),Jitter(s),Throughput(bps),LossRate(%)\n";
+    uint32_t remoteFlows = 0;
+    uint64_t remotePackets = 0;
+    for (const auto& flow : monitor->GetFlowStats()) {
+        const FlowAttribution& a = attribution.Classify(flow.first);
+        const FlowMonitor::FlowStats& st = flow.second;
+        auto dst = rankOf.find(a.tuple.destinationAddress);
+        if (dst != rankOf.end() && dst->second != systemId) {
+            remoteFlows++;
+            remotePackets += st.txPackets;
+            continue;
+        }
+
+        double delay = st.rxPackets > 0 ? st.delaySum.GetSeconds() / st.rxPackets : 0;
+        double jitter = st.rxPackets > 0 ? st.jitterSum.GetSeconds() / st.rxPackets : 0;
+        double duration = st.rxPackets > 0 ? (st.timeLastRxPacket - st.timeFirstRxPacket).GetSeconds() : 0;
+        double throughput = duration > 0 ? st.rxBytes * 8.0 / duration : 0;
+        double lossRate = st.txPackets > 0 ? 100.0 * (st.txPackets - st.rxPackets) / st.txPackets : 0;
+
+        outFile << flow.first << ","
+                << (a.bs != FlowAttribution::NONE ? std::to_string(a.bs) : "-") << ","
+                << (a.ue != FlowAttribution::NONE ? std::to_string(a.ue) : "-") << ","
+                << a.tuple.sourceAddress << "," << a.tuple.destinationAddress << ","
+                << delay << "," << jitter << "," << throughput << "," << lossRate << "\n";
+    }
+    outFile.close();
+    if (remoteFlows > 0) {
+        NS_LOG_INFO("Rank " << systemId << ": " << remoteFlows << " flows (" << remotePackets
+                            << " packets) to other ranks left out of the results");
+    }
+
+    Simulator::Destroy();
+#ifdef NS3_MPI
+    MpiInterface::Disable();
+#endif
+    return 0;
+}
@@ -0,0 +1,136 @@
+#ifndef TDMA_CLIENT_APP_H
+#define TDMA_CLIENT_APP_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include "packet-pool.h"
+#include "tdma-slot-scheduler.h"
+
+#include <algorithm>
+
+namespace ns3 {
+
+// UDP source of the TDMA scenarios. A single instance lives for the whole run
+// on one socket; whoever owns the frame (usually a TdmaSlotScheduler slot
+// listener) calls StartSlot() when its slot starts and says how long it may
+// transmit. A saturated source spreads a full burst over the window, a source
+// with an offered load sends its backlog one packet per packetTime.
+class TdmaClientApp : public Application {
+public:
+    TdmaClientApp()
+        : m_socket(0),
+          m_packetSize(0),
+          m_nPackets(0),
+          m_count(0),
+          m_burst(0),
+          m_running(false) {}
+
+    ~TdmaClientApp() override { m_socket = 0; }
+
+    void Setup(Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets) {
+        m_socket = socket;
+        m_peer = address;
+        m_packetSize = packetSize;
+        m_nPackets = nPackets;
+        m_pool.SetPacketSize(packetSize);
+    }
+
+    // Recycle payload packets instead of creating one per transmission
+    void SetPacketPool(bool enabled) { m_pool.SetEnabled(enabled); }
+
+    // Stream of the offered-load arrivals, assign before SetOfferedLoad()
+    int64_t AssignStreams(int64_t stream) { return m_load.AssignStreams(stream); }
+
+    // Poisson arrivals instead of a saturated source, sent one per packetTime
+    void SetOfferedLoad(double packetsPerSecond, Time packetTime) {
+        m_load.SetRate(packetsPerSecond, 10 * m_nPackets);
+        m_packetTime = packetTime;
+    }
+
+    // Starts a slot with txWindow of transmit time
+    void StartSlot(Time txWindow) {
+        if (!m_running) {
+            return;
+        }
+        Simulator::Cancel(m_sendEvent);
+        m_count = 0;
+        m_slotEnd = Simulator::Now() + txWindow;
+        if (m_load.IsSaturated()) {
+            m_burst = m_nPackets;
+            m_interval = txWindow / m_nPackets;
+        } else {
+            m_burst = std::min(m_load.GetBacklog(), m_nPackets);
+            m_interval = m_packetTime;
+            if (m_burst == 0) {
+                return;
+            }
+        }
+        SendPacket();
+    }
+
+    // Packets the app wants to send in its next slot
+    uint32_t GetBacklog(void) {
+        if (!m_running) {
+            return 0;
+        }
+        // A saturated source fills every slot with a full burst
+        return m_load.IsSaturated() ? m_nPackets : m_load.GetBacklog();
+    }
+
+private:
+    void StartApplication(void) override {
+        if (!m_socket) {
+            return;
+        }
+        // Bound and connected once for the lifetime of the app
+        m_socket->Bind();
+        m_socket->Connect(m_peer);
+        m_running = true;
+    }
+
+    void StopApplication(void) override {
+        m_running = false;
+        if (m_sendEvent.IsPending()) {
+            Simulator::Cancel(m_sendEvent);
+        }
+        if (m_socket) {
+            m_socket->Close();
+        }
+    }
+
+    void SendPacket(void) {
+        if (Simulator::Now() >= m_slotEnd) {
+            return;
+        }
+        Ptr<Packet> packet = m_pool.Get();
+        m_socket->Send(packet);
+        m_count++;
+        m_load.Remove(1);
+        if (m_count < m_burst && Simulator::Now() + m_interval < m_slotEnd) {
+            ScheduleNextTx();
+        }
+    }
+
+    void ScheduleNextTx(void) {
+        m_sendEvent = Simulator::Schedule(m_interval, &TdmaClientApp::SendPacket, this);
+    }
+
+    Ptr<Socket> m_socket;
+    Address m_peer;
+    uint32_t m_packetSize;
+    uint32_t m_nPackets;
+    uint32_t m_count;
+    uint32_t m_burst;    // packets to send in the current slot
+    bool m_running;
+    EventId m_sendEvent;
+    Time m_interval;
+    Time m_slotEnd;      // end of the transmit window of the current slot
+    Time m_packetTime;
+    TdmaOfferedLoad m_load;
+    PacketPool m_pool;
+};
+
+} // namespace ns3
+
+#endif // TDMA_CLIENT_APP_H
@@ -0,0 +1,513 @@
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/flow-monitor-module.h"
+#include "ns3/mobility-module.h"
+
+#include "batched-waypoint-mobility.h"
+#include "event-log.h"
+#include "flow-interval-collector.h"
+#include "flow-metrics-sampler.h"
+#include "ladder-scheduler.h"
+#include "packet-pool.h"
+#include "tdma-client-app.h"
+#include "tdma-slot-scheduler.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("TdmaComponentsTest");
+
+// Behaviour checks of the building blocks the scenarios share. Every failed
+// check is printed and the program exits with status 1.
+//
+// ./ns3 run tdma-components-test
+
+static uint32_t g_failures = 0;
+
+static void Check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cout << "  FAIL: " << what << "\n";
+        g_failures++;
+    }
+}
+
+static std::vector<Time> g_arrivals;
+
+static void RecordArrival(Ptr<const Packet> packet, const Address& from) {
+    g_arrivals.push_back(Simulator::Now());
+}
+
+// A saturated TdmaClientApp sends its full burst inside every slot window on
+// the one socket it keeps for the run, and nothing outside its slots
+static void TestClientAppSlots(void) {
+    g_arrivals.clear();
+    NodeContainer nodes;
+    nodes.Create(2);
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue("10Mbps"));
+    p2p.SetChannelAttribute("Delay", StringValue("2ms"));
+    NetDeviceContainer devices = p2p.Install(nodes);
+    InternetStackHelper internet;
+    internet.Install(nodes);
+    Ipv4AddressHelper address;
+    address.SetBase("10.1.0.0", "255.255.255.0");
+    Ipv4InterfaceContainer interfaces = address.Assign(devices);
+
+    PacketSinkHelper sink("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), 9));
+    ApplicationContainer sinkApps = sink.Install(nodes.Get(1));
+    sinkApps.Get(0)->TraceConnectWithoutContext("Rx", MakeCallback(&RecordArrival));
+
+    Ptr<Socket> socket = Socket::CreateSocket(nodes.Get(0), UdpSocketFactory::GetTypeId());
+    Ptr<TdmaClientApp> app = CreateObject<TdmaClientApp>();
+    app->Setup(socket, InetSocketAddress(interfaces.GetAddress(1), 9), 200, 5);
+    app->SetStartTime(Seconds(1.0));
+    app->SetStopTime(Seconds(3.0));
+    nodes.Get(0)->AddApplication(app);
+
+    // The slot before the start and the one after the stop send nothing
+    for (double slot : {0.5, 1.5, 2.0, 3.5}) {
+        Simulator::Schedule(Seconds(slot), &TdmaClientApp::StartSlot, app, MilliSeconds(90));
+    }
+    Simulator::Schedule(Seconds(1.5), [app]() {
+        Check(app->GetBacklog() == 5, "backlog of a saturated source");
+    });
+    Simulator::Stop(Seconds(4.0));
+    Simulator::Run();
+
+    Check(g_arrivals.size() == 10, "packets of two slots");
+    bool ok = true;
+    for (uint32_t i = 0; i < g_arrivals.size(); ++i) {
+        Time slot = Seconds(i < 5 ? 1.5 : 2.0);
+        // 18 ms apart, each delivered after 2 ms delay and 0.2 ms on the wire
+        ok = ok && g_arrivals[i] > slot + MilliSeconds(18 * (i % 5)) &&
+             g_arrivals[i] < slot + MilliSeconds(18 * (i % 5) + 3);
+    }
+    Check(ok, "packets outside their slot window or spacing");
+    Check(app->GetBacklog() == 0, "backlog of a stopped source");
+    Simulator::Destroy();
+}
+
+struct SlotRecord {
+    Time at;
+    uint32_t ue;
+    TdmaDirection direction;
+    Time window;
+};
+
+static std::vector<SlotRecord> g_slots;
+
+static void RecordSlot(uint32_t ue, TdmaDirection direction, Time window) {
+    g_slots.push_back({Simulator::Now(), ue, direction, window});
+}
+
+// Round robin layout of a shared frame and of one frame per BS group
+static void TestSlotAssignment(void) {
+    for (bool parallel : {false, true}) {
+        g_slots.clear();
+        Ptr<TdmaSlotScheduler> scheduler = CreateObject<TdmaSlotScheduler>();
+        scheduler->SetAttribute("SlotDuration", TimeValue(MilliSeconds(100)));
+        scheduler->SetAttribute("GuardTime", TimeValue(MilliSeconds(10)));
+        scheduler->SetAttribute("ParallelGroups", BooleanValue(parallel));
+        scheduler->SetPolicy(CreateObject<TdmaRoundRobinPolicy>());
+        for (uint32_t ue = 0; ue < 4; ++ue) {
+            scheduler->AddUe(ue < 2 ? 0 : 1);
+            for (TdmaDirection dir : {TDMA_UPLINK, TDMA_DOWNLINK}) {
+                scheduler->AddSlotListener(ue, dir, MakeBoundCallback(&RecordSlot, ue, dir));
+            }
+        }
+        scheduler->Start(Seconds(0));
+        // One frame: 8 slots shared, or 4 per group
+        Simulator::Stop(MilliSeconds(parallel ? 350 : 750));
+        Simulator::Run();
+
+        std::string mode = parallel ? "parallel groups: " : "shared frame: ";
+        Check(scheduler->GetNTimelines() == (parallel ? 2u : 1u), mode + "number of timelines");
+        Check(scheduler->GetFrameSize(0) == (parallel ? 4u : 8u), mode + "frame size");
+        Check(g_slots.size() == 8, mode + "number of announced slots");
+        bool ok = true;
+        for (uint32_t i = 0; i < g_slots.size(); ++i) {
+            const SlotRecord& s = g_slots[i];
+            // Shared: UE i/2 in slot i. Parallel: UE k/2 of each group in slot k.
+            uint32_t k = parallel ? i / 2 : i;
+            uint32_t ue = parallel ? k / 2 + (s.ue >= 2 ? 2 : 0) : k / 2;
+            ok = ok && s.at == MilliSeconds(100 * k) && s.ue == ue && s.direction == k % 2 &&
+                 s.window == MilliSeconds(90);
+        }
+        if (parallel) {
+            // Both groups are served in every slot
+            for (uint32_t i = 0; i + 1 < g_slots.size(); i += 2) {
+                ok = ok && (g_slots[i].ue < 2) != (g_slots[i + 1].ue < 2);
+            }
+        }
+        Check(ok, mode + "owner, direction, start or window of a slot");
+        Simulator::Destroy();
+    }
+
+    // Disposing the scheduler before its start cancels the pending start
+    g_slots.clear();
+    Ptr<TdmaSlotScheduler> scheduler = CreateObject<TdmaSlotScheduler>();
+    scheduler->SetPolicy(CreateObject<TdmaRoundRobinPolicy>());
+    scheduler->AddUe(0);
+    scheduler->AddSlotListener(0, TDMA_UPLINK, MakeBoundCallback(&RecordSlot, 0u, TDMA_UPLINK));
+    scheduler->Start(Seconds(1.0));
+    Simulator::Schedule(Seconds(0.5), &TdmaSlotScheduler::Dispose, scheduler);
+    Simulator::Stop(Seconds(2.0));
+    Simulator::Run();
+    Check(g_slots.empty(), "slots of a scheduler disposed before its start");
+    Simulator::Destroy();
+}
+
+static uint32_t g_phyDrops = 0;
+
+static void CountDrop(Ptr<const Packet> packet) {
+    g_phyDrops++;
+}
+
+// Two nodes on a point-to-point link in network, 100 UDP packets from node 0
+// to node 1 between 1 s and 2 s. With dropRate, node 1's device drops that
+// share of the packets, which FlowMonitor only declares lost in
+// CheckForLostPackets. Addresses stay allocated across Simulator::Destroy,
+// so every test uses its own network.
+static Ptr<FlowMonitor> BuildFlow(FlowMonitorHelper& flowMonHelper, const char* network, double dropRate) {
+    NodeContainer nodes;
+    nodes.Create(2);
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue("10Mbps"));
+    p2p.SetChannelAttribute("Delay", StringValue("2ms"));
+    NetDeviceContainer devices = p2p.Install(nodes);
+    if (dropRate > 0.0) {
+        Ptr<RateErrorModel> errors = CreateObject<RateErrorModel>();
+        errors->SetAttribute("ErrorRate", DoubleValue(dropRate));
+        errors->SetAttribute("ErrorUnit", StringValue("ERROR_UNIT_PACKET"));
+        errors->AssignStreams(1);
+        devices.Get(1)->SetAttribute("ReceiveErrorModel", PointerValue(errors));
+        devices.Get(1)->TraceConnectWithoutContext("PhyRxDrop", MakeCallback(&CountDrop));
+    }
+    InternetStackHelper internet;
+    internet.Install(nodes);
+    Ipv4AddressHelper address;
+    address.SetBase(network, "255.255.255.0");
+    Ipv4InterfaceContainer interfaces = address.Assign(devices);
+
+    UdpServerHelper server(9);
+    ApplicationContainer serverApps = server.Install(nodes.Get(1));
+    serverApps.Start(Seconds(0.5));
+    UdpClientHelper client(interfaces.GetAddress(1), 9);
+    client.SetAttribute("MaxPackets", UintegerValue(100));
+    client.SetAttribute("Interval", TimeValue(MilliSeconds(10)));
+    client.SetAttribute("PacketSize", UintegerValue(200));
+    ApplicationContainer clientApps = client.Install(nodes.Get(0));
+    clientApps.Start(Seconds(1.0));
+    clientApps.Stop(Seconds(2.5));
+
+    return flowMonHelper.InstallAll();
+}
+
+// Deltas of a flow with dropped packets, whose loss the monitor only
+// declares after the traffic ended
+static void TestCollectorLateLosses(void) {
+    g_phyDrops = 0;
+    FlowMonitorHelper flowMonHelper;
+    Ptr<FlowMonitor> monitor = BuildFlow(flowMonHelper, "10.1.2.0", 0.2);
+    FlowIntervalCollector collector(monitor, DynamicCast<Ipv4FlowClassifier>(flowMonHelper.GetClassifier()));
+    Simulator::Stop(Seconds(4.0));
+    Simulator::Run();
+
+    const std::vector<FlowIntervalCollector::Delta>& first = collector.Collect();
+    Check(g_phyDrops > 0, "the error model dropped no packet");
+    Check(first.size() == 1, "one changed flow after the traffic");
+    if (first.size() == 1) {
+        Check(first[0].txPackets == 100 && first[0].rxPackets == 100 - g_phyDrops,
+              "tx and rx deltas of the first collection");
+        Check(first[0].lostPackets == 0, "losses reported before the monitor declared them");
+        Check(first[0].source == Ipv4Address("10.1.2.1") && first[0].destination == Ipv4Address("10.1.2.2"),
+              "addresses of the flow");
+    }
+    Check(collector.Collect().empty(), "unchanged flow reported again");
+
+    monitor->CheckForLostPackets(Seconds(0));
+    const std::vector<FlowIntervalCollector::Delta>& late = collector.Collect();
+    Check(late.size() == 1, "late losses not reported");
+    if (late.size() == 1) {
+        Check(late[0].lostPackets == g_phyDrops, "late loss delta");
+        Check(late[0].txPackets == 0 && late[0].rxPackets == 0 && late[0].rxBytes == 0,
+              "tx and rx deltas with the late losses");
+    }
+    Check(collector.Collect().empty(), "settled flow reported again");
+    Simulator::Destroy();
+}
+
+// Binary samples add up to the monitor's totals of the flow
+static void TestFlowMetricsRoundTrip(void) {
+    const std::string filename = "tdma-components-test-metrics.bin";
+    FlowMonitorHelper flowMonHelper;
+    Ptr<FlowMonitor> monitor = BuildFlow(flowMonHelper, "10.1.1.0", 0.0);
+    Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowMonHelper.GetClassifier());
+    FlowMetricsSampler sampler(monitor, classifier);
+    Check(sampler.Open(filename, FlowMetricsSampler::BINARY), "cannot open " + filename);
+    sampler.Start(Seconds(0.5), Seconds(4.0));
+    Simulator::Stop(Seconds(4.0));
+    Simulator::Run();
+    sampler.Close();
+
+    std::map<FlowId, FlowMonitor::FlowStats> stats = monitor->GetFlowStats();
+    Check(stats.size() == 1 && stats.begin()->first == 1, "one flow with id 1");
+    const FlowMonitor::FlowStats& st = stats.begin()->second;
+    Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(1);
+    Simulator::Destroy();
+
+    std::ifstream in(filename, std::ios::in | std::ios::binary);
+    FlowMetricsFileHeader header;
+    Check(in.read(reinterpret_cast<char*>(&header), sizeof(header)) && IsFlowMetricsHeader(header),
+          "flow metrics header");
+    Check(header.intervalSeconds == 0.5, "sampling interval in the header");
+    uint64_t rxBytes = 0;
+    uint32_t txPackets = 0;
+    uint32_t rxPackets = 0;
+    uint32_t lastSample = 0;
+    bool fieldsOk = true;
+    FlowMetricsRecord r;
+    while (in.read(reinterpret_cast<char*>(&r), sizeof(r))) {
+        fieldsOk = fieldsOk && r.flowId == 1 && r.source == t.sourceAddress.Get() &&
+                   r.destination == t.destinationAddress.Get() && r.sample >= lastSample;
+        lastSample = r.sample;
+        rxBytes += r.rxBytes;
+        txPackets += r.txPackets;
+        rxPackets += r.rxPackets;
+    }
+    Check(fieldsOk, "flow id, addresses or sample numbers of the records");
+    Check(txPackets == st.txPackets && txPackets == 100, "sum of the sampled tx packets");
+    Check(rxPackets == st.rxPackets && rxBytes == st.rxBytes, "sum of the sampled rx packets and bytes");
+    in.close();
+    std::remove(filename.c_str());
+}
+
+// A node's walk depends on its stream alone: one batch queried node by node
+// in reverse order and one evaluating every node on each query agree
+static void TestWaypointStreams(void) {
+    NodeContainer single;
+    NodeContainer batched;
+    single.Create(20);
+    batched.Create(20);
+    Ptr<WaypointBatch> a = CreateObject<WaypointBatch>();
+    Ptr<WaypointBatch> b = CreateObject<WaypointBatch>();
+    a->SetAttribute("BatchFraction", DoubleValue(1.0));
+    b->SetAttribute("BatchFraction", DoubleValue(0.0));
+    for (Ptr<WaypointBatch> batch : {a, b}) {
+        // Several legs per node within the run
+        batch->SetAttribute("MinSpeed", DoubleValue(5.0));
+        batch->SetAttribute("MaxSpeed", DoubleValue(10.0));
+        batch->SetAttribute("MaxPause", DoubleValue(1.0));
+    }
+    a->Install(single);
+    b->Install(batched);
+    Check(a->AssignStreams(7) == 20 && b->AssignStreams(7) == 20, "streams used by a batch");
+
+    bool same = true;
+    for (uint32_t step = 1; step <= 50; ++step) {
+        Simulator::Schedule(Seconds(step * 0.7), [&same, a, b, step]() {
+            for (uint32_t i = a->GetN(); i-- > 0;) {
+                if (step % 3 == 0 && i % 2) {
+                    continue;   // skipped nodes catch up at a later query
+                }
+                Vector p = a->GetPosition(i);
+                Vector q = b->GetPosition(i);
+                same = same && std::fabs(p.x - q.x) < 1e-9 && std::fabs(p.y - q.y) < 1e-9;
+            }
+        });
+    }
+    Simulator::Run();
+    Check(same, "positions depend on the evaluation order");
+    Simulator::Destroy();
+}
+
+// LadderScheduler has to hand out the events in the (ts, uid) order of
+// MapScheduler, also with cancellations and with many equal timestamps
+static void TestLadderOrder(void) {
+    for (uint32_t pattern = 0; pattern < 3; ++pattern) {
+        std::mt19937_64 rng(pattern + 1);
+        Ptr<Scheduler> ladder = CreateObject<LadderScheduler>();
+        ObjectFactory factory("ns3::MapScheduler");
+        Ptr<Scheduler> map = factory.Create<Scheduler>();
+
+        std::vector<Scheduler::Event> pending;
+        uint32_t uid = 0;
+        uint64_t now = 0;
+        uint64_t mismatches = 0;
+        for (uint32_t i = 0; i < 200000; ++i) {
+            uint32_t op = rng() % 10;
+            if (op < 5 || pending.empty()) {
+                // Slot-aligned bursts, uniform offsets, or near and far events
+                uint64_t delay = pattern == 0   ? (rng() % 4) * 1000
+                                 : pattern == 1 ? rng() % 100000
+                                                : (rng() % 2 ? rng() % 50 : rng() % 10000000);
+                Scheduler::Event ev;
+                ev.impl = nullptr;
+                ev.key.m_ts = now + delay;
+                ev.key.m_uid = uid++;
+                ev.key.m_context = 0;
+                ladder->Insert(ev);
+                map->Insert(ev);
+                pending.push_back(ev);
+            } else if (op < 9) {
+                Scheduler::Event a = ladder->RemoveNext();
+                Scheduler::Event b = map->RemoveNext();
+                if (a.key.m_ts != b.key.m_ts || a.key.m_uid != b.key.m_uid) {
+                    mismatches++;
+                }
+                now = b.key.m_ts;
+                for (auto& e : pending) {
+                    if (e.key.m_uid == b.key.m_uid) {
+                        e = pending.back();
+                        pending.pop_back();
+                        break;
+                    }
+                }
+            } else {
+                std::size_t k = rng() % pending.size();
+                ladder->Remove(pending[k]);
+                map->Remove(pending[k]);
+                pending[k] = pending.back();
+                pending.pop_back();
+            }
+        }
+        while (!map->IsEmpty()) {
+            Check(!ladder->IsEmpty(), "ladder empty before the map scheduler");
+            if (ladder->IsEmpty()) {
+                break;
+            }
+            Scheduler::Event a = ladder->RemoveNext();
+            Scheduler::Event b = map->RemoveNext();
+            if (a.key.m_ts != b.key.m_ts || a.key.m_uid != b.key.m_uid) {
+                mismatches++;
+            }
+        }
+        Check(ladder->IsEmpty(), "ladder holds events the map scheduler does not");
+        std::ostringstream what;
+        what << "pattern " << pattern << ": " << mismatches << " events out of MapScheduler order";
+        Check(mismatches == 0, what.str());
+    }
+}
+
+// Packets come back once only the pool holds them, without their tags;
+// packets still referenced elsewhere or resized are not handed out again
+static void TestPacketPool(void) {
+    PacketPool pool;
+    pool.SetPacketSize(100);
+    Ptr<Packet> a = pool.Get();
+    Ptr<Packet> b = pool.Get();
+    Check(a != b, "a packet in use was handed out again");
+    Check(pool.GetAllocated() == 2 && pool.GetReused() == 0, "allocations of the first packets");
+
+    uint64_t uid = a->GetUid();
+    SocketPriorityTag tag;
+    tag.SetPriority(3);
+    a->AddPacketTag(tag);
+    Packet* released = PeekPointer(a);
+    a = nullptr;
+    Ptr<Packet> c = pool.Get();
+    Check(PeekPointer(c) == released && c->GetUid() == uid, "a free packet was not reused");
+    Check(!c->PeekPacketTag(tag), "a reused packet kept its tags");
+    Check(pool.GetAllocated() == 2 && pool.GetReused() == 1, "counters after a reuse");
+
+    c->RemoveAtEnd(10);
+    c = nullptr;
+    b = nullptr;
+    Ptr<Packet> d = pool.Get();   // the unmodified packet
+    Ptr<Packet> e = pool.Get();   // replaces the shortened one
+    Check(d->GetSize() == 100 && e->GetSize() == 100, "payload size of the pooled packets");
+    Check(PeekPointer(e) != released, "a resized packet was handed out again");
+    Check(pool.GetAllocated() == 3 && pool.GetReused() == 2, "counters after a resize");
+
+    pool.SetEnabled(false);
+    d = nullptr;
+    pool.Get();
+    Check(pool.GetAllocated() == 4 && pool.GetReused() == 2, "a disabled pool reused a packet");
+}
+
+// Records written through EventLog read back field for field, with the
+// type table after them and the header completed by Close
+static void TestEventLogRoundTrip(void) {
+    const std::string filename = "tdma-components-test-events.bin";
+    const uint32_t n = 5000;   // more than one write block
+    EventLog log;
+    uint16_t tx = log.Register("Comp", "Tx", "bytes");
+    uint16_t drop = log.Register("Comp", "Drop", "bytes", "reason");
+    Check(log.Open(filename), "cannot open " + filename);
+    for (uint32_t i = 0; i < n; ++i) {
+        Simulator::Schedule(MicroSeconds(i), [&log, tx, drop, i]() {
+            if (i % 2) {
+                log.Log<EVLOG_WARN>(drop, i, i * 0.5, -1.0 * i);
+            } else {
+                log.Log<EVLOG_INFO>(tx, i, i * 0.5);
+            }
+        });
+    }
+    Simulator::Run();
+    Check(log.GetNRecords() == n, "record count before Close");
+    log.Close();
+    Simulator::Destroy();
+
+    std::ifstream in(filename, std::ios::in | std::ios::binary);
+    EventLogFileHeader header;
+    Check(in.read(reinterpret_cast<char*>(&header), sizeof(header)) && IsEventLogHeader(header),
+          "event log header");
+    Check(header.flags & EVLOG_CLOSED, "event log not marked closed");
+    Check(header.recordCount == n, "record count in the header");
+    std::vector<EventLogRecord> records(n);
+    Check(static_cast<bool>(in.read(reinterpret_cast<char*>(records.data()), n * sizeof(EventLogRecord))),
+          "event log records");
+    uint32_t bad = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        const EventLogRecord& r = records[i];
+        bool odd = i % 2;
+        if (r.timeNs != MicroSeconds(i).GetNanoSeconds() || r.context != i || r.type != (odd ? drop : tx) ||
+            r.level != (odd ? EVLOG_WARN : EVLOG_INFO) || r.value[0] != i * 0.5 ||
+            r.value[1] != (odd ? -1.0 * i : 0.0)) {
+            bad++;
+        }
+    }
+    Check(bad == 0, "event log records differ from the logged values");
+    std::string table((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    Check(table == "Comp\tTx\tbytes\t\nComp\tDrop\tbytes\treason\n", "event log type table");
+    in.close();
+    std::remove(filename.c_str());
+}
+
+int main(int argc, char *argv[]) {
+    CommandLine cmd;
+    cmd.Parse(argc, argv);
+
+    struct {
+        const char* name;
+        void (*run)(void);
+    } tests[] = {
+        {"tdma client app slots", &TestClientAppSlots},
+        {"tdma slot assignment", &TestSlotAssignment},
+        {"flow collector late losses", &TestCollectorLateLosses},
+        {"flow metrics round trip", &TestFlowMetricsRoundTrip},
+        {"waypoint streams", &TestWaypointStreams},
+        {"ladder scheduler order", &TestLadderOrder},
+        {"packet pool reuse", &TestPacketPool},
+        {"event log round trip", &TestEventLogRoundTrip},
+    };
+    for (const auto& test : tests) {
+        uint32_t before = g_failures;
+        test.run();
+        std::cout << (g_failures == before ? "ok     " : "FAILED ") << test.name << std::endl;
+    }
+    return g_failures == 0 ? 0 : 1;
+}
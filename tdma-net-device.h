@@ -0,0 +1,439 @@
+#ifndef TDMA_NET_DEVICE_H
+#define TDMA_NET_DEVICE_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-module.h"
+
+#include "tdma-slot-scheduler.h"
+
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace ns3 {
+
+class TdmaNetDevice;
+
+// Shared medium for TdmaNetDevice. The slot table guarantees a single
+// transmitter at any time, so there is no carrier sensing, backoff or ACK:
+// a unicast frame is handed straight to the addressed device and a
+// broadcast/multicast frame to every device within MaxRange.
+class TdmaChannel : public Channel {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::TdmaChannel")
+            .SetParent<Channel>()
+            .SetGroupName("Tdma")
+            .AddConstructor<TdmaChannel>()
+            .AddAttribute("MaxRange",
+                          "Maximum distance (m) at which a frame is received, 0 for unlimited",
+                          DoubleValue(0.0),
+                          MakeDoubleAccessor(&TdmaChannel::m_maxRange),
+                          MakeDoubleChecker<double>(0.0))
+            .AddAttribute("Speed",
+                          "Propagation speed (m/s) used to compute the propagation delay",
+                          DoubleValue(299792458.0),
+                          MakeDoubleAccessor(&TdmaChannel::m_speed),
+                          MakeDoubleChecker<double>(0.0));
+        return tid;
+    }
+
+    TdmaChannel() : m_maxRange(0.0), m_speed(299792458.0) {}
+
+    void Add(Ptr<TdmaNetDevice> device);
+    void Transmit(Ptr<TdmaNetDevice> sender, Ptr<Packet> packet, uint16_t protocol,
+                  Mac48Address to, Mac48Address from, Time txTime);
+
+    std::size_t GetNDevices(void) const override { return m_devices.size(); }
+    Ptr<NetDevice> GetDevice(std::size_t i) const override;
+
+protected:
+    void DoDispose(void) override {
+        m_devices.clear();
+        m_byAddress.clear();
+        Channel::DoDispose();
+    }
+
+private:
+    // Returns false if the receiver is out of range, otherwise the propagation delay
+    bool GetDelay(Ptr<TdmaNetDevice> sender, Ptr<TdmaNetDevice> receiver, Time& delay) const;
+
+    std::vector<Ptr<TdmaNetDevice>> m_devices;
+    std::map<Mac48Address, Ptr<TdmaNetDevice>> m_byAddress;
+    double m_maxRange;
+    double m_speed;
+};
+
+// Contention-free TDMA MAC. The device is told by a TdmaSlotScheduler when
+// one of its slots starts and how long the usable window is, and only sends
+// inside that window. A frame is only started if it completes before the
+// window closes.
+//
+// Frames are queued per destination. A slot started through StartSlot() may
+// carry frames to any destination, oldest first (a UE sending to its BS). A
+// slot started for an owner (StartSlotFor(), a BS downlink slot) only carries
+// the frames addressed to that owner and group-addressed frames, so the
+// backlog of one UE never takes the downlink slot of another.
+class TdmaNetDevice : public NetDevice {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::TdmaNetDevice")
+            .SetParent<NetDevice>()
+            .SetGroupName("Tdma")
+            .AddConstructor<TdmaNetDevice>()
+            .AddAttribute("DataRate",
+                          "Transmission rate used to compute the frame airtime",
+                          DataRateValue(DataRate("11Mbps")),
+                          MakeDataRateAccessor(&TdmaNetDevice::m_dataRate),
+                          MakeDataRateChecker())
+            .AddAttribute("Mtu",
+                          "MAC-level Maximum Transmission Unit",
+                          UintegerValue(1500),
+                          MakeUintegerAccessor(&TdmaNetDevice::SetMtu, &TdmaNetDevice::GetMtu),
+                          MakeUintegerChecker<uint16_t>())
+            .AddAttribute("MacOverhead",
+                          "Bytes of MAC header and trailer added to the airtime of every frame",
+                          UintegerValue(28),
+                          MakeUintegerAccessor(&TdmaNetDevice::m_macOverhead),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("MaxQueuePackets",
+                          "Maximum number of packets waiting for a slot, per destination",
+                          UintegerValue(100),
+                          MakeUintegerAccessor(&TdmaNetDevice::m_maxQueuePackets),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddTraceSource("MacTx",
+                            "A packet has been handed to the channel",
+                            MakeTraceSourceAccessor(&TdmaNetDevice::m_macTxTrace),
+                            "ns3::Packet::TracedCallback")
+            .AddTraceSource("MacTxDrop",
+                            "A packet has been dropped before transmission",
+                            MakeTraceSourceAccessor(&TdmaNetDevice::m_macTxDropTrace),
+                            "ns3::Packet::TracedCallback")
+            .AddTraceSource("MacRx",
+                            "A packet has been received by this device",
+                            MakeTraceSourceAccessor(&TdmaNetDevice::m_macRxTrace),
+                            "ns3::Packet::TracedCallback");
+        return tid;
+    }
+
+    TdmaNetDevice()
+        : m_ifIndex(0),
+          m_mtu(1500),
+          m_macOverhead(28),
+          m_maxQueuePackets(100),
+          m_nextSeq(0),
+          m_slotOwned(false),
+          m_txBusy(false) {}
+
+    // Slot listener: one of our slots starts and may be used for txWindow,
+    // for frames to any destination
+    void StartSlot(Time txWindow) {
+        m_slotEnd = Simulator::Now() + txWindow;
+        m_slotOwned = false;
+        TryTransmit();
+    }
+
+    // Slot listener: a slot owned by owner starts and may be used for
+    // txWindow, only for frames to owner and group-addressed frames
+    static void StartSlotFor(Ptr<TdmaNetDevice> device, Mac48Address owner, Time txWindow) {
+        device->m_slotEnd = Simulator::Now() + txWindow;
+        device->m_slotOwned = true;
+        device->m_slotOwner = owner;
+        device->TryTransmit();
+    }
+
+    void SetChannel(Ptr<TdmaChannel> channel) {
+        m_channel = channel;
+        m_channel->Add(this);
+        m_linkChangeCallbacks();
+    }
+
+    // Called by the channel when a frame addressed to (or broadcast past) us ends
+    void Receive(Ptr<Packet> packet, uint16_t protocol, Mac48Address to, Mac48Address from) {
+        NetDevice::PacketType packetType;
+        if (to == m_address) {
+            packetType = NetDevice::PACKET_HOST;
+        } else if (to.IsBroadcast()) {
+            packetType = NetDevice::PACKET_BROADCAST;
+        } else if (to.IsGroup()) {
+            packetType = NetDevice::PACKET_MULTICAST;
+        } else {
+            packetType = NetDevice::PACKET_OTHERHOST;
+        }
+
+        m_macRxTrace(packet);
+        if (!m_promiscCallback.IsNull()) {
+            m_promiscCallback(this, packet, protocol, from, to, packetType);
+        }
+        if (packetType != NetDevice::PACKET_OTHERHOST) {
+            m_rxCallback(this, packet, protocol, from);
+        }
+    }
+
+    // NetDevice
+    void SetIfIndex(const uint32_t index) override { m_ifIndex = index; }
+    uint32_t GetIfIndex(void) const override { return m_ifIndex; }
+    Ptr<Channel> GetChannel(void) const override { return m_channel; }
+    void SetAddress(Address address) override { m_address = Mac48Address::ConvertFrom(address); }
+    Address GetAddress(void) const override { return m_address; }
+    bool SetMtu(const uint16_t mtu) override { m_mtu = mtu; return true; }
+    uint16_t GetMtu(void) const override { return m_mtu; }
+    bool IsLinkUp(void) const override { return m_channel != nullptr; }
+    void AddLinkChangeCallback(Callback<void> callback) override {
+        m_linkChangeCallbacks.ConnectWithoutContext(callback);
+    }
+    bool IsBroadcast(void) const override { return true; }
+    Address GetBroadcast(void) const override { return Mac48Address::GetBroadcast(); }
+    bool IsMulticast(void) const override { return true; }
+    Address GetMulticast(Ipv4Address multicastGroup) const override {
+        return Mac48Address::GetMulticast(multicastGroup);
+    }
+    Address GetMulticast(Ipv6Address addr) const override { return Mac48Address::GetMulticast(addr); }
+    bool IsPointToPoint(void) const override { return false; }
+    bool IsBridge(void) const override { return false; }
+    bool Send(Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber) override {
+        return Enqueue(packet, m_address, Mac48Address::ConvertFrom(dest), protocolNumber);
+    }
+    bool SendFrom(Ptr<Packet> packet, const Address& source, const Address& dest,
+                  uint16_t protocolNumber) override {
+        return Enqueue(packet, Mac48Address::ConvertFrom(source), Mac48Address::ConvertFrom(dest),
+                       protocolNumber);
+    }
+    Ptr<Node> GetNode(void) const override { return m_node; }
+    void SetNode(Ptr<Node> node) override { m_node = node; }
+    bool NeedsArp(void) const override { return true; }
+    void SetReceiveCallback(NetDevice::ReceiveCallback cb) override { m_rxCallback = cb; }
+    void SetPromiscReceiveCallback(NetDevice::PromiscReceiveCallback cb) override { m_promiscCallback = cb; }
+    bool SupportsSendFrom(void) const override { return true; }
+
+protected:
+    void DoDispose(void) override {
+        Simulator::Cancel(m_txEndEvent);
+        m_queues.clear();
+        m_channel = nullptr;
+        m_node = nullptr;
+        m_rxCallback.Nullify();
+        m_promiscCallback.Nullify();
+        NetDevice::DoDispose();
+    }
+
+private:
+    struct QueueItem {
+        Ptr<Packet> packet;
+        Mac48Address from;
+        Mac48Address to;
+        uint16_t protocol;
+        uint64_t seq;           // arrival order across the queues
+    };
+
+    bool Enqueue(Ptr<Packet> packet, Mac48Address from, Mac48Address to, uint16_t protocol) {
+        std::deque<QueueItem>& queue = m_queues[QueueOf(to)];
+        if (packet->GetSize() > m_mtu || queue.size() >= m_maxQueuePackets) {
+            m_macTxDropTrace(packet);
+            return false;
+        }
+        queue.push_back({packet, from, to, protocol, m_nextSeq++});
+        TryTransmit();
+        return true;
+    }
+
+    // All group-addressed frames share the queue of the broadcast address
+    static Mac48Address QueueOf(Mac48Address to) {
+        return to.IsGroup() ? Mac48Address::GetBroadcast() : to;
+    }
+
+    // Queue of the oldest frame the current slot may carry, or nullptr
+    std::deque<QueueItem>* NextQueue(void) {
+        if (m_slotOwned) {
+            std::deque<QueueItem>* best = nullptr;
+            for (Mac48Address key : {m_slotOwner, Mac48Address::GetBroadcast()}) {
+                auto it = m_queues.find(key);
+                if (it != m_queues.end() && !it->second.empty() &&
+                    (!best || it->second.front().seq < best->front().seq)) {
+                    best = &it->second;
+                }
+            }
+            return best;
+        }
+        std::deque<QueueItem>* best = nullptr;
+        for (auto& entry : m_queues) {
+            if (!entry.second.empty() && (!best || entry.second.front().seq < best->front().seq)) {
+                best = &entry.second;
+            }
+        }
+        return best;
+    }
+
+    void TryTransmit(void) {
+        while (!m_txBusy && Simulator::Now() < m_slotEnd) {
+            std::deque<QueueItem>* queue = NextQueue();
+            if (!queue) {
+                return;
+            }
+            QueueItem item = queue->front();
+            Time txTime = m_dataRate.CalculateBytesTxTime(item.packet->GetSize() + m_macOverhead);
+            if (Simulator::Now() + txTime > m_slotEnd) {
+                // Does not fit in what is left of the slot, wait for the next one
+                return;
+            }
+
+            queue->pop_front();
+            m_txBusy = true;
+            m_macTxTrace(item.packet);
+            m_channel->Transmit(this, item.packet, item.protocol, item.to, item.from, txTime);
+            m_txEndEvent = Simulator::Schedule(txTime, &TdmaNetDevice::TransmitComplete, this);
+        }
+    }
+
+    void TransmitComplete(void) {
+        m_txBusy = false;
+        TryTransmit();
+    }
+
+    Ptr<Node> m_node;
+    Ptr<TdmaChannel> m_channel;
+    Mac48Address m_address;
+    uint32_t m_ifIndex;
+    uint16_t m_mtu;
+    DataRate m_dataRate;
+    uint32_t m_macOverhead;
+    uint32_t m_maxQueuePackets;
+
+    std::map<Mac48Address, std::deque<QueueItem>> m_queues;
+    uint64_t m_nextSeq;
+    EventId m_txEndEvent;
+    Time m_slotEnd;
+    bool m_slotOwned;
+    Mac48Address m_slotOwner;
+    bool m_txBusy;
+
+    NetDevice::ReceiveCallback m_rxCallback;
+    NetDevice::PromiscReceiveCallback m_promiscCallback;
+    TracedCallback<> m_linkChangeCallbacks;
+    TracedCallback<Ptr<const Packet>> m_macTxTrace;
+    TracedCallback<Ptr<const Packet>> m_macTxDropTrace;
+    TracedCallback<Ptr<const Packet>> m_macRxTrace;
+};
+
+inline void TdmaChannel::Add(Ptr<TdmaNetDevice> device) {
+    m_devices.push_back(device);
+    m_byAddress[Mac48Address::ConvertFrom(device->GetAddress())] = device;
+}
+
+inline Ptr<NetDevice> TdmaChannel::GetDevice(std::size_t i) const {
+    return m_devices[i];
+}
+
+inline bool TdmaChannel::GetDelay(Ptr<TdmaNetDevice> sender, Ptr<TdmaNetDevice> receiver,
+                                  Time& delay) const {
+    Ptr<MobilityModel> a = sender->GetNode()->GetObject<MobilityModel>();
+    Ptr<MobilityModel> b = receiver->GetNode()->GetObject<MobilityModel>();
+    if (!a || !b) {
+        delay = Time(0);
+        return true;
+    }
+    double distance = a->GetDistanceFrom(b);
+    if (m_maxRange > 0.0 && distance > m_maxRange) {
+        return false;
+    }
+    delay = Seconds(distance / m_speed);
+    return true;
+}
+
+inline void TdmaChannel::Transmit(Ptr<TdmaNetDevice> sender, Ptr<Packet> packet, uint16_t protocol,
+                                  Mac48Address to, Mac48Address from, Time txTime) {
+    Time delay;
+    if (!to.IsGroup()) {
+        auto it = m_byAddress.find(to);
+        if (it == m_byAddress.end() || !GetDelay(sender, it->second, delay)) {
+            return;
+        }
+        Ptr<TdmaNetDevice> dst = it->second;
+        Simulator::ScheduleWithContext(dst->GetNode()->GetId(), txTime + delay,
+                                       &TdmaNetDevice::Receive, dst, packet->Copy(), protocol, to, from);
+        return;
+    }
+
+    for (const auto& dst : m_devices) {
+        if (dst == sender || !GetDelay(sender, dst, delay)) {
+            continue;
+        }
+        Simulator::ScheduleWithContext(dst->GetNode()->GetId(), txTime + delay,
+                                       &TdmaNetDevice::Receive, dst, packet->Copy(), protocol, to, from);
+    }
+}
+
+// Installs TdmaNetDevices on a shared TdmaChannel and ties them to the slots
+// of a TdmaSlotScheduler. It can be used in place of WifiHelper::Install in
+// the TDMA scenarios.
+class TdmaHelper {
+public:
+    TdmaHelper() {
+        m_deviceFactory.SetTypeId("ns3::TdmaNetDevice");
+        m_channelFactory.SetTypeId("ns3::TdmaChannel");
+    }
+
+    void SetDeviceAttribute(std::string name, const AttributeValue& value) {
+        m_deviceFactory.Set(name, value);
+    }
+
+    void SetChannelAttribute(std::string name, const AttributeValue& value) {
+        m_channelFactory.Set(name, value);
+    }
+
+    // The TDMA MAC has no association phase, so resolve neighbours up front
+    // instead of queueing the first packets of every slot behind ARP. Call
+    // once after the IPv4 addresses are assigned.
+    static void PopulateNeighbours(void) {
+        NeighborCacheHelper neighborCache;
+        neighborCache.PopulateNeighborCache();
+    }
+
+    Ptr<TdmaChannel> CreateChannel(void) const {
+        return m_channelFactory.Create<TdmaChannel>();
+    }
+
+    NetDeviceContainer Install(NodeContainer nodes, Ptr<TdmaChannel> channel) const {
+        NetDeviceContainer devices;
+        for (uint32_t i = 0; i < nodes.GetN(); ++i) {
+            Ptr<TdmaNetDevice> device = m_deviceFactory.Create<TdmaNetDevice>();
+            device->SetAddress(Mac48Address::Allocate());
+            nodes.Get(i)->AddDevice(device);
+            device->SetChannel(channel);
+            devices.Add(device);
+        }
+        return devices;
+    }
+
+    // The device transmits in the (ue, direction) slots of the scheduler
+    void AssignSlot(Ptr<NetDevice> device, Ptr<TdmaSlotScheduler> scheduler, uint32_t ue,
+                    TdmaDirection direction) const {
+        Ptr<TdmaNetDevice> tdmaDevice = DynamicCast<TdmaNetDevice>(device);
+        NS_ASSERT_MSG(tdmaDevice, "AssignSlot() needs a TdmaNetDevice");
+        scheduler->AddSlotListener(ue, direction, MakeCallback(&TdmaNetDevice::StartSlot, tdmaDevice));
+    }
+
+    // As above, but the slots only carry the frames addressed to owner (the
+    // device of the UE), e.g. the downlink slots of a BS
+    void AssignSlot(Ptr<NetDevice> device, Ptr<TdmaSlotScheduler> scheduler, uint32_t ue,
+                    TdmaDirection direction, Ptr<NetDevice> owner) const {
+        Ptr<TdmaNetDevice> tdmaDevice = DynamicCast<TdmaNetDevice>(device);
+        NS_ASSERT_MSG(tdmaDevice, "AssignSlot() needs a TdmaNetDevice");
+        scheduler->AddSlotListener(ue, direction,
+                                   MakeBoundCallback(&TdmaNetDevice::StartSlotFor, tdmaDevice,
+                                                     Mac48Address::ConvertFrom(owner->GetAddress())));
+    }
+
+private:
+    ObjectFactory m_deviceFactory;
+    ObjectFactory m_channelFactory;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(TdmaChannel);
+NS_OBJECT_ENSURE_REGISTERED(TdmaNetDevice);
+
+} // namespace ns3
+
+#endif // TDMA_NET_DEVICE_H
@@ -0,0 +1,137 @@
+#include "ns3/core-module.h"
+
+#include "ladder-scheduler.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("TdmaSchedulerBench");
+
+// Hold-model benchmark of the event schedulers on the event pattern of the
+// TDMA scenarios: every UE transmits every packetInterval inside its slot,
+// and after the last packet of the slot its next event is one cycle later.
+// The queue holds numUes * eventsPerUe events; every operation removes the
+// next one and inserts its successor, like Simulator::Run does.
+//
+// ./ns3 run "tdma-scheduler-bench --numUes=200 --operations=10000000"
+
+struct Workload {
+    uint64_t slot;        // ns
+    uint64_t interval;    // ns
+    uint64_t cycle;       // ns
+};
+
+// Next transmission of UE ue after ts
+static uint64_t NextTx(const Workload& w, uint32_t ue, uint64_t ts) {
+    uint64_t cycleStart = ts - ts % w.cycle;
+    uint64_t slotStart = cycleStart + ue * w.slot;
+    uint64_t next = ts + w.interval;
+    if (next >= slotStart + w.slot) {
+        next = slotStart + w.cycle;
+    }
+    return next;
+}
+
+// Removes operations events and re-inserts their successors. checksum is an
+// order-sensitive hash of the removed (ts, uid) sequence and misordered the
+// number of removals whose key is smaller than the previous one.
+static double Run(const std::string& type, const Workload& w, uint32_t numUes, uint32_t eventsPerUe,
+                  uint64_t operations, uint64_t& checksum, uint64_t& misordered) {
+    ObjectFactory factory;
+    factory.SetTypeId(type);
+    Ptr<Scheduler> scheduler = factory.Create<Scheduler>();
+
+    uint32_t uid = 0;
+    for (uint32_t ue = 0; ue < numUes; ++ue) {
+        for (uint32_t k = 0; k < eventsPerUe; ++k) {
+            Scheduler::Event ev;
+            ev.impl = nullptr;
+            ev.key.m_ts = ue * w.slot + k * w.interval / eventsPerUe;
+            ev.key.m_uid = uid++;
+            ev.key.m_context = ue;
+            scheduler->Insert(ev);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    checksum = 14695981039346656037ULL;
+    misordered = 0;
+    Scheduler::EventKey last = {0, 0, 0};
+    for (uint64_t i = 0; i < operations; ++i) {
+        Scheduler::Event ev = scheduler->RemoveNext();
+        // FNV-1a over the key sequence
+        checksum = (checksum ^ ev.key.m_ts) * 1099511628211ULL;
+        checksum = (checksum ^ ev.key.m_uid) * 1099511628211ULL;
+        if (ev.key < last) {
+            misordered++;
+        }
+        last = ev.key;
+        ev.key.m_ts = NextTx(w, ev.key.m_context, ev.key.m_ts);
+        ev.key.m_uid = uid++;
+        scheduler->Insert(ev);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    while (!scheduler->IsEmpty()) {
+        scheduler->RemoveNext();
+    }
+    return seconds;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t numUes = 200;
+    double slotDuration = 0.1;
+    uint32_t packetsPerSlot = 10;
+    uint32_t eventsPerUe = 4;
+    uint64_t operations = 10000000;
+    std::string schedulers = "ns3::MapScheduler,ns3::HeapScheduler,ns3::CalendarScheduler,"
+                             "ns3::PriorityQueueScheduler,ns3::LadderScheduler";
+
+    CommandLine cmd;
+    cmd.AddValue("numUes", "Number of UEs sharing the TDMA frame", numUes);
+    cmd.AddValue("slotDuration", "Duration of each TDMA slot (seconds)", slotDuration);
+    cmd.AddValue("packetsPerSlot", "Packets sent by a UE in its slot", packetsPerSlot);
+    cmd.AddValue("eventsPerUe", "Pending events per UE (apps, timers, MAC)", eventsPerUe);
+    cmd.AddValue("operations", "Remove/insert pairs per scheduler", operations);
+    cmd.AddValue("schedulers", "Comma separated scheduler TypeIds to compare", schedulers);
+    cmd.Parse(argc, argv);
+
+    Workload w;
+    w.slot = Seconds(slotDuration).GetNanoSeconds();
+    w.interval = w.slot / packetsPerSlot;
+    w.cycle = w.slot * numUes;
+
+    std::cout << numUes * eventsPerUe << " pending events, " << operations << " operations\n";
+    std::cout << std::left << std::setw(30) << "scheduler" << std::right << std::setw(12) << "seconds"
+              << std::setw(14) << "Mops/s" << "\n";
+
+    std::stringstream ss(schedulers);
+    std::string type;
+    uint64_t reference = 0;
+    bool first = true;
+    while (std::getline(ss, type, ',')) {
+        uint64_t checksum;
+        uint64_t misordered;
+        double seconds = Run(type, w, numUes, eventsPerUe, operations, checksum, misordered);
+        std::cout << std::left << std::setw(30) << type << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(12) << seconds << std::setw(14) << operations / seconds / 1e6 << "\n";
+        // Every scheduler has to hand out the events in (ts, uid) order, which
+        // makes the removal sequence, and its hash, the same for all of them
+        if (misordered > 0) {
+            std::cout << "  " << misordered << " events removed before an earlier one\n";
+        }
+        if (first) {
+            reference = checksum;
+            first = false;
+        } else if (checksum != reference) {
+            std::cout << "  event order differs from the first scheduler\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,437 @@
+#ifndef TDMA_SLOT_SCHEDULER_H
+#define TDMA_SLOT_SCHEDULER_H
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <map>
+#include <vector>
+
+namespace ns3 {
+
+enum TdmaDirection : uint8_t {
+    TDMA_UPLINK = 0,
+    TDMA_DOWNLINK = 1
+};
+
+// One entry of a TDMA frame
+struct TdmaSlot {
+    static constexpr uint32_t IDLE = std::numeric_limits<uint32_t>::max();
+
+    uint32_t ue;              // owning UE, IDLE if nobody transmits
+    uint32_t group;           // BS / cell the UE belongs to
+    TdmaDirection direction;
+    Time duration;            // includes the guard time
+};
+
+class TdmaSlotScheduler;
+
+// Builds the slot sequence of one frame for the UEs of one timeline. The
+// scheduler calls BuildFrame at the start of every frame, so a policy may
+// change the layout from frame to frame.
+class TdmaSlotPolicy : public Object {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::TdmaSlotPolicy")
+            .SetParent<Object>()
+            .SetGroupName("Tdma");
+        return tid;
+    }
+
+    virtual void BuildFrame(const TdmaSlotScheduler& scheduler, const std::vector<uint32_t>& ues,
+                            std::vector<TdmaSlot>& frame) = 0;
+};
+
+// Frame owner for the TDMA scenarios. It holds the UL/DL slot layout of every
+// timeline (one per BS group when ParallelGroups is set, otherwise a single
+// shared one) and schedules exactly one event per slot boundary. At each
+// boundary the listeners registered for the (UE, direction) owning the new
+// slot are called with the usable transmit window, i.e. the slot duration
+// minus the guard time.
+class TdmaSlotScheduler : public Object {
+public:
+    typedef Callback<void, Time> SlotCallback;
+
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::TdmaSlotScheduler")
+            .SetParent<Object>()
+            .SetGroupName("Tdma")
+            .AddConstructor<TdmaSlotScheduler>()
+            .AddAttribute("SlotDuration",
+                          "Nominal duration of one slot",
+                          TimeValue(Seconds(0.1)),
+                          MakeTimeAccessor(&TdmaSlotScheduler::m_slotDuration),
+                          MakeTimeChecker())
+            .AddAttribute("GuardTime",
+                          "Idle time at the end of every slot",
+                          TimeValue(MilliSeconds(1)),
+                          MakeTimeAccessor(&TdmaSlotScheduler::m_guardTime),
+                          MakeTimeChecker())
+            .AddAttribute("ParallelGroups",
+                          "Run one independent frame per BS group instead of a shared frame",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&TdmaSlotScheduler::m_parallelGroups),
+                          MakeBooleanChecker());
+        return tid;
+    }
+
+    TdmaSlotScheduler() : m_parallelGroups(false) {}
+
+    // Adds a UE to a BS group and returns its index
+    uint32_t AddUe(uint32_t group) {
+        m_ueGroup.push_back(group);
+        m_listeners.resize(2 * m_ueGroup.size());
+        return m_ueGroup.size() - 1;
+    }
+
+    uint32_t GetNUes(void) const { return m_ueGroup.size(); }
+    uint32_t GetGroup(uint32_t ue) const { return m_ueGroup[ue]; }
+    Time GetSlotDuration(void) const { return m_slotDuration; }
+    Time GetGuardTime(void) const { return m_guardTime; }
+
+    void SetPolicy(Ptr<TdmaSlotPolicy> policy) { m_policy = policy; }
+    Ptr<TdmaSlotPolicy> GetPolicy(void) const { return m_policy; }
+
+    void AddSlotListener(uint32_t ue, TdmaDirection direction, SlotCallback cb) {
+        NS_ASSERT_MSG(ue < m_ueGroup.size(), "Unknown UE " << ue);
+        m_listeners[2 * ue + direction].push_back(cb);
+    }
+
+    // The first boundary is deferred by one ScheduleNow so that applications
+    // starting at the same instant are already running when their slot is
+    // announced.
+    void Start(Time startTime) {
+        NS_ASSERT_MSG(m_policy, "No slot policy set");
+        NS_ASSERT_MSG(m_guardTime < m_slotDuration, "Guard time must be shorter than the slot");
+
+        std::map<uint32_t, uint32_t> timelineOf;
+        for (auto& tl : m_timelines) {
+            Simulator::Cancel(tl.boundaryEvent);
+        }
+        m_timelines.clear();
+        for (uint32_t ue = 0; ue < m_ueGroup.size(); ++ue) {
+            uint32_t key = m_parallelGroups ? m_ueGroup[ue] : 0;
+            auto it = timelineOf.find(key);
+            if (it == timelineOf.end()) {
+                it = timelineOf.emplace(key, m_timelines.size()).first;
+                m_timelines.emplace_back();
+            }
+            m_timelines[it->second].ues.push_back(ue);
+        }
+        for (uint32_t t = 0; t < m_timelines.size(); ++t) {
+            m_timelines[t].boundaryEvent = Simulator::Schedule(startTime, &TdmaSlotScheduler::BeginTimeline, this, t);
+        }
+    }
+
+    uint32_t GetNTimelines(void) const { return m_timelines.size(); }
+    uint32_t GetFrameSize(uint32_t timeline) const { return m_timelines[timeline].frame.size(); }
+
+    // Owner of slot n of the current frame of a timeline, O(1)
+    const TdmaSlot& GetSlot(uint32_t timeline, uint32_t n) const {
+        return m_timelines[timeline].frame[n];
+    }
+
+    const TdmaSlot& GetCurrentSlot(uint32_t timeline) const {
+        const Timeline& tl = m_timelines[timeline];
+        return tl.frame[tl.current];
+    }
+
+protected:
+    void DoDispose(void) override {
+        for (auto& tl : m_timelines) {
+            Simulator::Cancel(tl.boundaryEvent);
+        }
+        m_timelines.clear();
+        m_listeners.clear();
+        m_policy = nullptr;
+        Object::DoDispose();
+    }
+
+private:
+    struct Timeline {
+        std::vector<uint32_t> ues;
+        std::vector<TdmaSlot> frame;
+        uint32_t current = 0;
+        EventId boundaryEvent;   // next slot boundary, or the start of the timeline
+    };
+
+    void BeginTimeline(uint32_t timeline) {
+        Timeline& tl = m_timelines[timeline];
+        tl.current = 0;
+        tl.frame.clear();
+        tl.boundaryEvent = Simulator::ScheduleNow(&TdmaSlotScheduler::SlotBoundary, this, timeline);
+    }
+
+    void SlotBoundary(uint32_t timeline) {
+        Timeline& tl = m_timelines[timeline];
+        if (++tl.current >= tl.frame.size()) {
+            tl.current = 0;
+            tl.frame.clear();
+            m_policy->BuildFrame(*this, tl.ues, tl.frame);
+            if (tl.frame.empty()) {
+                // Nobody to serve: keep the clock running with an idle slot
+                tl.frame.push_back({TdmaSlot::IDLE, 0, TDMA_UPLINK, m_slotDuration});
+            }
+        }
+
+        const TdmaSlot& slot = tl.frame[tl.current];
+        tl.boundaryEvent = Simulator::Schedule(slot.duration, &TdmaSlotScheduler::SlotBoundary, this, timeline);
+        if (slot.ue == TdmaSlot::IDLE) {
+            return;
+        }
+        Time window = slot.duration - m_guardTime;
+        for (auto& cb : m_listeners[2 * slot.ue + slot.direction]) {
+            cb(window);
+        }
+    }
+
+    Time m_slotDuration;
+    Time m_guardTime;
+    bool m_parallelGroups;
+    Ptr<TdmaSlotPolicy> m_policy;
+    std::vector<uint32_t> m_ueGroup;
+    std::vector<std::vector<SlotCallback>> m_listeners;
+    std::vector<Timeline> m_timelines;
+};
+
+// Every UE gets an uplink slot followed by a downlink slot, in UE order
+class TdmaRoundRobinPolicy : public TdmaSlotPolicy {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::TdmaRoundRobinPolicy")
+            .SetParent<TdmaSlotPolicy>()
+            .SetGroupName("Tdma")
+            .AddConstructor<TdmaRoundRobinPolicy>();
+        return tid;
+    }
+
+    void BuildFrame(const TdmaSlotScheduler& scheduler, const std::vector<uint32_t>& ues,
+                    std::vector<TdmaSlot>& frame) override {
+        Time d = scheduler.GetSlotDuration();
+        for (uint32_t ue : ues) {
+            frame.push_back({ue, scheduler.GetGroup(ue), TDMA_UPLINK, d});
+            frame.push_back({ue, scheduler.GetGroup(ue), TDMA_DOWNLINK, d});
+        }
+    }
+};
+
+// Round-robin order, but each slot lasts weight * SlotDuration. Weights
+// default to UplinkWeight / DownlinkWeight and can be overridden per UE.
+class TdmaWeightedPolicy : public TdmaSlotPolicy {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::TdmaWeightedPolicy")
+            .SetParent<TdmaSlotPolicy>()
+            .SetGroupName("Tdma")
+            .AddConstructor<TdmaWeightedPolicy>()
+            .AddAttribute("UplinkWeight",
+                          "Default weight of uplink slots",
+                          DoubleValue(1.0),
+                          MakeDoubleAccessor(&TdmaWeightedPolicy::m_uplinkWeight),
+                          MakeDoubleChecker<double>(0.0))
+            .AddAttribute("DownlinkWeight",
+                          "Default weight of downlink slots",
+                          DoubleValue(1.0),
+                          MakeDoubleAccessor(&TdmaWeightedPolicy::m_downlinkWeight),
+                          MakeDoubleChecker<double>(0.0));
+        return tid;
+    }
+
+    TdmaWeightedPolicy() : m_uplinkWeight(1.0), m_downlinkWeight(1.0) {}
+
+    void SetWeight(uint32_t ue, TdmaDirection direction, double weight) {
+        if (m_weights.size() <= 2 * ue + 1) {
+            m_weights.resize(2 * ue + 2, -1.0);
+        }
+        m_weights[2 * ue + direction] = weight;
+    }
+
+    void BuildFrame(const TdmaSlotScheduler& scheduler, const std::vector<uint32_t>& ues,
+                    std::vector<TdmaSlot>& frame) override {
+        Time d = scheduler.GetSlotDuration();
+        for (uint32_t ue : ues) {
+            for (TdmaDirection dir : {TDMA_UPLINK, TDMA_DOWNLINK}) {
+                Time duration = Seconds(d.GetSeconds() * GetWeight(ue, dir));
+                if (duration > scheduler.GetGuardTime()) {
+                    frame.push_back({ue, scheduler.GetGroup(ue), dir, duration});
+                }
+            }
+        }
+    }
+
+private:
+    double GetWeight(uint32_t ue, TdmaDirection dir) const {
+        std::size_t idx = 2 * ue + dir;
+        if (idx < m_weights.size() && m_weights[idx] >= 0.0) {
+            return m_weights[idx];
+        }
+        return dir == TDMA_UPLINK ? m_uplinkWeight : m_downlinkWeight;
+    }
+
+    double m_uplinkWeight;
+    double m_downlinkWeight;
+    std::vector<double> m_weights;
+};
+
+// Only (UE, direction) pairs that report a non-zero backlog get a slot in
+// the next frame. The backlog is read once per frame through the demand
+// callback.
+class TdmaDemandPolicy : public TdmaSlotPolicy {
+public:
+    typedef std::function<uint32_t(uint32_t ue, TdmaDirection direction)> DemandCallback;
+
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::TdmaDemandPolicy")
+            .SetParent<TdmaSlotPolicy>()
+            .SetGroupName("Tdma")
+            .AddConstructor<TdmaDemandPolicy>();
+        return tid;
+    }
+
+    void SetDemandCallback(DemandCallback cb) { m_demand = cb; }
+
+    void BuildFrame(const TdmaSlotScheduler& scheduler, const std::vector<uint32_t>& ues,
+                    std::vector<TdmaSlot>& frame) override {
+        NS_ASSERT_MSG(m_demand, "TdmaDemandPolicy needs a demand callback");
+        Time d = scheduler.GetSlotDuration();
+        for (uint32_t ue : ues) {
+            for (TdmaDirection dir : {TDMA_UPLINK, TDMA_DOWNLINK}) {
+                if (m_demand(ue, dir) > 0) {
+                    frame.push_back({ue, scheduler.GetGroup(ue), dir, d});
+                }
+            }
+        }
+    }
+
+protected:
+    DemandCallback m_demand;
+};
+
+// Demand-driven frame packing. Every (UE, direction) with a backlog gets a
+// slot long enough for its queued packets, at PacketsPerSlot packets per
+// nominal slot and capped at SlotDuration, so an active UE waits about one
+// frame of the active UEs instead of 2 * SlotDuration * numUes. Uplinks
+// with nothing queued get a polling mini-slot at the end of the frame, long
+// enough for one packet, so a UE whose traffic starts between two frames is
+// heard without waiting for the next demand report. Idle downlinks need no
+// poll: their queue sits at the BS.
+class TdmaLoadPolicy : public TdmaDemandPolicy {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::TdmaLoadPolicy")
+            .SetParent<TdmaDemandPolicy>()
+            .SetGroupName("Tdma")
+            .AddConstructor<TdmaLoadPolicy>()
+            .AddAttribute("PacketsPerSlot",
+                          "Packets that fit in the transmit window of a full slot",
+                          UintegerValue(10),
+                          MakeUintegerAccessor(&TdmaLoadPolicy::m_packetsPerSlot),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("PollSlot",
+                          "Duration of the polling mini-slot of an idle uplink, 0 for one packet",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&TdmaLoadPolicy::m_pollSlot),
+                          MakeTimeChecker());
+        return tid;
+    }
+
+    TdmaLoadPolicy() : m_packetsPerSlot(10) {}
+
+    void BuildFrame(const TdmaSlotScheduler& scheduler, const std::vector<uint32_t>& ues,
+                    std::vector<TdmaSlot>& frame) override {
+        NS_ASSERT_MSG(m_demand, "TdmaLoadPolicy needs a demand callback");
+        Time guard = scheduler.GetGuardTime();
+        Time packetTime = (scheduler.GetSlotDuration() - guard) / m_packetsPerSlot;
+        Time poll = m_pollSlot.IsStrictlyPositive() ? m_pollSlot : guard + packetTime;
+        NS_ASSERT_MSG(poll > guard, "Poll slot must be longer than the guard time");
+
+        m_idle.clear();
+        for (uint32_t ue : ues) {
+            for (TdmaDirection dir : {TDMA_UPLINK, TDMA_DOWNLINK}) {
+                uint32_t backlog = std::min(m_demand(ue, dir), m_packetsPerSlot);
+                if (backlog > 0) {
+                    frame.push_back({ue, scheduler.GetGroup(ue), dir, guard + packetTime * backlog});
+                } else if (dir == TDMA_UPLINK) {
+                    m_idle.push_back(ue);
+                }
+            }
+        }
+        for (uint32_t ue : m_idle) {
+            frame.push_back({ue, scheduler.GetGroup(ue), TDMA_UPLINK, poll});
+        }
+    }
+
+private:
+    uint32_t m_packetsPerSlot;
+    Time m_pollSlot;
+    std::vector<uint32_t> m_idle;
+};
+
+// Backlog of a source with Poisson packet arrivals. Arrivals are drawn when
+// the backlog is read, so a source costs no events between its slots.
+// Packets arriving at a full queue are dropped.
+class TdmaOfferedLoad {
+public:
+    TdmaOfferedLoad()
+        : m_arrivals(CreateObject<ExponentialRandomVariable>()),
+          m_saturated(true),
+          m_limit(0),
+          m_queued(0),
+          m_dropped(0) {}
+
+    // Fixes the stream of the arrival process; call before SetRate() so the
+    // first arrival is drawn from it too. Returns the number of streams used.
+    int64_t AssignStreams(int64_t stream) {
+        m_arrivals->SetStream(stream);
+        return 1;
+    }
+
+    // packetsPerSecond <= 0 leaves the source saturated
+    void SetRate(double packetsPerSecond, uint32_t queueLimit) {
+        m_limit = queueLimit;
+        m_queued = 0;
+        m_saturated = packetsPerSecond <= 0;
+        if (!m_saturated) {
+            m_arrivals->SetAttribute("Mean", DoubleValue(1.0 / packetsPerSecond));
+            m_next = Simulator::Now() + Seconds(m_arrivals->GetValue());
+        }
+    }
+
+    bool IsSaturated(void) const { return m_saturated; }
+
+    uint32_t GetBacklog(void) {
+        Time now = Simulator::Now();
+        while (!m_saturated && m_next <= now) {
+            if (m_queued < m_limit) {
+                m_queued++;
+            } else {
+                m_dropped++;
+            }
+            m_next += Seconds(m_arrivals->GetValue());
+        }
+        return m_queued;
+    }
+
+    void Remove(uint32_t packets) { m_queued -= std::min(packets, m_queued); }
+    uint64_t GetDropped(void) const { return m_dropped; }
+
+private:
+    Ptr<ExponentialRandomVariable> m_arrivals;
+    bool m_saturated;
+    Time m_next;
+    uint32_t m_limit;
+    uint32_t m_queued;
+    uint64_t m_dropped;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(TdmaSlotScheduler);
+NS_OBJECT_ENSURE_REGISTERED(TdmaRoundRobinPolicy);
+NS_OBJECT_ENSURE_REGISTERED(TdmaWeightedPolicy);
+NS_OBJECT_ENSURE_REGISTERED(TdmaDemandPolicy);
+NS_OBJECT_ENSURE_REGISTERED(TdmaLoadPolicy);
+
+} // namespace ns3
+
+#endif // TDMA_SLOT_SCHEDULER_H
@@ -17,14 +17,67 @@
 #include "ns3/point-to-point-module.h"
 #include "ns3/three-gpp-propagation-loss-model.h"
 
+#include "adaptive-tdd-controller.h"
+#include "bearer-provisioning.h"
+#include "cached-beamforming.h"
+#include "cached-propagation-loss.h"
+#include "event-log.h"
+#include "nr-pdcp-traces.h"
+#include "nr-tti-timeline.h"
+#include "parallel-beamforming.h"
+#include "profiling-simulator-impl.h"
+#include "scheduler-report.h"
+
 using namespace ns3; // imports ns-3 namespace
 
 NS_LOG_COMPONENT_DEFINE("3gppChannelFdmComponentCarriersBandwidthPartsExample"); //defines a logging component in NS-3 for debugging and tracking simulation events.
+
+// Binary event log (--eventLog), decoded after the run with event-log-decode
+static EventLog g_eventLog;
+static uint16_t g_evUdpTx;
+static uint16_t g_evSinkRx;
+static uint16_t g_evPdcpTx;
+static uint16_t g_evPdcpRx;
+static uint16_t g_evRsrpSinr;
+
+static void UdpClientTx(uint32_t node, Ptr<const Packet> packet)
+{
+    g_eventLog.Log<EVLOG_INFO>(g_evUdpTx, node, packet->GetSize());
+}
+
+static void PacketSinkRx(uint32_t node, Ptr<const Packet> packet, const Address& from)
+{
+    g_eventLog.Log<EVLOG_INFO>(g_evSinkRx, node, packet->GetSize());
+}
+
+static void PdcpTxPdu(std::string context, uint16_t rnti, uint8_t lcid, uint32_t size)
+{
+    g_eventLog.Log<EVLOG_INFO>(g_evPdcpTx, NodeOfContext(context), rnti, size);
+}
+
+static void PdcpRxPdu(std::string context, uint16_t rnti, uint8_t lcid, uint32_t size, uint64_t delay)
+{
+    g_eventLog.Log<EVLOG_INFO>(g_evPdcpRx, NodeOfContext(context), size, delay / 1e6);
+}
+
+static void UeRsrpSinr(uint32_t node, uint16_t cellId, uint16_t rnti, double rsrp, double sinr, uint16_t bwpId)
+{
+    g_eventLog.Log<EVLOG_INFO>(g_evRsrpSinr, node, rsrp, sinr);
+}
+
+// The DRBs, and their PDCP entities, only exist once the bearers are set up
+static void ConnectPdcpEventLog()
+{
+    ConnectNrPdcpTrace("TxPDU", MakeCallback(&PdcpTxPdu));
+    ConnectNrPdcpTrace("RxPDU", MakeCallback(&PdcpRxPdu));
+}
+
 int main(int argc, char* argv[])
 {
     uint16_t gNbNum = 1; // no of base stations
     uint16_t ueNumPergNb = 10;
     uint16_t numFlowsUe = 3;
+    std::string bearerRules = "";  // "ues:ports:qci;..." rules, empty for one QCI per flow
     uint8_t numBands = 1;
     double centralFrequencyBand = 28e9;
     double bandwidthBand = 400e6;  // Reduce bandwidth to 400 MHz for realism
@@ -32,10 +85,19 @@ int main(int argc, char* argv[])
     bool contiguousCc = true;// Use contiguous component carriers (simpler setup)
     uint16_t numerology = 0;
 
-    std::string pattern = "UL|DL|UL|DL|UL|DL|UL|DL|UL|DL|";
+    std::string pattern = "";  // TDD pattern of the gNBs, empty for the NrGnbPhy default
+    bool adaptiveTdd = false;  // Switch among tddPatterns following the UL/DL backlog
+    std::string tddPatterns = "DL|DL|F|UL|DL|DL|DL|DL|F|UL|;DL|DL|F|UL|DL|F|UL|UL|DL|UL|;DL|DL|F|UL|UL|F|UL|UL|UL|UL|";
     double totalTxPower = 8;
     bool cellScan = true;  // Enable scanning for better beamforming
     double beamSearchAngleStep = 5.0;  // Finer beam search for mmWave
+    bool beamCache = true;  // Refine cached beams locally while UEs move little
+    double beamCacheThreshold = 2.0;  // meters
+    uint32_t beamCoarseFactor = 4;  // coarse step multiplier of the local refinement
+    bool parallelBeams = false;  // Sweep the beams of all links at once on a thread pool
+    uint32_t beamThreads = 0;  // 0 = one per hardware thread
+    bool verifyBeams = false;  // Check the parallel beams against CellScanBeamforming
+    bool staticLossTable = true;  // Serve the static 3GPP pathloss from a table
 
     bool udpFullBuffer = false; //Full Buffer Traffic
     uint32_t udpPacketSizeUll = 128;  // Slightly increased for practical scenarios
@@ -43,11 +105,18 @@ int main(int argc, char* argv[])
     uint32_t lambdaUll = 5000;  // Reduce to prevent excessive queuing
     uint32_t lambdaBe = 1500;   // Slightly increased BE traffic
 
-    bool logging = true;
+    bool logging = false;  // Text logging of the channel, UDP and PDCP components (slow)
+    bool eventLog = true;  // Binary event log of the UDP apps, PDCP and UE PHY
+    bool ttiTimeline = true;  // Record scheduled/delivered bytes per TTI, UE and BWP
+    double ttiWindow = 0.1;  // seconds per aggregation window of the timeline
 
     bool disableDl = false;
     bool disableUl = false;
 
+    std::string schedulerType = "ns3::NrMacSchedulerTdmaRR";
+    std::string schedulerReport = "";  // JSON summary for compare-schedulers.py, empty for none
+    bool profileEvents = false;
+
     std::string simTag = "TDMA_5G";
     std::string outputDir = "./results/";
 
@@ -64,29 +133,54 @@ int main(int argc, char* argv[])
     cmd.AddValue("bandwidthBand", "The system bandwidth to be used in band 1", bandwidthBand);
     cmd.AddValue("contiguousCc","Simulate with contiguous CC or non-contiguous CC example",contiguousCc);
     cmd.AddValue("numerology", "Numerlogy to be used in contiguous case", numerology);
-    cmd.AddValue("tddPattern","LTE TDD pattern to use",pattern);
+    cmd.AddValue("tddPattern","TDD pattern of the gNBs, e.g. DL|DL|F|UL|UL|, empty for the NrGnbPhy default",pattern);
+    cmd.AddValue("adaptiveTdd","Switch the TDD pattern every frame among tddPatterns to follow the UL/DL backlog",adaptiveTdd);
+    cmd.AddValue("tddPatterns","Candidate TDD patterns of adaptiveTdd, separated by ';'",tddPatterns);
     cmd.AddValue("totalTxPower","total tx power that will be proportionally assigned to bandwidth parts depending on each BWP bandwidth ",totalTxPower);
     cmd.AddValue("cellScan","Use beam search method to determine beamforming vector,""true to use cell scanning method",cellScan);
     cmd.AddValue("beamSearchAngleStep","Beam search angle step for beam search method",beamSearchAngleStep);
+    cmd.AddValue("beamCache","Cache cell scan beams per link, refine them locally and only sweep exhaustively after the UE moved",beamCache);
+    cmd.AddValue("beamCacheThreshold","Distance in meters a UE has to move before its beams are swept exhaustively again",beamCacheThreshold);
+    cmd.AddValue("parallelBeams","Search the beams of all links in one multithreaded batch (deterministic for any thread count)",parallelBeams);
+    cmd.AddValue("beamThreads","Worker threads of the parallel beam search, 0 for one per hardware thread",beamThreads);
+    cmd.AddValue("staticLossTable","Serve the 3GPP pathloss of the static, always-LOS topology from a precomputed table",staticLossTable);
+    cmd.AddValue("verifyBeams","Abort if the parallel beam search picks other beams than CellScanBeamforming (slow)",verifyBeams);
+    cmd.AddValue("beamCoarseFactor","Angle step multiplier of the coarse pass of the local beam refinement",beamCoarseFactor);
     cmd.AddValue("udpFullBuffer","Whether to set the full buffer traffic; if this parameter is set then the udpInterval neglected.",udpFullBuffer);
     cmd.AddValue("packetSizeUll","packet size in bytes to be used by ultra low latency traffic",udpPacketSizeUll);
     cmd.AddValue("packetSizeBe","packet size in bytes to be used by best effort traffic",udpPacketSizeBe);
     cmd.AddValue("lambdaUll","Number of UDP packets in one second for ultra low latency traffic",lambdaUll);
     cmd.AddValue("lambdaBe","Number of UDP packets in one second for best effort traffic",lambdaBe);
-    cmd.AddValue("logging", "Enable logging", logging);
+    cmd.AddValue("logging", "Enable text logging of ThreeGppPropagationLossModel, UdpClient, UdpServer and NrPdcp", logging);
+    cmd.AddValue("eventLog","Write a binary event log to <outputDir>/events-<simTag>.evlog (decode with event-log-decode)",eventLog);
+    cmd.AddValue("ttiTimeline","Record the bytes scheduled and delivered per TTI, UE and BWP",ttiTimeline);
+    cmd.AddValue("ttiWindow","Width in seconds of the windows the TTI timeline is aggregated into",ttiWindow);
+    cmd.AddValue("numFlowsUe", "Number of UDP flows per UE and direction", numFlowsUe);
+    cmd.AddValue("bearerRules","Dedicated bearer rules \"ueFirst-ueLast:portFirst-portLast:qci;...\" (flow f uses port 1234+f), empty for one QCI per flow",bearerRules);
     cmd.AddValue("disableDl", "Disable DL flow", disableDl);
     cmd.AddValue("disableUl", "Disable UL flow", disableUl);
+    cmd.AddValue("schedulerType","TypeId of the NR MAC scheduler, e.g. ns3::NrMacSchedulerOfdmaPF",schedulerType);
+    cmd.AddValue("schedulerReport","Write cell/UE throughput, delay CDF and TTI count as JSON to this file",schedulerReport);
+    cmd.AddValue("profileEvents","Print wall time and event count per event target at the end of the run",profileEvents);
     cmd.AddValue("simTag","tag to be appended to output filenames to distinguish simulation campaigns",simTag);
     cmd.AddValue("outputDir", "directory where to store simulation results", outputDir);
 
     cmd.Parse(argc, argv);
 
+    if (profileEvents)
+    {
+        GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::ProfilingSimulatorImpl"));
+    }
+
     NS_ABORT_IF(numBands < 1);
     NS_ABORT_MSG_IF(disableDl == true && disableUl == true, "Enable one of the flows");
+    if (logging)
+    {
         LogComponentEnable("ThreeGppPropagationLossModel", LOG_LEVEL_ALL);
         LogComponentEnable("UdpClient", LOG_LEVEL_INFO);
         LogComponentEnable("UdpServer", LOG_LEVEL_INFO);
         LogComponentEnable("NrPdcp", LOG_LEVEL_INFO);
+    }
 
     Config::SetDefault("ns3::NrRlcUm::MaxTxBufferSize", UintegerValue(50000));
     // create base stations and mobile terminals
@@ -190,9 +284,26 @@ int main(int argc, char* argv[])
     channelHelper->SetPathlossAttribute("ShadowingEnabled", BooleanValue(false)); //Disables shadow fading, meaning signals won’t experience random
     channelHelper->AssignChannelsToBands({band});//Assigns the operation band to the configured channel.
     nrEpcHelper->SetAttribute("S1uLinkDelay", TimeValue(MilliSeconds(10)));
-    nrHelper->SetSchedulerTypeId(TypeId::LookupByName("ns3::NrMacSchedulerTdmaRR"));//This sets the TDMA Round Robin (TDMA-RR) scheduler.
+    nrHelper->SetSchedulerTypeId(TypeId::LookupByName(schedulerType));//TDMA Round Robin (TDMA-RR) unless --schedulerType says otherwise.
     // Beamforming method
-    if (cellScan)
+    Ptr<ParallelBeamSweep> beamSweep;
+    if (cellScan && parallelBeams)
+    {
+        beamSweep = CreateObject<ParallelBeamSweep>();
+        beamSweep->SetAttribute("Threads", UintegerValue(beamThreads));
+        beamSweep->SetAttribute("BeamSearchAngleStep", DoubleValue(beamSearchAngleStep));
+        beamSweep->SetAttribute("Verify", BooleanValue(verifyBeams));
+        idealBeamformingHelper->SetAttribute("BeamformingMethod",TypeIdValue(ParallelCellScanBeamforming::GetTypeId()));
+        idealBeamformingHelper->SetBeamformingAlgorithmAttribute("Sweep",PointerValue(beamSweep));
+    }
+    else if (cellScan && beamCache)
+    {
+        idealBeamformingHelper->SetAttribute("BeamformingMethod",TypeIdValue(CachedCellScanBeamforming::GetTypeId()));
+        idealBeamformingHelper->SetBeamformingAlgorithmAttribute("BeamSearchAngleStep",DoubleValue(beamSearchAngleStep));
+        idealBeamformingHelper->SetBeamformingAlgorithmAttribute("MovementThreshold",DoubleValue(beamCacheThreshold));
+        idealBeamformingHelper->SetBeamformingAlgorithmAttribute("CoarseFactor",UintegerValue(beamCoarseFactor));
+    }
+    else if (cellScan)
     {
         idealBeamformingHelper->SetAttribute("BeamformingMethod",TypeIdValue(CellScanBeamforming::GetTypeId()));
         idealBeamformingHelper->SetBeamformingAlgorithmAttribute("BeamSearchAngleStep",DoubleValue(beamSearchAngleStep));
@@ -202,6 +313,16 @@ int main(int argc, char* argv[])
         idealBeamformingHelper->SetAttribute("BeamformingMethod",TypeIdValue(DirectPathBeamforming::GetTypeId()));
     }
     allBwps = CcBwpCreator::GetAllBwps({band});
+    if (staticLossTable)
+    {
+        // Nodes do not move, the UMi scenario is always LOS and shadowing is
+        // off, so the pathloss of a pair never changes
+        NodeContainer allNodes(gNbNodes, ueNodes);
+        for (const auto& bwp : allBwps)
+        {
+            CacheSpectrumChannelLoss(bwp.get()->m_channel)->Precompute(allNodes);
+        }
+    }
     double x = pow(10, totalTxPower / 10);
     nrHelper->SetUeAntennaAttribute("NumRows", UintegerValue(2));
     nrHelper->SetUeAntennaAttribute("NumColumns", UintegerValue(4));
@@ -214,6 +335,15 @@ int main(int argc, char* argv[])
     nrHelper->SetGnbBwpManagerAlgorithmAttribute("GBR_CONV_VOICE", UintegerValue(bwpIdForAllUsers));
     nrHelper->SetGnbBwpManagerAlgorithmAttribute("NGBR_VIDEO_TCP_PREMIUM",UintegerValue(bwpIdForAllUsers));
     nrHelper->SetGnbBwpManagerAlgorithmAttribute("NGBR_VOICE_VIDEO_GAMING",UintegerValue(bwpIdForAllUsers));
+    if (adaptiveTdd && pattern.empty())
+    {
+        // The controller only switches among patterns sharing their first slots
+        pattern = tddPatterns.substr(0, tddPatterns.find(';'));
+    }
+    if (!pattern.empty())
+    {
+        nrHelper->SetGnbPhyAttribute("Pattern", StringValue(pattern));
+    }
     NetDeviceContainer gnbNetDev = nrHelper->InstallGnbDevice(gNbNodes, allBwps);
     NetDeviceContainer ueNetDev = nrHelper->InstallUeDevice(ueNodes, allBwps);
 
@@ -256,108 +386,150 @@ int main(int argc, char* argv[])
     }
 
     // attach UEs to the closest gNB before creating the dedicated flows
-    nrHelper->AttachToClosestGnb(ueNetDev, gnbNetDev);
+    if (beamSweep)
+    {
+        // Register every link first so the initial beams come from one parallel batch
+        std::vector<Ptr<NetDevice>> servingGnb;
+        for (uint32_t u = 0; u < ueNetDev.GetN(); ++u)
+        {
+            Ptr<MobilityModel> ueMobility = ueNetDev.Get(u)->GetNode()->GetObject<MobilityModel>();
+            Ptr<NetDevice> closest = gnbNetDev.Get(0);
+            for (uint32_t g = 1; g < gnbNetDev.GetN(); ++g)
+            {
+                if (gnbNetDev.Get(g)->GetNode()->GetObject<MobilityModel>()->GetDistanceFrom(ueMobility) <
+                    closest->GetNode()->GetObject<MobilityModel>()->GetDistanceFrom(ueMobility))
+                {
+                    closest = gnbNetDev.Get(g);
+                }
+            }
+            beamSweep->AddLink(closest, ueNetDev.Get(u));
+            servingGnb.push_back(closest);
+        }
+        beamSweep->Compute();
+        for (uint32_t u = 0; u < ueNetDev.GetN(); ++u)
+        {
+            nrHelper->AttachToGnb(ueNetDev.Get(u), servingGnb[u]);
+        }
+    }
+    else
+    {
+        nrHelper->AttachToClosestGnb(ueNetDev, gnbNetDev);
+    }
+
+    Ptr<AdaptiveTddController> tddController;
+    if (adaptiveTdd)
+    {
+        tddController = CreateObject<AdaptiveTddController>();
+        tddController->SetAttribute("Patterns", StringValue(tddPatterns));
+        tddController->Install(gnbNetDev, ueNetDev);
+        tddController->Start(Seconds(udpAppStartTime));
+    }
+
+    Ptr<NrTtiTimeline> timeline;
+    if (ttiTimeline)
+    {
+        timeline = CreateObject<NrTtiTimeline>();
+        timeline->Install(gnbNetDev, ueNetDev);
+    }
 
-    // install UDP applications
+    // install UDP applications. Flow f of every UE uses port dlPort + f in
+    // both directions: the DL sink on the UE and the UL sink on the remote
+    // host, which serves that flow for all UEs.
     uint16_t dlPort = 1234;
-    uint16_t ulPort = dlPort + gNbNum * ueNumPergNb * numFlowsUe + 1;
     ApplicationContainer clientApps;
     ApplicationContainer serverApps;
 
-    for (uint32_t u = 0; u < ueNodes.GetN(); ++u)
+    for (uint16_t flow = 0; flow < numFlowsUe; ++flow)
     {
-        for (uint16_t flow = 0; flow < numFlowsUe; ++flow)
+        uint16_t port = dlPort + flow;
+        if (!disableUl)
+        {
+            PacketSinkHelper ulPacketSinkHelper("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), port));
+            serverApps.Add(ulPacketSinkHelper.Install(remoteHost));
+        }
+        for (uint32_t u = 0; u < ueNodes.GetN(); ++u)
         {
             if (!disableDl)
             {
-                PacketSinkHelper dlPacketSinkHelper(
-                    "ns3::UdpSocketFactory",
-                    InetSocketAddress(Ipv4Address::GetAny(), dlPort));
+                PacketSinkHelper dlPacketSinkHelper("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), port));
                 serverApps.Add(dlPacketSinkHelper.Install(ueNodes.Get(u)));
 
-                UdpClientHelper dlClient(ueIpIface.GetAddress(u), dlPort);
+                UdpClientHelper dlClient(ueIpIface.GetAddress(u), port);
                 dlClient.SetAttribute("PacketSize", UintegerValue(udpPacketSizeBe));
                 dlClient.SetAttribute("Interval", TimeValue(Seconds(1.0 / lambdaUll)));
                 dlClient.SetAttribute("MaxPackets", UintegerValue(0xFFFFFFFF));
                 clientApps.Add(dlClient.Install(remoteHost));
-
-                Ptr<NrEpcTft> tft = Create<NrEpcTft>();
-                NrEpcTft::PacketFilter dlpf;
-                dlpf.localPortStart = dlPort;
-                dlpf.localPortEnd = dlPort;
-                ++dlPort;
-                tft->Add(dlpf);
-
-                enum NrEpsBearer::Qci q;
-                if (flow == 0)
-                {
-                    q = NrEpsBearer::NGBR_LOW_LAT_EMBB;
-                }
-                else if (flow == 1)
-                {
-                    q = NrEpsBearer::GBR_CONV_VOICE;
-                }
-                else if (flow == 2)
-                {
-                    q = NrEpsBearer::NGBR_VIDEO_TCP_PREMIUM;
-                }
-                else if (flow == 3)
-                {
-                    q = NrEpsBearer::NGBR_VOICE_VIDEO_GAMING;
-                }
-                else
-                {
-                    q = NrEpsBearer::NGBR_VIDEO_TCP_DEFAULT;
-                }
-                NrEpsBearer bearer(q);
-                nrHelper->ActivateDedicatedEpsBearer(ueNetDev.Get(u), bearer, tft);
             }
-
             if (!disableUl)
             {
-                PacketSinkHelper ulPacketSinkHelper(
-                    "ns3::UdpSocketFactory",
-                    InetSocketAddress(Ipv4Address::GetAny(), ulPort));
-                serverApps.Add(ulPacketSinkHelper.Install(remoteHost));
-
-                UdpClientHelper ulClient(remoteHostAddr, ulPort);
+                UdpClientHelper ulClient(remoteHostAddr, port);
                 ulClient.SetAttribute("PacketSize", UintegerValue(udpPacketSizeBe));
                 ulClient.SetAttribute("Interval", TimeValue(Seconds(1.2 / lambdaUll)));
                 ulClient.SetAttribute("MaxPackets", UintegerValue(0xFFFFFFFF));
                 clientApps.Add(ulClient.Install(ueNodes.Get(u)));
+            }
+        }
+    }
 
-                Ptr<NrEpcTft> tft = Create<NrEpcTft>();
-                NrEpcTft::PacketFilter ulpf;
-                ulpf.remotePortStart = ulPort;
-                ulpf.remotePortEnd = ulPort;
-                ++ulPort;
-                tft->Add(ulpf);
+    // Dedicated bearers: one per UE and QCI, TFTs shared between UEs
+    NrBearerProvisioner bearers;
+    NrEpcTft::Direction direction = disableDl ? NrEpcTft::UPLINK : disableUl ? NrEpcTft::DOWNLINK : NrEpcTft::BIDIRECTIONAL;
+    if (bearerRules.empty())
+    {
+        // Flows 0-3 each get their own QCI, the remaining flows share the default one
+        const NrEpsBearer::Qci flowQci[] = {NrEpsBearer::NGBR_LOW_LAT_EMBB, NrEpsBearer::GBR_CONV_VOICE, NrEpsBearer::NGBR_VIDEO_TCP_PREMIUM, NrEpsBearer::NGBR_VOICE_VIDEO_GAMING};
+        uint32_t lastUe = ueNodes.GetN() - 1;
+        for (uint16_t flow = 0; flow < numFlowsUe && flow < 4; ++flow)
+        {
+            bearers.AddRule(0, lastUe, dlPort + flow, dlPort + flow, flowQci[flow], direction);
+        }
+        if (numFlowsUe > 4)
+        {
+            bearers.AddRule(0, lastUe, dlPort + 4, dlPort + numFlowsUe - 1, NrEpsBearer::NGBR_VIDEO_TCP_DEFAULT, direction);
+        }
+    }
+    else
+    {
+        bearers.AddRules(bearerRules, direction);
+    }
+    uint32_t nBearers = bearers.Activate(nrHelper, ueNetDev);
+    if (logging)
+    {
+        std::cout << "Activated " << nBearers << " dedicated bearers from " << bearers.GetNRules() << " rules, " << bearers.GetNTfts() << " TFTs" << std::endl;
+    }
 
-                enum NrEpsBearer::Qci q;
-                if (flow == 0)
-                {
-                    q = NrEpsBearer::NGBR_LOW_LAT_EMBB;
-                }
-                else if (flow == 1)
-                {
-                    q = NrEpsBearer::GBR_CONV_VOICE;
-                }
-                else if (flow == 2)
-                {
-                    q = NrEpsBearer::NGBR_VIDEO_TCP_PREMIUM;
-                }
-                else if (flow == 3)
-                {
-                    q = NrEpsBearer::NGBR_VOICE_VIDEO_GAMING;
-                }
-                else{
-                    q = NrEpsBearer::NGBR_VIDEO_TCP_DEFAULT;
-                }
-                NrEpsBearer bearer(q);
-                nrHelper->ActivateDedicatedEpsBearer(ueNetDev.Get(u), bearer, tft);
+    if (eventLog)
+    {
+        g_evUdpTx = g_eventLog.Register("UdpClient", "Tx", "bytes");
+        g_evSinkRx = g_eventLog.Register("PacketSink", "Rx", "bytes");
+        g_evPdcpTx = g_eventLog.Register("NrPdcp", "TxPDU", "rnti", "bytes");
+        g_evPdcpRx = g_eventLog.Register("NrPdcp", "RxPDU", "bytes", "delay_ms");
+        g_evRsrpSinr = g_eventLog.Register("NrUePhy", "RsrpSinr", "rsrp", "sinr");
+        std::string eventLogFile = outputDir + "events-" + simTag + ".evlog";
+        NS_ABORT_MSG_IF(!g_eventLog.Open(eventLogFile), "Cannot open " << eventLogFile);
+
+        for (uint32_t a = 0; a < clientApps.GetN(); ++a)
+        {
+            clientApps.Get(a)->TraceConnectWithoutContext(
+                "Tx", MakeBoundCallback(&UdpClientTx, clientApps.Get(a)->GetNode()->GetId()));
+        }
+        for (uint32_t a = 0; a < serverApps.GetN(); ++a)
+        {
+            serverApps.Get(a)->TraceConnectWithoutContext(
+                "Rx", MakeBoundCallback(&PacketSinkRx, serverApps.Get(a)->GetNode()->GetId()));
+        }
+        for (uint32_t u = 0; u < ueNetDev.GetN(); ++u)
+        {
+            Ptr<NrUeNetDevice> ueDev = DynamicCast<NrUeNetDevice>(ueNetDev.Get(u));
+            for (uint32_t bwp = 0; bwp < ueDev->GetCcMapSize(); ++bwp)
+            {
+                ueDev->GetPhy(bwp)->TraceConnectWithoutContext(
+                    "ReportCurrentCellRsrpSinr", MakeBoundCallback(&UeRsrpSinr, ueDev->GetNode()->GetId()));
             }
         }
+        Simulator::Schedule(Seconds(udpAppStartTime), &ConnectPdcpEventLog);
     }
+
     serverApps.Start(Seconds(udpAppStartTime));
     clientApps.Start(Seconds(udpAppStartTime));
     serverApps.Stop(Seconds(simTime));
@@ -372,12 +544,12 @@ int main(int argc, char* argv[])
     monitor->SetAttribute("PacketSizeBinWidth", DoubleValue(20));
     Simulator::Stop(Seconds(simTime));
     Simulator::Run();
+    std::cout << "Executed events: " << Simulator::GetEventCount() << std::endl;
     monitor->CheckForLostPackets();
     Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmonHelper.GetClassifier());
     FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats();
     double averageFlowThroughput = 0.0;
     double averageFlowDelay = 0.0;
-    int numSlots = 10;
     std::ofstream outFile;
     std::string filename = "results/outputs.txt";
     outFile.open(filename.c_str(), std::ofstream::out | std::ofstream::app);
@@ -415,14 +587,8 @@ int main(int argc, char* argv[])
             double rxDuration = (simTime - udpAppStartTime);
             averageFlowThroughput += i->second.rxBytes * 8.0 / rxDuration / 1000 / 1000;
             averageFlowDelay += 1000 * i->second.delaySum.GetSeconds() / i->second.rxPackets;
-            double slotDuration = rxDuration / numSlots;
-            for (int slot = 0; slot < numSlots; slot++)
-            {
-                double slotThroughput = i->second.rxBytes * 8.0 / slotDuration / 1000 / 1000;
-                std::cout<< "  TDMA Slot " << slot + 1 << " Throughput: " << slotThroughput << " Mbps\n";
-            }
-            double slotDelay = (i->second.rxPackets > 0) ? (1000 * i->second.delaySum.GetSeconds()) / i->second.rxPackets : 0;
-            std::cout<< "  TDMA Slot Mean Delay: " << slotDelay << " ms\n";
+            std::cout<< "  Throughput: " << i->second.rxBytes * 8.0 / rxDuration / 1000 / 1000 << " Mbps\n";
+            std::cout<< "  Mean delay:  " << 1000 * i->second.delaySum.GetSeconds() / i->second.rxPackets << " ms\n";
             std::cout<< "  Mean jitter:  "
                     << 1000 * i->second.jitterSum.GetSeconds() / i->second.rxPackets << " ms\n";
         }
@@ -437,7 +603,25 @@ int main(int argc, char* argv[])
 
     std::cout<< "\n\n  Mean flow throughput: " << averageFlowThroughput / stats.size() << "\n";
     std::cout<< "  Mean flow delay: " << averageFlowDelay / stats.size() << "\n";
-    std::cout<< "\n  Total TDMA Slots Used: " << numSlots << "\n";
+    if (tddController)
+    {
+        std::cout<< "  TDD pattern switches: " << tddController->GetNSwitches() << "\n";
+    }
+
+    if (!schedulerReport.empty() &&
+        !WriteSchedulerReport(schedulerReport, schedulerType, monitor, classifier, ueIpIface, gnbNetDev, Seconds(simTime - udpAppStartTime)))
+    {
+        std::cerr << "Can't open file " << schedulerReport << std::endl;
+    }
+
+    if (timeline)
+    {
+        std::string timelineFile = outputDir + "tti-timeline-" + simTag + ".csv";
+        std::ofstream csv(timelineFile.c_str());
+        std::cout << "\n";
+        timeline->Write(Seconds(ttiWindow), csv, std::cout);
+        std::cout << "Per-UE TTI timeline written to " << timelineFile << std::endl;
+    }
 
     outFile.close();
 
@@ -447,6 +631,11 @@ int main(int argc, char* argv[])
     {
         std::cout << f.rdbuf();
     }
+    if (g_eventLog.IsOpen())
+    {
+        std::cout << "Event log: " << g_eventLog.GetNRecords() << " records" << std::endl;
+        g_eventLog.Close();
+    }
     Simulator::Stop(Seconds(simTime));
     Simulator::Destroy();
     return 0;
@@ -6,6 +6,10 @@
 #include "ns3/applications-module.h"
 #include "ns3/flow-monitor-module.h"
 
+#include "cached-propagation-loss.h"
+#include "duty-cycled-udp-client.h"
+#include "tdma-net-device.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("TdmaRoundRobinSim");
@@ -16,46 +20,82 @@ const double kSimDuration = 10.0; // seconds
 const uint32_t kPacketSize = 1024;
 const std::string kDataRate = "2Mbps";
 
-void ScheduleUeTraffic(Ptr<Application> app, double startTime, double duration) {
-    app->SetStartTime(Seconds(startTime));
-    app->SetStopTime(Seconds(startTime + duration));
-}
-
 int main(int argc, char *argv[]) {
+    uint32_t numUes = kNumUes;
+    double simDuration = kSimDuration;
+    bool staticLossTable = true;
+    bool useTdmaMac = false;
+
     CommandLine cmd;
+    cmd.AddValue("numUes", "Number of UE nodes", numUes);
+    cmd.AddValue("simDuration", "Total simulation duration (seconds)", simDuration);
+    cmd.AddValue("staticLossTable", "Serve the (static) propagation loss from a precomputed table", staticLossTable);
+    cmd.AddValue("useTdmaMac", "Use the contention-free TDMA MAC instead of 802.11g", useTdmaMac);
     cmd.Parse(argc, argv);
 
     NodeContainer bsNode, ueNodes;
     bsNode.Create(1);
-    ueNodes.Create(kNumUes);
-
-    // Configure WiFi channel
-    YansWifiChannelHelper channel = YansWifiChannelHelper::Default();
-    YansWifiPhyHelper phy;
-    phy.SetChannel(channel.Create());
-    phy.SetChannel(channel.Create());
+    ueNodes.Create(numUes);
+
+    NetDeviceContainer ueDevices, bsDevice;
+    Ptr<TdmaSlotScheduler> slotScheduler;
+    Ptr<CachedPropagationLossModel> lossTable;  // filled once mobility is installed
+    if (useTdmaMac) {
+        // Native TDMA MAC on the slot layout of the clients below: one uplink
+        // slot per UE, in UE order, and no downlink slots (the BS only receives)
+        slotScheduler = CreateObject<TdmaSlotScheduler>();
+        slotScheduler->SetAttribute("SlotDuration", TimeValue(Seconds(kSlotDuration)));
+        slotScheduler->SetAttribute("GuardTime", TimeValue(Seconds(0.0)));
+        Ptr<TdmaWeightedPolicy> policy = CreateObject<TdmaWeightedPolicy>();
+        policy->SetAttribute("DownlinkWeight", DoubleValue(0.0));
+        slotScheduler->SetPolicy(policy);
+
+        TdmaHelper tdma;
+        tdma.SetDeviceAttribute("DataRate", DataRateValue(DataRate("11Mbps")));
+        Ptr<TdmaChannel> tdmaChannel = tdma.CreateChannel();
+
+        ueDevices = tdma.Install(ueNodes, tdmaChannel);
+        bsDevice = tdma.Install(bsNode, tdmaChannel);
+        for (uint32_t i = 0; i < numUes; ++i) {
+            slotScheduler->AddUe(0);
+            tdma.AssignSlot(ueDevices.Get(i), slotScheduler, i, TDMA_UPLINK);
+        }
+    } else {
+        // Configure WiFi channel
+        YansWifiChannelHelper channel = YansWifiChannelHelper::Default();
+        YansWifiPhyHelper phy;
+        if (staticLossTable) {
+            lossTable = CreateObject<CachedPropagationLossModel>();
+            phy.SetChannel(CreateStaticWifiChannel(lossTable));
+        } else {
+            phy.SetChannel(channel.Create());
+        }
 
-    WifiHelper wifi;
-    wifi.SetStandard(WIFI_STANDARD_80211g);
-    WifiMacHelper mac;
+        WifiHelper wifi;
+        wifi.SetStandard(WIFI_STANDARD_80211g);
+        WifiMacHelper mac;
 
-    Ssid ssid = Ssid("tdma-ssid");
+        Ssid ssid = Ssid("tdma-ssid");
 
-    mac.SetType("ns3::StaWifiMac",
-                "Ssid", SsidValue(ssid),
-                "ActiveProbing", BooleanValue(false));
+        mac.SetType("ns3::StaWifiMac",
+                    "Ssid", SsidValue(ssid),
+                    "ActiveProbing", BooleanValue(false));
 
-    NetDeviceContainer ueDevices = wifi.Install(phy, mac, ueNodes);
+        ueDevices = wifi.Install(phy, mac, ueNodes);
 
-    mac.SetType("ns3::ApWifiMac",
-                "Ssid", SsidValue(ssid));
-    NetDeviceContainer bsDevice = wifi.Install(phy, mac, bsNode);
+        mac.SetType("ns3::ApWifiMac",
+                    "Ssid", SsidValue(ssid));
+        bsDevice = wifi.Install(phy, mac, bsNode);
+    }
 
     // Mobility model
     MobilityHelper mobility;
     mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
     mobility.Install(bsNode);
     mobility.Install(ueNodes);
+    if (lossTable) {
+        lossTable->Precompute(NodeContainer(bsNode, ueNodes));
+    }
 
     // Install Internet stack
     InternetStackHelper internet;
@@ -68,38 +108,43 @@ int main(int argc, char *argv[]) {
     Ipv4InterfaceContainer bsInterface = ipv4.Assign(bsDevice);
     Ipv4InterfaceContainer ueInterfaces = ipv4.Assign(ueDevices);
 
+    if (useTdmaMac) {
+        TdmaHelper::PopulateNeighbours();
+    }
+
     // Create UDP server on base station
     uint16_t port = 5000;
     UdpServerHelper server(port);
     ApplicationContainer serverApps = server.Install(bsNode.Get(0));
     serverApps.Start(Seconds(0.0));
-    serverApps.Stop(Seconds(kSimDuration));
+    serverApps.Stop(Seconds(simDuration));
 
-    // Create UDP clients on each UE with TDMA slotting
+    // Create UDP clients on each UE with TDMA slotting: UE i only transmits
+    // in slot i of every round-robin cycle
     ApplicationContainer clientApps;
-    for (uint32_t i = 0; i < kNumUes; ++i) {
-        UdpClientHelper client(bsInterface.GetAddress(0), port);
+    for (uint32_t i = 0; i < numUes; ++i) {
+        DutyCycledUdpClientHelper client(bsInterface.GetAddress(0), port);
         client.SetAttribute("PacketSize", UintegerValue(kPacketSize));
         client.SetAttribute("MaxPackets", UintegerValue(100000));
         client.SetAttribute("Interval", TimeValue(Seconds(0.01)));
+        client.SetPeriodicWindows(Seconds(i * kSlotDuration), Seconds(kSlotDuration),
+                                  Seconds(kSlotDuration * numUes));
 
-        ApplicationContainer app = client.Install(ueNodes.Get(i));
-        clientApps.Add(app);
-
-        // Schedule UE traffic in round-robin fashion
-        double currentTime = i * kSlotDuration;
-        while (currentTime < kSimDuration) {
-            ScheduleUeTraffic(app.Get(0), currentTime, kSlotDuration);
-            currentTime += kSlotDuration * kNumUes;
-        }
+        clientApps.Add(client.Install(ueNodes.Get(i)));
+    }
+    clientApps.Start(Seconds(0.0));
+    clientApps.Stop(Seconds(simDuration));
+    if (slotScheduler) {
+        slotScheduler->Start(Seconds(0.0));
     }
 
     // Flow Monitor
     FlowMonitorHelper flowmon;
     Ptr<FlowMonitor> monitor = flowmon.InstallAll();
 
-    Simulator::Stop(Seconds(kSimDuration));
+    Simulator::Stop(Seconds(simDuration));
     Simulator::Run();
+    std::cout << "Executed events: " << Simulator::GetEventCount() << std::endl;
 
     // Output results
     Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
@@ -112,7 +157,7 @@ int main(int argc, char *argv[]) {
         auto t = classifier->FindFlow(flow.first);
         double delay = flow.second.delaySum.GetSeconds() / flow.second.rxPackets;
         double jitter = flow.second.jitterSum.GetSeconds() / flow.second.rxPackets;
-        double throughput = flow.second.rxBytes * 8.0 / kSimDuration;
+        double throughput = flow.second.rxBytes * 8.0 / simDuration;
         double lossRate = 100.0 * (flow.second.txPackets - flow.second.rxPackets) / flow.second.txPackets;
 
         outFile << flow.first << "," << t.sourceAddress << "," << t.destinationAddress << ","
@@ -8,63 +8,46 @@
 #include "ns3/config-store-module.h"
 #include "ns3/nr-module.h"
 #include<vector>
+
+#include "adaptive-tdd-controller.h"
+#include "flow-metrics-sampler.h"
+#include "grid-spectrum-channel.h"
+#include "profiling-simulator-impl.h"
+#include "scheduler-report.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("5GNR_TDMA_Simulation");
 
-// Function to write metrics to CSV
-void WriteMetricsToCSV(FlowMonitorHelper& flowMonHelper, Ptr<FlowMonitor> flowMon, std::ofstream& csvFile, Time interval, Time simTime) {
-  static uint32_t sampleCount = 0;
-  
-  // Collect metrics at the specified interval
-  Simulator::Schedule(interval, &WriteMetricsToCSV, std::ref(flowMonHelper), flowMon, std::ref(csvFile), interval, simTime);
-  
-  // Check if we've reached the end of simulation
-  if (Simulator::Now() >= simTime) {
-    return;
-  }
-  
-  // Get metrics from the flow monitor
-  flowMon->CheckForLostPackets();
-  Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowMonHelper.GetClassifier());
-  std::map<FlowId, FlowMonitor::FlowStats> stats = flowMon->GetFlowStats();
-  
-  for (auto it = stats.begin(); it != stats.end(); ++it) {
-    Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(it->first);
-    
-    // Calculate QoS metrics
-    double throughput = it->second.rxBytes * 8.0 / (interval.GetSeconds()) / 1000.0; // kbps
-    double jitter = it->second.jitterSum.GetSeconds() / it->second.rxPackets;
-    double delay = it->second.delaySum.GetSeconds() / it->second.rxPackets;
-    double packetLoss = 100.0 * (it->second.txPackets - it->second.rxPackets) / it->second.txPackets;
-    
-    // Write to CSV
-    csvFile << sampleCount << ","
-            << Simulator::Now().GetSeconds() << ","
-            << it->first << ","
-            << t.sourceAddress << ","
-            << t.destinationAddress << ","
-            << throughput << ","
-            << jitter << ","
-            << delay << ","
-            << packetLoss << std::endl;
-  }
-  
-  sampleCount++;
-}
-
 int main(int argc, char *argv[]) {
   // Simulation parameters
   uint16_t numUes = 10;
   double simTime = 10.0; // seconds
+  double appStartTime = 1.0; // seconds, start of the UE clients
   double interval = 0.5; // interval for collecting metrics in seconds
+  bool binaryMetrics = false;
+  std::string schedulerType = "ns3::NrMacSchedulerTdmaRR";
+  std::string schedulerReport = "";
+  bool profileEvents = false;
+  bool adaptiveTdd = false;
+  double cullRange = 0.0; // m, UE signals are not delivered farther than this (0: no culling)
   
   // Enable command-line arguments
   CommandLine cmd;
   cmd.AddValue("numUes", "Number of UE devices", numUes);
   cmd.AddValue("simTime", "Total simulation time", simTime);
   cmd.AddValue("interval", "Interval for collecting metrics", interval);
+  cmd.AddValue("binaryMetrics", "Write the metrics as binary records (see flow-metrics-to-csv)", binaryMetrics);
+  cmd.AddValue("schedulerType", "TypeId of the NR MAC scheduler, e.g. ns3::NrMacSchedulerOfdmaPF", schedulerType);
+  cmd.AddValue("schedulerReport", "Write cell/UE throughput, delay CDF and TTI count as JSON to this file", schedulerReport);
+  cmd.AddValue("profileEvents", "Print wall time and event count per event target at the end of the run", profileEvents);
+  cmd.AddValue("adaptiveTdd", "Switch the TDD pattern every frame to follow the UL/DL backlog", adaptiveTdd);
+  cmd.AddValue("cullRange", "Range (m) of UE transmissions on a grid-indexed channel, e.g. 150 (default 0: the plain NR channel)", cullRange);
   cmd.Parse(argc, argv);
+
+  if (profileEvents) {
+    GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::ProfilingSimulatorImpl"));
+  }
   
   // Set simulation time resolution
   Time::SetResolution(Time::NS);
@@ -79,8 +62,8 @@ int main(int argc, char *argv[]) {
   Ptr<NrPointToPointEpcHelper> epcHelper = CreateObject<NrPointToPointEpcHelper>();
   nrHelper->SetEpcHelper(epcHelper);
   
-  // Set scheduler to TDMA
-  nrHelper->SetSchedulerTypeId(TypeId::LookupByName("ns3::NrMacSchedulerTdmaRR"));
+  // TDMA round robin unless --schedulerType selects another scheduler
+  nrHelper->SetSchedulerTypeId(TypeId::LookupByName(schedulerType));
   
   // Configure TDD pattern before creating devices
   Config::SetDefault("ns3::NrGnbPhy::Pattern", StringValue("DL|DL|DL|DL|DL|DL|F|UL|UL|UL|"));
@@ -146,9 +129,30 @@ int main(int argc, char *argv[]) {
     // Print debug info
     NS_LOG_INFO("Added BWP to vector: " << (dlBwp != nullptr));
 
+    // Culling is opt-in. With --cullRange the BWP gets a grid-indexed copy of
+    // a 3GPP UMa channel: a UE transmission only reaches the PHYs within
+    // cullRange, instead of every UE on the channel, while the gNB sends to
+    // and hears every UE
+    Ptr<GridSpectrumChannel> gridChannel;
+    if (cullRange > 0.0) {
+      Ptr<NrChannelHelper> channelHelper = CreateObject<NrChannelHelper>();
+      channelHelper->ConfigureFactories("UMa", "Default", "ThreeGpp");
+      channelHelper->AssignChannelsToBands({band});
+      gridChannel = CreateObject<GridSpectrumChannel>();
+      gridChannel->SetAttribute("MaxRange", DoubleValue(cullRange));
+      gridChannel->SetAttribute("MaxNodeSpeed", DoubleValue(3.0)); // UE walking speed below
+      gridChannel->CopyModelsFrom(dlBwp->m_channel);
+      dlBwp->m_channel = gridChannel;
+    }
+
     // Install NR devices using the vector of bandwidth part references
     NetDeviceContainer gnbNetDevs = nrHelper->InstallGnbDevice(gnbNodes, allBwps);
     NetDeviceContainer ueNetDevs = nrHelper->InstallUeDevice(ueNodes, allBwps);
+    if (gridChannel) {
+      for (uint32_t i = 0; i < gnbNetDevs.GetN(); ++i) {
+        gridChannel->ExemptFromRange(NrHelper::GetGnbPhy(gnbNetDevs.Get(i), 0)->GetSpectrumPhy());
+      }
+    }
     
   // Install Internet stack on UE nodes
   InternetStackHelper internet;
@@ -168,6 +172,19 @@ int main(int argc, char *argv[]) {
   // Attach UEs to gNB
   nrHelper->AttachToClosestGnb(ueNetDevs, gnbNetDevs);
   
+  // The traffic is UL only, so the DL heavy pattern above is a poor fit;
+  // the controller moves towards the UL heavy candidates, which keep its
+  // first four slots so that a switch never lands on allocated slots
+  Ptr<AdaptiveTddController> tddController;
+  if (adaptiveTdd) {
+    tddController = CreateObject<AdaptiveTddController>();
+    tddController->SetAttribute("Patterns", StringValue("DL|DL|DL|DL|DL|DL|F|UL|UL|UL|;"
+                                                        "DL|DL|DL|DL|DL|F|UL|UL|UL|UL|;"
+                                                        "DL|DL|DL|DL|F|UL|UL|UL|UL|UL|"));
+    tddController->Install(gnbNetDevs, ueNetDevs);
+    tddController->Start(Seconds(appStartTime));
+  }
+
   // Setup dedicated bearers with QoS parameters
   Ptr<NrEpcTft> tft = Create<NrEpcTft>();
   NrEpcTft::PacketFilter dlpf;
@@ -205,7 +222,7 @@ int main(int argc, char *argv[]) {
     client.SetAttribute("PacketSize", UintegerValue(packetSize));
     
     ApplicationContainer clientApps = client.Install(ueNodes.Get(i));
-    clientApps.Start(Seconds(1.0));
+    clientApps.Start(Seconds(appStartTime));
     clientApps.Stop(Seconds(simTime - 0.5));
   }
   
@@ -218,22 +235,32 @@ int main(int argc, char *argv[]) {
   flowMonitor->SetAttribute("DelayBinWidth", DoubleValue(0.001));
   flowMonitor->SetAttribute("JitterBinWidth", DoubleValue(0.001));
   
-  // Create CSV file for metrics
-  std::ofstream csvFile;
-  csvFile.open("5g_qos_metrics.csv");
-  csvFile << "Sample,Time,FlowID,SourceIP,DestinationIP,Throughput(kbps),Jitter(s),Delay(s),PacketLoss(%)" << std::endl;
-  
-  // Schedule periodic metric collection
-  Time metricInterval = Seconds(interval);
-  Simulator::Schedule(metricInterval, &WriteMetricsToCSV, std::ref(flowMonHelper), flowMonitor, std::ref(csvFile), metricInterval, Seconds(simTime));
+  // Periodic metric collection into a CSV or binary metrics file
+  FlowMetricsSampler sampler(flowMonitor, DynamicCast<Ipv4FlowClassifier>(flowMonHelper.GetClassifier()));
+  std::string metricsFile = binaryMetrics ? "5g_qos_metrics.bin" : "5g_qos_metrics.csv";
+  if (!sampler.Open(metricsFile, binaryMetrics ? FlowMetricsSampler::BINARY : FlowMetricsSampler::CSV)) {
+    NS_FATAL_ERROR("Cannot open " << metricsFile);
+  }
+  sampler.Start(Seconds(interval), Seconds(simTime));
   
   // Run simulation
   NS_LOG_INFO("Starting simulation...");
   Simulator::Stop(Seconds(simTime));
   Simulator::Run();
+  std::cout << "Executed events: " << Simulator::GetEventCount() << std::endl;
   
-  // Close CSV file
-  csvFile.close();
+  // Flush and close the metrics file
+  sampler.Close();
+  if (tddController) {
+    std::cout << "TDD pattern switches: " << tddController->GetNSwitches() << std::endl;
+  }
+
+  if (!schedulerReport.empty() &&
+      !WriteSchedulerReport(schedulerReport, schedulerType, flowMonitor,
+                            DynamicCast<Ipv4FlowClassifier>(flowMonHelper.GetClassifier()),
+                            ueIpIfaces, gnbNetDevs, Seconds(simTime - appStartTime))) {
+    NS_LOG_ERROR("Cannot open " << schedulerReport);
+  }
   
   // Clean up
   Simulator::Destroy();
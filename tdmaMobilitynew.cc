@@ -8,6 +8,14 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/netanim-module.h"
 
+#include "batched-waypoint-mobility.h"
+#include "bounded-animation.h"
+#include "flow-attribution-index.h"
+#include "ladder-scheduler.h"
+#include "profiling-simulator-impl.h"
+#include "tdma-client-app.h"
+#include "tdma-net-device.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("TdmaDuplexSimImproved");
@@ -20,106 +28,9 @@ const uint32_t kPacketSize = 1024;
 const uint32_t kPacketsPerSlot = 10;
 const double kGuardTime = 0.001; // 1ms guard time
 
-// Global variables
-std::vector<std::vector<Ptr<Application>>> uplinkApps;
-std::vector<std::vector<Ptr<Application>>> downlinkApps;
-
-class TdmaClientApp : public Application {
-public:
-    TdmaClientApp();
-    virtual ~TdmaClientApp();
-
-    void Setup(Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets);
-    void SetStartStopTime(Time startTime, Time stopTime);
-
-private:
-    virtual void StartApplication(void);
-    virtual void StopApplication(void);
-
-    void SendPacket(void);
-    void ScheduleNextTx(void);
-
-    Ptr<Socket> m_socket;
-    Address m_peer;
-    uint32_t m_packetSize;
-    uint32_t m_nPackets;
-    uint32_t m_count;
-    EventId m_sendEvent;
-    Time m_interval;
-    Time m_startTime;
-    Time m_stopTime;
-};
-
-TdmaClientApp::TdmaClientApp()
-    : m_socket(0), m_packetSize(0), m_nPackets(0), m_count(0) {}
-
-TdmaClientApp::~TdmaClientApp() { m_socket = 0; }
-
-void TdmaClientApp::Setup(Ptr<Socket> socket, Address address,
-                          uint32_t packetSize, uint32_t nPackets) {
-    m_socket = socket;
-    m_peer = address;
-    m_packetSize = packetSize;
-    m_nPackets = nPackets;
-    m_interval = Seconds((kSlotDuration - kGuardTime) / nPackets);
-}
-
-void TdmaClientApp::SetStartStopTime(Time startTime, Time stopTime) {
-    m_startTime = startTime;
-    m_stopTime = stopTime;
-    Application::SetStartTime(startTime);
-    Application::SetStopTime(stopTime);
-}
-
-void TdmaClientApp::StartApplication(void) {
-    if (!m_socket) return;
-
-    // Bind only if not already bound (avoid conflicts)
-        if (m_socket->GetBoundNetDevice() == nullptr) {
-
-        m_socket->Bind();
-    }
-    m_socket->Connect(m_peer);
-
-    m_count = 0;
-    if (Simulator::Now() < m_startTime) {
-        Simulator::Schedule(m_startTime - Simulator::Now(),
-                            &TdmaClientApp::StartApplication, this);
-        return;
-    }
-    if (Simulator::Now() > m_stopTime) {
-        return;
-    }
-    m_sendEvent = Simulator::ScheduleNow(&TdmaClientApp::SendPacket, this);
-}
-
-void TdmaClientApp::StopApplication(void) {
-    if (m_sendEvent.IsPending()) {
-        Simulator::Cancel(m_sendEvent);
-    }
-    if (m_socket) {
-        m_socket->Close();
-    }
-}
-
-void TdmaClientApp::SendPacket(void) {
-    NS_LOG_INFO("Sending packet at " << Simulator::Now().GetSeconds());
-    if (Simulator::Now() >= m_stopTime) {
-        return;
-    }
-
-    Ptr<Packet> packet = Create<Packet>(m_packetSize);
-    m_socket->Send(packet);
-    m_count++;
-
-    if (m_count < m_nPackets && Simulator::Now() + m_interval < m_stopTime) {
-        ScheduleNextTx();
-    }
-}
-
-void TdmaClientApp::ScheduleNextTx(void) {
-    m_sendEvent = Simulator::Schedule(m_interval, &TdmaClientApp::SendPacket, this);
-}
+// One persistent TDMA application per UE and direction
+std::vector<Ptr<TdmaClientApp>> uplinkApps;
+std::vector<Ptr<TdmaClientApp>> downlinkApps;
 
 int main(int argc, char *argv[]) {
     uint32_t numUes = kNumUes;
@@ -127,8 +38,19 @@ int main(int argc, char *argv[]) {
     double simDuration = kSimDuration;
     uint32_t packetSize = kPacketSize;
     bool enableRtsCts = false;
+    bool useTdmaMac = false;
+    bool batchedMobility = false;
+    std::string slotPolicy = "ns3::TdmaRoundRobinPolicy";
     bool enableAnimation = true;
+    bool profileEvents = false;
+    bool packetPool = true;
     std::string animationFile = "tdma-animation.xml";
+    bool animFullTrace = false;
+    double animPollInterval = 1.0;
+    double animStart = 0.0;
+    double animWindow = 2.0;
+    uint32_t animSampleEvery = 100;
+    std::string animTraceUes = "";
 
     CommandLine cmd;
     cmd.AddValue("numUes", "Number of UE nodes", numUes);
@@ -136,55 +58,95 @@ int main(int argc, char *argv[]) {
     cmd.AddValue("simDuration", "Total simulation duration (seconds)", simDuration);
     cmd.AddValue("packetSize", "Size of each packet (bytes)", packetSize);
     cmd.AddValue("enableRtsCts", "Enable RTS/CTS for WiFi", enableRtsCts);
+    cmd.AddValue("useTdmaMac", "Use the contention-free TDMA MAC instead of 802.11g", useTdmaMac);
+    cmd.AddValue("batchedMobility", "Move the UEs with one batched random waypoint container", batchedMobility);
+    cmd.AddValue("slotPolicy", "TypeId of the TdmaSlotPolicy building each frame", slotPolicy);
     cmd.AddValue("enableAnimation", "Enable NetAnim animation", enableAnimation);
+    cmd.AddValue("profileEvents", "Print wall time and event count per event target at the end of the run", profileEvents);
+    cmd.AddValue("packetPool", "Recycle the payload packets of the TDMA apps (off while animating, packet uids repeat)", packetPool);
     cmd.AddValue("animationFile", "NetAnim XML output file", animationFile);
+    cmd.AddValue("animFullTrace", "Trace every packet in NetAnim (large XML) instead of sampling", animFullTrace);
+    cmd.AddValue("animPollInterval", "NetAnim mobility poll interval (seconds)", animPollInterval);
+    cmd.AddValue("animStart", "Start of the NetAnim XML window (seconds)", animStart);
+    cmd.AddValue("animWindow", "Length of the NetAnim XML window, which traces every packet (seconds)", animWindow);
+    cmd.AddValue("animSampleEvery", "Log 1 in N packets of the traced UEs", animSampleEvery);
+    cmd.AddValue("animTraceUes", "Comma separated UE indices whose packets are logged, empty for all", animTraceUes);
     cmd.Parse(argc, argv);
 
+    if (profileEvents) {
+        GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::ProfilingSimulatorImpl"));
+    }
+
     LogComponentEnable("TdmaDuplexSimImproved", LOG_LEVEL_INFO);
 
     NodeContainer bsNode, ueNodes;
     bsNode.Create(1);
     ueNodes.Create(numUes);
 
-    // WiFi channel with guaranteed coverage
-    YansWifiChannelHelper channel = YansWifiChannelHelper::Default();
-    channel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
-
-    // FIX: ensure coverage for mobility
-    channel.AddPropagationLoss("ns3::RangePropagationLossModel",
-                               "MaxRange", DoubleValue(120.0)); // 120m range
-
-    YansWifiPhyHelper phy;
-    phy.SetChannel(channel.Create());
-    phy.Set("TxPowerStart", DoubleValue(20.0));
-    phy.Set("TxPowerEnd", DoubleValue(20.0));
-
-    WifiHelper wifi;
-    wifi.SetStandard(WIFI_STANDARD_80211g);
-    wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
-                                 "DataMode", StringValue("DsssRate11Mbps"),
-                                 "ControlMode", StringValue("DsssRate1Mbps"));
-
-    WifiMacHelper mac;
-    Ssid ssid = Ssid("tdma-improved");
-
-    mac.SetType("ns3::StaWifiMac",
-                "Ssid", SsidValue(ssid),
-                "ActiveProbing", BooleanValue(true),  // allow reassociation
-                "QosSupported", BooleanValue(false));
-
-    NetDeviceContainer ueDevices = wifi.Install(phy, mac, ueNodes);
-
-    mac.SetType("ns3::ApWifiMac",
-                "Ssid", SsidValue(ssid),
-                "QosSupported", BooleanValue(false),
-                "EnableBeaconJitter", BooleanValue(false));
+    // Central TDMA frame shared by the applications and the TDMA MAC
+    Ptr<TdmaSlotScheduler> slotScheduler = CreateObject<TdmaSlotScheduler>();
+    slotScheduler->SetAttribute("SlotDuration", TimeValue(Seconds(slotDuration)));
+    slotScheduler->SetAttribute("GuardTime", TimeValue(Seconds(kGuardTime)));
+    slotScheduler->SetPolicy(ObjectFactory(slotPolicy).Create<TdmaSlotPolicy>());
+    for (uint32_t i = 0; i < numUes; ++i) {
+        slotScheduler->AddUe(0);
+    }
 
-    NetDeviceContainer bsDevice = wifi.Install(phy, mac, bsNode);
+    NetDeviceContainer ueDevices, bsDevice;
+    if (useTdmaMac) {
+        // Native TDMA MAC: UEs send in their uplink slots, the BS to each UE in its downlink slots
+        TdmaHelper tdma;
+        tdma.SetDeviceAttribute("DataRate", DataRateValue(DataRate("11Mbps")));
+        tdma.SetChannelAttribute("MaxRange", DoubleValue(120.0));
+        Ptr<TdmaChannel> tdmaChannel = tdma.CreateChannel();
 
-    if (enableRtsCts) {
-        Config::Set("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/RemoteStationManager/RtsCtsThreshold",
-                    UintegerValue(100));
+        ueDevices = tdma.Install(ueNodes, tdmaChannel);
+        bsDevice = tdma.Install(bsNode, tdmaChannel);
+        for (uint32_t i = 0; i < numUes; ++i) {
+            tdma.AssignSlot(ueDevices.Get(i), slotScheduler, i, TDMA_UPLINK);
+            tdma.AssignSlot(bsDevice.Get(0), slotScheduler, i, TDMA_DOWNLINK, ueDevices.Get(i));
+        }
+    } else {
+        // WiFi channel with guaranteed coverage
+        YansWifiChannelHelper channel = YansWifiChannelHelper::Default();
+        channel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
+
+        // FIX: ensure coverage for mobility
+        channel.AddPropagationLoss("ns3::RangePropagationLossModel",
+                                   "MaxRange", DoubleValue(120.0)); // 120m range
+
+        YansWifiPhyHelper phy;
+        phy.SetChannel(channel.Create());
+        phy.Set("TxPowerStart", DoubleValue(20.0));
+        phy.Set("TxPowerEnd", DoubleValue(20.0));
+
+        WifiHelper wifi;
+        wifi.SetStandard(WIFI_STANDARD_80211g);
+        wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
+                                     "DataMode", StringValue("DsssRate11Mbps"),
+                                     "ControlMode", StringValue("DsssRate1Mbps"));
+
+        WifiMacHelper mac;
+        Ssid ssid = Ssid("tdma-improved");
+
+        mac.SetType("ns3::StaWifiMac",
+                    "Ssid", SsidValue(ssid),
+                    "ActiveProbing", BooleanValue(true),  // allow reassociation
+                    "QosSupported", BooleanValue(false));
+
+        ueDevices = wifi.Install(phy, mac, ueNodes);
+
+        mac.SetType("ns3::ApWifiMac",
+                    "Ssid", SsidValue(ssid),
+                    "QosSupported", BooleanValue(false),
+                    "EnableBeaconJitter", BooleanValue(false));
+
+        bsDevice = wifi.Install(phy, mac, bsNode);
+
+        if (enableRtsCts) {
+            Config::Set("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/RemoteStationManager/RtsCtsThreshold",
+                        UintegerValue(100));
+        }
     }
 
     // Mobility
@@ -199,21 +161,35 @@ int main(int argc, char *argv[]) {
     mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
     mobility.Install(bsNode);
 
-    MobilityHelper ueMobility;
-    ueMobility.SetPositionAllocator("ns3::RandomRectanglePositionAllocator",
-                                    "X", StringValue("ns3::UniformRandomVariable[Min=-50.0|Max=50.0]"),
-                                    "Y", StringValue("ns3::UniformRandomVariable[Min=-50.0|Max=50.0]"));
-
-    ueMobility.SetMobilityModel("ns3::SteadyStateRandomWaypointMobilityModel",
-                                "MinX", DoubleValue(-50.0),
-                                "MaxX", DoubleValue(50.0),
-                                "MinY", DoubleValue(-50.0),
-                                "MaxY", DoubleValue(50.0),
-                                "MinSpeed", StringValue("1.0"),
-                                "MaxSpeed", StringValue("3.0"),
-                                "MinPause", StringValue("0.5"),
-                                "MaxPause", StringValue("2.0"));
-    ueMobility.Install(ueNodes);
+    if (batchedMobility) {
+        Ptr<WaypointBatch> ueBatch = CreateObject<WaypointBatch>();
+        ueBatch->SetAttribute("MinX", DoubleValue(-50.0));
+        ueBatch->SetAttribute("MaxX", DoubleValue(50.0));
+        ueBatch->SetAttribute("MinY", DoubleValue(-50.0));
+        ueBatch->SetAttribute("MaxY", DoubleValue(50.0));
+        ueBatch->SetAttribute("MinSpeed", DoubleValue(1.0));
+        ueBatch->SetAttribute("MaxSpeed", DoubleValue(3.0));
+        ueBatch->SetAttribute("MinPause", DoubleValue(0.5));
+        ueBatch->SetAttribute("MaxPause", DoubleValue(2.0));
+        ueBatch->Install(ueNodes);
+        ueBatch->AssignStreams(0);  // one fixed stream per UE, so the walks only vary with RngRun
+    } else {
+        MobilityHelper ueMobility;
+        ueMobility.SetPositionAllocator("ns3::RandomRectanglePositionAllocator",
+                                        "X", StringValue("ns3::UniformRandomVariable[Min=-50.0|Max=50.0]"),
+                                        "Y", StringValue("ns3::UniformRandomVariable[Min=-50.0|Max=50.0]"));
+
+        ueMobility.SetMobilityModel("ns3::SteadyStateRandomWaypointMobilityModel",
+                                    "MinX", DoubleValue(-50.0),
+                                    "MaxX", DoubleValue(50.0),
+                                    "MinY", DoubleValue(-50.0),
+                                    "MaxY", DoubleValue(50.0),
+                                    "MinSpeed", StringValue("1.0"),
+                                    "MaxSpeed", StringValue("3.0"),
+                                    "MinPause", StringValue("0.5"),
+                                    "MaxPause", StringValue("2.0"));
+        ueMobility.Install(ueNodes);
+    }
 
     // Internet stack
     InternetStackHelper internet;
@@ -225,6 +201,10 @@ int main(int argc, char *argv[]) {
     Ipv4InterfaceContainer bsInterface = ipv4.Assign(bsDevice);
     Ipv4InterfaceContainer ueInterfaces = ipv4.Assign(ueDevices);
 
+    if (useTdmaMac) {
+        TdmaHelper::PopulateNeighbours();
+    }
+
     uint16_t uplinkPort = 5000;
     uint16_t downlinkPort = 5001;
 
@@ -242,7 +222,7 @@ int main(int argc, char *argv[]) {
         ueServers.Add(app);
     }
 
-    // TDMA scheduling
+    // TDMA scheduling: one persistent app per UE and direction
     uplinkApps.resize(numUes);
     downlinkApps.resize(numUes);
 
@@ -252,46 +232,52 @@ int main(int argc, char *argv[]) {
     NS_LOG_INFO("TDMA Configuration:");
     NS_LOG_INFO("  Number of UEs: " << numUes);
     NS_LOG_INFO("  Slot Duration: " << slotDuration << "s");
+    NS_LOG_INFO("  Slot Policy: " << slotPolicy);
     NS_LOG_INFO("  Cycle Duration: " << cycleDuration << "s");
     NS_LOG_INFO("  Number of Cycles: " << numCycles);
 
-    for (uint32_t cycle = 0; cycle < numCycles; ++cycle) {
-        double cycleStartTime = cycle * cycleDuration;
+    TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
+    for (uint32_t i = 0; i < numUes; ++i) {
+        // uplink
+        Ptr<Socket> uplinkSocket = Socket::CreateSocket(ueNodes.Get(i), tid);
+        InetSocketAddress uplinkDest = InetSocketAddress(bsInterface.GetAddress(0), uplinkPort);
+
+        Ptr<TdmaClientApp> uplinkApp = CreateObject<TdmaClientApp>();
+        uplinkApp->Setup(uplinkSocket, uplinkDest, packetSize, kPacketsPerSlot);
+        uplinkApp->SetPacketPool(packetPool && !enableAnimation);
+        uplinkApp->SetStartTime(Seconds(0.0));
+        uplinkApp->SetStopTime(Seconds(simDuration));
+        ueNodes.Get(i)->AddApplication(uplinkApp);
+        slotScheduler->AddSlotListener(i, TDMA_UPLINK, MakeCallback(&TdmaClientApp::StartSlot, uplinkApp));
+        uplinkApps[i] = uplinkApp;
+
+        // downlink
+        Ptr<Socket> downlinkSocket = Socket::CreateSocket(bsNode.Get(0), tid);
+        InetSocketAddress downlinkDest = InetSocketAddress(ueInterfaces.GetAddress(i), downlinkPort);
+
+        Ptr<TdmaClientApp> downlinkApp = CreateObject<TdmaClientApp>();
+        downlinkApp->Setup(downlinkSocket, downlinkDest, packetSize, kPacketsPerSlot);
+        downlinkApp->SetPacketPool(packetPool && !enableAnimation);
+        downlinkApp->SetStartTime(Seconds(0.0));
+        downlinkApp->SetStopTime(Seconds(simDuration));
+        bsNode.Get(0)->AddApplication(downlinkApp);
+        slotScheduler->AddSlotListener(i, TDMA_DOWNLINK, MakeCallback(&TdmaClientApp::StartSlot, downlinkApp));
+        downlinkApps[i] = downlinkApp;
+    }
 
-        for (uint32_t i = 0; i < numUes; ++i) {
-            double uplinkStart = cycleStartTime + i * 2 * slotDuration;
-            double downlinkStart = uplinkStart + slotDuration;
-
-            TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
-
-            // uplink
-            Ptr<Socket> uplinkSocket = Socket::CreateSocket(ueNodes.Get(i), tid);
-            InetSocketAddress uplinkDest = InetSocketAddress(bsInterface.GetAddress(0), uplinkPort);
-
-            Ptr<TdmaClientApp> uplinkApp = CreateObject<TdmaClientApp>();
-            uplinkApp->Setup(uplinkSocket, uplinkDest, packetSize, kPacketsPerSlot);
-            uplinkApp->SetStartStopTime(Seconds(uplinkStart),
-                                        Seconds(uplinkStart + slotDuration - kGuardTime));
-            ueNodes.Get(i)->AddApplication(uplinkApp);
-            uplinkApps[i].push_back(uplinkApp);
-
-            // downlink
-            Ptr<Socket> downlinkSocket = Socket::CreateSocket(bsNode.Get(0), tid);
-            InetSocketAddress downlinkDest = InetSocketAddress(ueInterfaces.GetAddress(i), downlinkPort);
-
-            Ptr<TdmaClientApp> downlinkApp = CreateObject<TdmaClientApp>();
-            downlinkApp->Setup(downlinkSocket, downlinkDest, packetSize, kPacketsPerSlot);
-            downlinkApp->SetStartStopTime(Seconds(downlinkStart),
-                                          Seconds(downlinkStart + slotDuration - kGuardTime));
-            bsNode.Get(0)->AddApplication(downlinkApp);
-            downlinkApps[i].push_back(downlinkApp);
-        }
+    Ptr<TdmaDemandPolicy> demandPolicy = DynamicCast<TdmaDemandPolicy>(slotScheduler->GetPolicy());
+    if (demandPolicy) {
+        demandPolicy->SetDemandCallback([](uint32_t ue, TdmaDirection dir) {
+            return dir == TDMA_UPLINK ? uplinkApps[ue]->GetBacklog() : downlinkApps[ue]->GetBacklog();
+        });
     }
+    slotScheduler->Start(Seconds(0.0));
 
     FlowMonitorHelper flowmon;
     Ptr<FlowMonitor> monitor = flowmon.InstallAll();
 
     AnimationInterface* anim = nullptr;
+    SampledPacketLog* packetLog = nullptr;
     if (enableAnimation) {
         anim = new AnimationInterface(animationFile);
         Ptr<Node> bs = bsNode.Get(0);
@@ -306,18 +292,39 @@ int main(int argc, char *argv[]) {
             anim->UpdateNodeSize(ue, 3.0, 3.0);
         }
 
-        anim->EnablePacketMetadata(true);
-        anim->EnableIpv4RouteTracking("tdma-packets", Seconds(0), Seconds(simDuration));
+        if (animFullTrace) {
+            anim->EnablePacketMetadata(true);
+            anim->EnableIpv4RouteTracking("tdma-packets", Seconds(0), Seconds(simDuration));
+        } else {
+            // Every packet in a short window, positions at a coarse period and
+            // 1-in-N packets of the selected UEs over the whole run
+            ConfigureBoundedAnimation(*anim, Seconds(animPollInterval), Seconds(animStart),
+                                      Seconds(animStart + animWindow));
+            packetLog = new SampledPacketLog("tdma-packets", animSampleEvery, 1000000, true);
+            packetLog->SetAnimation(anim);
+            for (uint32_t ue : ParseUeList(animTraceUes, numUes)) {
+                packetLog->TraceUe(ueNodes.Get(ue));
+            }
+            packetLog->TraceServingNodes(bsNode);
+        }
     }
 
     Simulator::Stop(Seconds(simDuration));
     NS_LOG_INFO("Starting simulation...");
     Simulator::Run();
+    std::cout << "Executed events: " << Simulator::GetEventCount() << std::endl;
     NS_LOG_INFO("Simulation completed.");
 
     Ptr<Ipv4FlowClassifier> classifier =
         DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
-    FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats();
+    const FlowMonitor::FlowStatsContainer& stats = monitor->GetFlowStats();
+
+    FlowAttributionIndex attribution(classifier);
+    attribution.AddUes(ueInterfaces, 0, 0);
+    attribution.AddBss(bsInterface);
+    attribution.SetPortDirection(uplinkPort, FLOW_UPLINK);
+    attribution.SetPortDirection(downlinkPort, FLOW_DOWNLINK);
+    const char* directionNames[] = {"Uplink", "Downlink", "Unknown"};
 
     std::string filename = "tdma_improved_results_" + std::to_string(numUes) + "ues.csv";
     std::ofstream outFile(filename);
@@ -328,21 +335,10 @@ int main(int argc, char *argv[]) {
     uint32_t validFlows = 0;
 
     for (const auto& flow : stats) {
-        Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(flow.first);
-        uint32_t ueId = 0;
-        std::string direction = "Unknown";
-
-        for (uint32_t i = 0; i < numUes; ++i) {
-            if (t.sourceAddress == ueInterfaces.GetAddress(i)) {
-                ueId = i;
-                direction = "Uplink";
-                break;
-            } else if (t.destinationAddress == ueInterfaces.GetAddress(i)) {
-                ueId = i;
-                direction = "Downlink";
-                break;
-            }
-        }
+        const FlowAttribution& a = attribution.Classify(flow.first);
+        const Ipv4FlowClassifier::FiveTuple& t = a.tuple;
+        uint32_t ueId = a.ue != FlowAttribution::NONE ? a.ue : 0;
+        std::string direction = directionNames[a.direction];
 
         double delay = flow.second.rxPackets > 0 ?
                        flow.second.delaySum.GetSeconds() * 1000 / flow.second.rxPackets : 0;
@@ -385,6 +381,7 @@ int main(int argc, char *argv[]) {
 
     Simulator::Destroy();
     if (anim) delete anim;
+    delete packetLog;
     return 0;
 }
 